@@ -0,0 +1,235 @@
+// CycleEngineBench.cpp
+// Host benchmark for lib/CycleEngine: runs the cycle state machine against a
+// simple 18650 and board heat model with a fake clock. Reports simulated
+// ticks per second, the scheduler throughput (cells per hour, high
+// temperature faults, peak board temperature, where the slot time went) and
+// the checkpoint write rate against EEPROM endurance.
+//
+//   pio run -e engine_bench -t exec
+//   (or) g++ -O2 -std=gnu++11 -Ilib/CycleEngine/src bench/CycleEngineBench.cpp lib/CycleEngine/src/*.cpp
+//   ./a.out [ticks] [discharge budget amps]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <CycleEngine.h>
+
+namespace
+{
+
+const uint8_t slotCount = 4;
+
+// Checkpoint ring as laid out by src/Checkpoint.ino on the ATmega328P:
+// (1024 - 128) bytes / 33 byte entries, 100,000 write cycles per cell
+const unsigned long checkpointEntries = 27;
+const unsigned long eepromEndurance   = 100000;
+
+// Fixed step clock, one engine tick per simulated second
+class BenchClock : public CycleClock
+{
+public:
+  uint32_t now = 0;
+  uint32_t millis() override { return now; }
+};
+
+// Linear-ish OCV curve, constant IR, charger at 1 A, discharge through the shunt
+struct BenchCell
+{
+  float capacityMilliamps;
+  float milliOhms;
+  float chargedMilliamps;
+  bool  present;
+  bool  charging;
+  bool  discharging;
+  bool  tripped;
+  uint32_t tripMillis;
+};
+
+class BenchIO : public CycleIO
+{
+public:
+  BenchCell cells[slotCount];
+  float     shuntResistor = 3.3;
+  float     boardTemp     = 22.0f;
+  float     peakBoardTemp = 22.0f;
+
+  float openVoltage(uint8_t j) const
+  {
+    const BenchCell &cell = cells[j];
+    float soc = cell.chargedMilliamps / cell.capacityMilliamps;
+    if (soc < 0.0f)
+      soc = 0.0f;
+    if (soc > 1.0f)
+      soc = 1.0f;
+    float depth = 1.0f - soc;
+    return 2.6f + (1.6f * soc) - (depth * depth * depth);
+  }
+
+  float loadedVoltage(uint8_t j) const
+  {
+    float ohms = cells[j].milliOhms / 1000.0f;
+    return openVoltage(j) * shuntResistor / (shuntResistor + ohms);
+  }
+
+  // Advance the cell model by one simulated second, opening the load at cutoff like the ADC watcher
+  void step(uint32_t now)
+  {
+    float watts = 0.0f;
+    for (uint8_t j = 0; j < slotCount; j++)
+    {
+      BenchCell &cell = cells[j];
+      if (!cell.present)
+        continue;
+      if (cell.charging && cell.chargedMilliamps < cell.capacityMilliamps)
+        cell.chargedMilliamps += 1000.0f / 3600.0f;
+      if (cell.discharging)
+        cell.chargedMilliamps -= (loadedVoltage(j) / shuntResistor) * 1000.0f / 3600.0f;
+      if (cell.charging)
+        watts += 1.0f; // TP5100 loss
+      if (cell.discharging)
+        watts += loadedVoltage(j) * loadedVoltage(j) / shuntResistor;
+      if (cell.discharging && loadedVoltage(j) < 2.8f)
+      {
+        cell.discharging = false;
+        cell.tripped     = true;
+        cell.tripMillis  = now;
+      }
+    }
+
+    // First order board heating, ~10 minute time constant
+    boardTemp += ((22.0f + 2.5f * watts) - boardTemp) / 600.0f;
+    if (boardTemp > peakBoardTemp)
+      peakBoardTemp = boardTemp;
+  }
+
+  float batteryVoltage(uint8_t j) override
+  {
+    if (!cells[j].present)
+      return 0.0f;
+    return cells[j].discharging ? loadedVoltage(j) : openVoltage(j);
+  }
+  float shuntVoltage(uint8_t j) override
+  {
+    if (!cells[j].present || !cells[j].discharging)
+      return batteryVoltage(j);
+    return 0.02f; // MOSFET drop, the shunt carries the whole loaded voltage
+  }
+  bool    chargerDone(uint8_t j) override { return cells[j].chargedMilliamps >= cells[j].capacityMilliamps; }
+  void    setCharger(uint8_t j, bool on) override { cells[j].charging = on; }
+  void    setDischarge(uint8_t j, bool on) override
+  {
+    cells[j].discharging = on;
+    if (on)
+      cells[j].tripped = false;
+  }
+  uint8_t temperature(uint8_t j) override { return boardTemp + (cells[j].discharging ? 5 : 0) + (cells[j].charging ? 2 : 0); }
+  uint8_t ambientTemperature() override { return boardTemp; }
+  bool    dischargeTripped(uint8_t j, uint32_t &tripMillis) override
+  {
+    bool tripped = cells[j].tripped;
+    tripMillis       = cells[j].tripMillis;
+    cells[j].tripped = false;
+    return tripped;
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned long ticks = argc > 1 ? strtoul(argv[1], 0, 10) : 10000000UL;
+
+  CycleSettings settings;
+  if (argc > 2)
+    settings.dischargeBudgetAmps = atof(argv[2]);
+  CycleSlot     slots[slotCount] = {};
+  BenchIO       io;
+  BenchClock    clock;
+  CycleEngine   engine(slots, slotCount, settings, io, clock);
+
+  for (uint8_t j = 0; j < slotCount; j++)
+    io.cells[j] = {800.0f + 700.0f * j, 40.0f + 30.0f * j, 0.0f, true, false, false, false, 0};
+
+  unsigned long cycles = 0;
+  unsigned long gradeSum = 0;
+  unsigned long checkpoints = 0;
+  uint8_t       checkpointSlot = 0;
+  CycleCheckpoint checkpoint;
+  auto start = std::chrono::steady_clock::now();
+
+  for (unsigned long t = 0; t < ticks; t += slotCount)
+  {
+    engine.tick();
+    for (uint8_t j = 0; j < slotCount; j++)
+    {
+      // Server side of the handshake: barcode found, every insert acknowledged
+      if (slots[j].cycleState == CYCLE_BARCODE)
+        slots[j].batteryBarcode = true;
+      if (engine.awaitingInsert(j))
+        slots[j].insertData = true;
+
+      // Swap the cell once the result is out, put it back on the next pass
+      if (slots[j].resultReady)
+      {
+        slots[j].resultReady = false;
+        gradeSum += slots[j].cellGrade;
+        cycles++;
+        io.cells[j].present = false;
+      }
+      else if (!io.cells[j].present && slots[j].cycleState == CYCLE_CHECK_BATTERY)
+      {
+        io.cells[j].present = true;
+      }
+    }
+
+    // Same policy as saveCheckpoints(): at most one entry per tick, round robin
+    for (uint8_t n = 1; n <= slotCount; n++)
+    {
+      uint8_t j = (checkpointSlot + n) % slotCount;
+      if (engine.checkpointDue(j))
+      {
+        engine.checkpoint(j, checkpoint);
+        checkpointSlot = j;
+        checkpoints++;
+        break;
+      }
+    }
+
+    clock.now += 1000;
+    io.step(clock.now);
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("slot ticks:      %lu\n", ticks);
+  printf("elapsed:         %.3f s\n", seconds);
+  printf("ticks/s:         %.0f\n", ticks / seconds);
+  printf("simulated hours: %.1f\n", clock.now / 3600000.0);
+  printf("cycles:          %lu (grade sum %lu)\n", cycles, gradeSum);
+  printf("cells/hour:      %.2f (%u high temperature faults, peak board %.1f C)\n",
+         engine.cellsPerHour(), engine.thermalFaults(), io.peakBoardTemp);
+  // Where the slot time went: running a phase, idle with a cell in, held (scheduler, insert ack), empty
+  double accounted[ACCOUNT_COUNT] = {};
+  double total = 0;
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    for (uint8_t k = 0; k < ACCOUNT_COUNT; k++)
+    {
+      accounted[k] += slots[j].accountSeconds[k];
+      total += slots[j].accountSeconds[k];
+    }
+  }
+  if (total > 0)
+  {
+    double idle = accounted[CYCLE_CHECK_BATTERY] + accounted[CYCLE_BARCODE] + accounted[CYCLE_COMPLETED];
+    double held = accounted[ACCOUNT_ADMISSION] + accounted[ACCOUNT_INSERT];
+    printf("slot time:       %.1f%% running, %.1f%% idle, %.1f%% held, %.1f%% empty\n",
+           100.0 * (total - idle - held - accounted[ACCOUNT_EMPTY]) / total, 100.0 * idle / total,
+           100.0 * held / total, 100.0 * accounted[ACCOUNT_EMPTY] / total);
+  }
+  double checkpointsPerHour = checkpoints / (clock.now / 3600000.0);
+  printf("checkpoints/h:   %.1f (%.1f per cell)\n", checkpointsPerHour, cycles ? (double)checkpoints / cycles : 0.0);
+  printf("EEPROM life:     %.1f years continuous\n",
+         checkpointEntries * eepromEndurance / checkpointsPerHour / (24.0 * 365.0));
+  return 0;
+}
@@ -0,0 +1,470 @@
+// CycleAnalysis.cpp
+// Measurements and estimators used by the state handlers: internal
+// resistance, capacity integration and prediction, rest relaxation, storage
+// finishing and grading.
+
+#include <math.h>
+
+#include "CycleEngine.h"
+
+// ----------------------
+// Internal resistance (milliOhms)
+// ----------------------
+
+float CycleEngine::milliOhms(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+
+  io.setDischarge(j, false);
+  float batteryVoltageInput = io.batteryVoltage(j);
+
+  io.setDischarge(j, true);
+  float batteryShuntVoltage = io.batteryVoltage(j);
+
+  io.setDischarge(j, false);
+
+  float resistanceAmps = batteryShuntVoltage / settings.shuntResistor[j];
+  float voltageDrop    = batteryVoltageInput - batteryShuntVoltage;
+
+  slot.milliOhmsValue = ((voltageDrop / resistanceAmps) * 1000) + settings.offsetMilliOhms;
+  if (!(slot.milliOhmsValue <= 9999))
+    slot.milliOhmsValue = 9999;
+  return slot.milliOhmsValue;
+}
+
+// ----------------------
+// Discharge: integrates current over time to estimate mAh and mWh
+// ----------------------
+
+bool CycleEngine::dischargeCycle(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  uint32_t now = clock.millis();
+  uint32_t tripMillis;
+
+  if (slot.hardwareCutoff)
+    return true;
+
+  if (io.dischargeTripped(j, tripMillis))
+  {
+    // MOSFET already opened between readings: count capacity up to the trip at the last current
+    float hoursPassed = (tripMillis - slot.longMilliSecondsPrevious) / 3600000.0;
+    slot.dischargeMilliamps      += (slot.dischargeAmps * 1000.0) * hoursPassed;
+    slot.dischargeMilliwattHours += (slot.dischargeVoltage * slot.dischargeAmps * 1000.0) * hoursPassed;
+    slot.longMilliSecondsPrevious = tripMillis;
+    slot.cutoffMillis             = tripMillis - slot.longMilliSecondsCleared;
+    slot.hardwareCutoff           = true;
+    slot.cutoffReady              = true;
+    return true;
+  }
+
+  // Take reading every interval or on first run
+  if ((now - slot.dischargeReadMillis) < settings.dischargeReadInterval && slot.dischargeAmps != 0)
+    return false;
+  slot.dischargeReadMillis = now;
+
+  slot.dischargeVoltage     = io.batteryVoltage(j);
+  float batteryShuntVoltage = io.shuntVoltage(j);
+
+  // Below cutoff voltage: stop discharge
+  if (slot.dischargeVoltage < settings.defaultBatteryCutOffVoltage)
+  {
+    io.setDischarge(j, false);
+    return true;
+  }
+
+  io.setDischarge(j, true); // Turn on discharge MOSFET
+  slot.dischargeAmps = (slot.dischargeVoltage - batteryShuntVoltage) / settings.shuntResistor[j];
+
+  float hoursPassed = (now - slot.longMilliSecondsPrevious) / 3600000.0;
+  slot.dischargeMilliamps      += (slot.dischargeAmps * 1000.0) * hoursPassed;
+  slot.dischargeMilliwattHours += (slot.dischargeVoltage * slot.dischargeAmps * 1000.0) * hoursPassed;
+  slot.longMilliSecondsPrevious = now;
+  updateCapacityPrediction(j);
+  return false;
+}
+
+// ----------------------
+// Capacity prediction
+//
+// The OCV-SoC curve turns the IR-compensated voltage of each reading into a
+// state of charge. The rested OCV the discharge started from gives the start,
+// so the mAh drawn against the SoC used gives the capacity, and the SoC left
+// above the cutoff (itself IR-compensated) gives the mAh still to come:
+//
+//   predicted = drawn * (SoC start - SoC cutoff) / (SoC start - SoC now)
+//
+// The compensation uses an effective resistance taken from the load step
+// once the polarisation has built up (predictMinSamples readings), since the
+// short IR pulse misses it. The upper bound allows predictVoltageMargin of
+// OCV error: wide on the plateau, where a few mV span many %, and tight past
+// the knee, where a weak cell shows itself.
+//
+// After a charge under 2 min the rest is skipped (EVENT_RESISTANCE_MEASURED_RESTED),
+// so the start OCV can still carry charge polarisation. A start SoC read too
+// high lowers the prediction of every cell, and only the margin of the upper
+// bound stands between that and an early reject of a good cell.
+// ----------------------
+
+void CycleEngine::clearCapacityPrediction(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  slot.predictStartSoc        = 0.0;
+  slot.predictStepVoltage     = 0.0;
+  slot.predictStepAmps        = 0.0;
+  slot.predictStepMilliamps   = 0.0;
+  slot.predictOhms            = 0.0;
+  slot.predictCapacity        = 0.0;
+  slot.predictSamples         = 0;
+  slot.predictedMilliamps     = 0;
+  slot.predictedMilliampsHigh = 0;
+}
+
+float CycleEngine::stateOfCharge(float openVoltage) const
+{
+  const uint8_t last       = sizeof(settings.ocvCurveMillivolts) / sizeof(settings.ocvCurveMillivolts[0]) - 1;
+  const float   millivolts = openVoltage * 1000.0;
+
+  if (millivolts <= settings.ocvCurveMillivolts[0])
+    return 0.0;
+  for (uint8_t i = 1; i <= last; i++)
+  {
+    if (millivolts < settings.ocvCurveMillivolts[i])
+    {
+      float fraction = (millivolts - settings.ocvCurveMillivolts[i - 1]) /
+                       (settings.ocvCurveMillivolts[i] - settings.ocvCurveMillivolts[i - 1]);
+      return (i - 1 + fraction) / last;
+    }
+  }
+  return 1.0;
+}
+
+float CycleEngine::openCircuitVoltage(float soc) const
+{
+  const uint8_t last = sizeof(settings.ocvCurveMillivolts) / sizeof(settings.ocvCurveMillivolts[0]) - 1;
+
+  if (soc <= 0.0)
+    return settings.ocvCurveMillivolts[0] / 1000.0;
+  if (soc >= 1.0)
+    return settings.ocvCurveMillivolts[last] / 1000.0;
+  float   position = soc * last;
+  uint8_t i        = (uint8_t)position;
+  return (settings.ocvCurveMillivolts[i] + (settings.ocvCurveMillivolts[i + 1] - settings.ocvCurveMillivolts[i]) * (position - i)) / 1000.0;
+}
+
+void CycleEngine::updateCapacityPrediction(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  const float minimumSocUsed = 0.02; // Less SoC used than this is lost in the voltage readings
+
+  if (slot.predictSamples < 255)
+    slot.predictSamples++;
+  if (slot.predictSamples == 1)
+    slot.predictStartSoc = stateOfCharge(slot.batteryInitialVoltage);
+  if (slot.predictSamples == settings.predictMinSamples)
+  {
+    slot.predictStepVoltage   = slot.dischargeVoltage;
+    slot.predictStepAmps      = slot.dischargeAmps;
+    slot.predictStepMilliamps = slot.dischargeMilliamps;
+  }
+
+  slot.predictedMilliamps     = 0;
+  slot.predictedMilliampsHigh = 0;
+  if (slot.predictSamples < settings.predictMinSamples || slot.predictStepAmps <= 0.0 ||
+      slot.dischargeAmps <= 0.0 || slot.dischargeVoltage <= 0.0)
+    return;
+
+  // Effective resistance from the load step. The OCV had already dropped by the charge drawn before the
+  // step; once there is a capacity estimate that drop is taken out, until then the resistance reads high.
+  float stepOpenVoltage = slot.batteryInitialVoltage;
+  if (slot.predictCapacity > 0.0)
+    stepOpenVoltage = openCircuitVoltage(slot.predictStartSoc - (slot.predictStepMilliamps / slot.predictCapacity));
+  float ohms = (stepOpenVoltage - slot.predictStepVoltage) / slot.predictStepAmps;
+  if (ohms < slot.milliOhmsValue / 1000.0)
+    ohms = slot.milliOhmsValue / 1000.0;
+  slot.predictOhms = ohms;
+
+  // Cutoff expressed as open-circuit voltage: the load current scales with the loaded voltage
+  float openVoltage = slot.dischargeVoltage + (slot.dischargeAmps * ohms);
+  float cutoffAmps  = slot.dischargeAmps * settings.defaultBatteryCutOffVoltage / slot.dischargeVoltage;
+  float cutoffSoc   = stateOfCharge(settings.defaultBatteryCutOffVoltage + (cutoffAmps * ohms));
+  float usableSoc   = slot.predictStartSoc - cutoffSoc;
+  float usedSoc     = slot.predictStartSoc - stateOfCharge(openVoltage);
+  float usedSocLow  = slot.predictStartSoc - stateOfCharge(openVoltage + settings.predictVoltageMargin);
+
+  if (usedSoc >= minimumSocUsed)
+  {
+    slot.predictCapacity = slot.dischargeMilliamps / usedSoc;
+    float predicted = slot.dischargeMilliamps * (usableSoc > usedSoc ? usableSoc / usedSoc : 1.0);
+    slot.predictedMilliamps = predicted > 9999 ? 9999 : (int16_t)predicted;
+  }
+  if (usedSocLow >= minimumSocUsed)
+  {
+    float predictedHigh = slot.dischargeMilliamps * (usableSoc > usedSocLow ? usableSoc / usedSocLow : 1.0);
+    slot.predictedMilliampsHigh = predictedHigh > 9999 ? 9999 : (int16_t)predictedHigh;
+  }
+}
+
+bool CycleEngine::capacityPredictionReject(uint8_t j)
+{
+  const CycleSlot &slot = slots[j];
+  if (!settings.predictEarlyAbort)
+    return false;
+  if (slot.dischargeMilliamps < settings.predictMinMilliamps || slot.predictedMilliampsHigh == 0)
+    return false;
+  return slot.predictedMilliampsHigh < settings.lowMilliamps;
+}
+
+// ----------------------
+// Adaptive rest
+//
+// Rest readings are averaged over restSampleSeconds windows. The rest ends
+// once the open-circuit voltage slope between windows drops below
+// restSettledSlope (after restMinSeconds), or after restTimeMinutes. The
+// check only ever shortens the rest: restTimeMinutes keeps the fixed one
+// minute rest of earlier firmware as the longest a cell waits.
+//
+// Relaxation follows V(t) = Vinf + A * e^(-t / tau), so the ratio of two
+// successive window deltas is e^(-window / tau). A settled cell leaves the
+// rest after two windows, too few for a ratio, so tau is taken from half
+// windows instead: the first estimate comes after three of them, and each
+// usable ratio is averaged by delta size into relaxationSeconds. It stays
+// -1 (unknown) when the deltas are lost in ADC noise.
+// ----------------------
+
+void CycleEngine::clearRelaxation(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  slot.restVoltageSum       = 0.0;
+  slot.restPreviousMean     = 0.0;
+  slot.restSamples          = 0;
+  slot.restWindows          = 0;
+  slot.restTauVoltageSum    = 0.0;
+  slot.restTauPreviousMean  = 0.0;
+  slot.restTauPreviousDelta = 0.0;
+  slot.restTauWeight        = 0.0;
+  slot.restTauSamples       = 0;
+  slot.restTauWindows       = 0;
+  slot.relaxationSeconds    = -1;
+}
+
+void CycleEngine::relaxationTau(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  const float   minimumDelta = 0.0015; // Deltas below ~1.5 mV are too close to ADC noise for a tau estimate
+  const uint8_t window       = settings.restSampleSeconds > 1 ? settings.restSampleSeconds / 2 : 1;
+
+  slot.restTauVoltageSum += slot.batteryVoltage;
+  slot.restTauSamples++;
+  if (slot.restTauSamples < window)
+    return;
+
+  float windowMean  = slot.restTauVoltageSum / slot.restTauSamples;
+  float windowDelta = windowMean - slot.restTauPreviousMean;
+  slot.restTauVoltageSum = 0.0;
+  slot.restTauSamples    = 0;
+
+  if (slot.restTauWindows > 1 && fabs(slot.restTauPreviousDelta) >= minimumDelta)
+  {
+    float ratio = windowDelta / slot.restTauPreviousDelta;
+    if (ratio > 0.05 && ratio < 0.98)
+    {
+      float tau    = -window / log(ratio);
+      float weight = fabs(slot.restTauPreviousDelta);
+      float mean   = slot.restTauWeight > 0.0 ? slot.relaxationSeconds : 0.0;
+      slot.relaxationSeconds = ((mean * slot.restTauWeight) + (tau * weight)) / (slot.restTauWeight + weight);
+      slot.restTauWeight += weight;
+    }
+  }
+  if (slot.restTauWindows > 0)
+    slot.restTauPreviousDelta = windowDelta;
+  slot.restTauPreviousMean = windowMean;
+  if (slot.restTauWindows < 255)
+    slot.restTauWindows++;
+}
+
+bool CycleEngine::relaxationSettled(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  bool settled = false;
+
+  if (slot.hours > 0 || slot.minutes >= settings.restTimeMinutes)
+    return true;
+
+  relaxationTau(j);
+  slot.restVoltageSum += slot.batteryVoltage;
+  slot.restSamples++;
+  if (slot.restSamples < settings.restSampleSeconds)
+    return false;
+
+  float windowMean = slot.restVoltageSum / slot.restSamples;
+  slot.restVoltageSum = 0.0;
+  slot.restSamples    = 0;
+
+  if (slot.restWindows > 0)
+  {
+    float slope = ((windowMean - slot.restPreviousMean) * 1000.0 * 60.0) / settings.restSampleSeconds; // mV per minute
+    settled = fabs(slope) <= settings.restSettledSlope;
+  }
+  slot.restPreviousMean = windowMean;
+  if (slot.restWindows < 255)
+    slot.restWindows++;
+
+  return settled && elapsedSeconds(j) >= settings.restMinSeconds;
+}
+
+// ----------------------
+// Storage finishing
+//
+// The recharge after the discharge and the storage state both run pulses
+// that alternate with storageRelaxSeconds rests. After each rest the
+// open-circuit voltage is compared to the target. The volts moved per pulse
+// second on the last pulse sizes the next pulse, scaled down so the recharge
+// approaches the target from below and the storage discharge from above. The
+// recharge ends within storageToleranceVoltage under the target (or when the
+// TP5100 finishes), so the storage state only bleeds off an overshoot.
+// ----------------------
+
+void CycleEngine::clearStorage(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  slot.storageLastVoltage  = 0.0;
+  slot.storageGain         = 0.0;
+  slot.storageCountdown    = settings.storageRelaxSeconds; // Relax first so the first check sees OCV
+  slot.storagePulseSeconds = 0;
+  slot.storageDischarging  = false;
+  slot.storageCharging     = false;
+}
+
+uint16_t CycleEngine::storagePulse(uint8_t j, float moved, float remaining, uint16_t maxSeconds)
+{
+  CycleSlot &slot = slots[j];
+
+  // Learn volts per pulse second from the last pulse
+  if (slot.storagePulseSeconds > 0 && moved > 0.0)
+    slot.storageGain = moved / slot.storagePulseSeconds;
+
+  float pulseSeconds = maxSeconds / 4;
+  if (slot.storageGain > 0.0)
+    pulseSeconds = (remaining / slot.storageGain) * 0.8;
+  if (pulseSeconds < 1)
+    pulseSeconds = 1;
+  if (pulseSeconds > maxSeconds)
+    pulseSeconds = maxSeconds;
+  slot.storagePulseSeconds = pulseSeconds;
+  return slot.storagePulseSeconds;
+}
+
+bool CycleEngine::storageChargeCycle(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+
+  if (slot.storageCountdown > 0)
+  {
+    slot.storageCountdown--;
+    slot.batteryVoltage = io.batteryVoltage(j);
+    if (slot.storageCharging)
+      slot.cycleCount += io.chargerDone(j);
+    if (slot.cycleCount >= 10)
+    {
+      // TP5100 finished first: the target is at or above a full cell, stop here rather than time out
+      slot.storageCharging = false;
+      return true;
+    }
+    return false;
+  }
+
+  if (slot.storageCharging)
+  {
+    // Pulse finished, let the cell relax before the next OCV check
+    io.setCharger(j, false);
+    slot.storageCharging  = false;
+    slot.storageCountdown = settings.storageRelaxSeconds;
+    return false;
+  }
+
+  float openVoltage = io.batteryVoltage(j);
+  slot.batteryVoltage = openVoltage;
+  if (openVoltage >= settings.storageChargeVoltage - settings.storageToleranceVoltage)
+    return true;
+
+  storagePulse(j, openVoltage - slot.storageLastVoltage, settings.storageChargeVoltage - openVoltage,
+               settings.storageMaxChargeSeconds);
+  slot.storageLastVoltage = openVoltage;
+
+  io.setCharger(j, true);
+  slot.storageCharging  = true;
+  slot.storageCountdown = slot.storagePulseSeconds;
+  return false;
+}
+
+bool CycleEngine::storageCycle(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+
+  if (slot.storageCountdown > 0)
+  {
+    slot.storageCountdown--;
+    slot.batteryVoltage = io.batteryVoltage(j);
+    if (slot.storageDischarging && slot.batteryVoltage < settings.defaultBatteryCutOffVoltage)
+      slot.storageCountdown = 0; // Never pull the loaded voltage below cutoff
+    return false;
+  }
+
+  if (slot.storageDischarging)
+  {
+    // Pulse finished, let the cell relax before the next OCV check
+    io.setDischarge(j, false);
+    slot.storageDischarging = false;
+    slot.storageCountdown   = settings.storageRelaxSeconds;
+    return false;
+  }
+
+  float openVoltage = io.batteryVoltage(j);
+  slot.batteryVoltage = openVoltage;
+  if (openVoltage <= settings.storageChargeVoltage + settings.storageToleranceVoltage)
+    return true;
+  if (slot.storagePulseSeconds > 0 && openVoltage >= slot.storageLastVoltage)
+    return true; // Last pulse shed nothing (cut short at cutoff), stop rather than loop
+
+  storagePulse(j, slot.storageLastVoltage - openVoltage, openVoltage - settings.storageChargeVoltage,
+               settings.storageMaxPulseSeconds);
+  slot.storageLastVoltage = openVoltage;
+
+  io.setDischarge(j, true);
+  slot.storageDischarging = true;
+  slot.storageCountdown   = slot.storagePulseSeconds;
+  return false;
+}
+
+// ----------------------
+// Grading
+//
+// Capacity, energy, internal resistance, peak temperature rise and charge
+// time are each checked against the A, B and C thresholds in settings. The
+// cell gets the lowest grade any value allows. Faulted cells and cells that
+// miss the C thresholds grade R (reject).
+// ----------------------
+
+char CycleEngine::gradeCell(uint8_t j)
+{
+  const CycleSlot &slot = slots[j];
+  const char grades[] = {'A', 'B', 'C'};
+  uint8_t tempRise = temperatureRise(j);
+
+  if (slot.batteryFaultCode != 0)
+    return 'R';
+
+  for (uint8_t g = 0; g < 3; g++)
+  {
+    if (slot.dischargeMilliamps >= settings.gradeMinMilliamps[g] &&
+        slot.dischargeMilliwattHours >= settings.gradeMinMilliwattHours[g] &&
+        slot.milliOhmsValue <= settings.gradeMaxMilliOhms[g] &&
+        tempRise <= settings.gradeMaxTempRise[g] &&
+        (int16_t)(slot.chargeSeconds / 60) <= settings.gradeMaxChargeMinutes[g])
+    {
+      return grades[g];
+    }
+  }
+  return 'R';
+}
@@ -0,0 +1,137 @@
+// CycleCheckpoint.cpp
+// Checkpoint policy and resume. A slot is due for a checkpoint whenever its
+// state, held insert event or admission wait changes, and every
+// checkpointMinutes while it sits in a long state (charge, rest, discharge,
+// recharge, storage). The caller owns the storage and decides how many
+// checkpoints to write per tick.
+
+#include "CycleEngine.h"
+
+#include <math.h>
+
+uint16_t CycleEngine::checkpointKeyOf(const CycleSlot &slot)
+{
+  // A phase waiting to carry on checkpoints as running, so giving way for the budget writes nothing
+  return slot.cycleState | (slot.pendingEvent << 4) | (slot.awaitingAdmission && !slot.admissionResumes ? 0x200 : 0);
+}
+
+bool CycleEngine::checkpointDue(uint8_t j) const
+{
+  const CycleSlot &slot = slots[j];
+
+  if (checkpointKeyOf(slot) != slot.checkpointKey)
+    return true;
+  if (settings.checkpointMinutes == 0 || slot.awaitingAdmission)
+    return false;
+  switch (slot.cycleState)
+  {
+  case CYCLE_CHARGE:
+  case CYCLE_REST:
+  case CYCLE_DISCHARGE:
+  case CYCLE_RECHARGE:
+  case CYCLE_STORAGE:
+    return (clock.millis() - slot.checkpointMillis) >= (settings.checkpointMinutes * 60000UL);
+  default:
+    return false;
+  }
+}
+
+void CycleEngine::checkpoint(uint8_t j, CycleCheckpoint &checkpoint)
+{
+  CycleSlot &slot = slots[j];
+
+  checkpoint.cycleState              = slot.cycleState;
+  checkpoint.batteryFaultCode        = slot.batteryFaultCode;
+  checkpoint.pendingEvent            = slot.pendingEvent;
+  checkpoint.awaitingAdmission       = slot.awaitingAdmission && !slot.admissionResumes;
+  checkpoint.elapsedSeconds          = elapsedSeconds(j);
+  checkpoint.batteryInitialVoltage   = slot.batteryInitialVoltage;
+  checkpoint.dischargeMilliamps      = slot.dischargeMilliamps;
+  checkpoint.dischargeMilliwattHours = slot.dischargeMilliwattHours;
+  checkpoint.milliOhmsValue          = (int16_t)slot.milliOhmsValue;
+  checkpoint.chargeSeconds           = slot.chargeSeconds;
+  checkpoint.batteryInitialTemp      = slot.batteryInitialTemp;
+  checkpoint.batteryHighestTemp      = slot.batteryHighestTemp;
+  checkpoint.cellGrade               = slot.cellGrade;
+  checkpoint.openMillivolts          = openMillivolts(j);
+
+  slot.checkpointKey    = checkpointKeyOf(slot);
+  slot.checkpointMillis = clock.millis();
+}
+
+uint16_t CycleEngine::openMillivolts(uint8_t j) const
+{
+  const CycleSlot &slot = slots[j];
+
+  // Under load the reading sits an IR drop below the OCV a reset leaves behind
+  if (slot.cycleState == CYCLE_DISCHARGE && slot.dischargeVoltage > 0.0)
+    return (slot.dischargeVoltage + slot.dischargeAmps * slot.milliOhmsValue / 1000.0) * 1000.0;
+  return slot.batteryVoltage * 1000.0;
+}
+
+bool CycleEngine::resume(uint8_t j, const CycleCheckpoint &checkpoint)
+{
+  CycleSlot &slot = slots[j];
+  uint32_t   now  = clock.millis();
+
+  // Before charging there is nothing to keep, and the barcode lookup has to be redone
+  if (checkpoint.cycleState < CYCLE_CHARGE || checkpoint.cycleState >= CYCLE_STATE_COUNT)
+    return false;
+  // The cell was removed, or swapped for one at another state of charge, while the board was off
+  if (!batteryCheck(j))
+    return false;
+  if (fabs(slots[j].batteryVoltage * 1000.0 - checkpoint.openMillivolts) > settings.resumeVoltageWindow * 1000.0)
+    return false;
+
+  initializeVariables(j);
+  slot.batteryBarcode          = true;
+  slot.cycleState              = checkpoint.cycleState;
+  slot.cycleCount              = 0;
+  slot.batteryFaultCode        = checkpoint.batteryFaultCode;
+  slot.pendingEvent            = checkpoint.pendingEvent;
+  slot.awaitingAdmission       = checkpoint.awaitingAdmission;
+  slot.admissionMillis         = now;
+
+  // A phase that was running goes back through the scheduler, so slots resumed together after a
+  // brown-out are staggered and budgeted again. Its enter handler already ran before the reset.
+  if (!slot.awaitingAdmission && slot.pendingEvent == EVENT_NONE &&
+      admissionGuarded(slot.cycleState))
+  {
+    slot.awaitingAdmission = true;
+    slot.admissionResumes  = true;
+  }
+  slot.batteryInitialVoltage   = checkpoint.batteryInitialVoltage;
+  slot.dischargeMilliamps      = checkpoint.dischargeMilliamps;
+  slot.dischargeMilliwattHours = checkpoint.dischargeMilliwattHours;
+  slot.milliOhmsValue          = checkpoint.milliOhmsValue;
+  slot.chargeSeconds           = checkpoint.chargeSeconds;
+  slot.batteryInitialTemp      = checkpoint.batteryInitialTemp;
+  slot.batteryHighestTemp      = checkpoint.batteryHighestTemp;
+  slot.batteryCurrentTemp      = io.temperature(j);
+  slot.cellGrade               = checkpoint.cellGrade;
+
+  // Timers carry on from the checkpoint; time spent off or in reset is not counted
+  slot.longMilliSecondsCleared  = now - (checkpoint.elapsedSeconds * 1000UL);
+  slot.longMilliSecondsPrevious = now;
+  slot.dischargeReadMillis      = now;
+  secondsTimer(j);
+
+  slot.checkpointKey    = checkpointKeyOf(slot);
+  slot.checkpointMillis = now;
+  return true;
+}
+
+void CycleEngine::resumeAdmitted(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  uint32_t   now  = clock.millis();
+
+  // Carry on from the checkpoint, the wait for admission is not phase time. A storage
+  // pulse cut short restarts with a rest, so the next OCV check sees a relaxed cell.
+  slot.admissionResumes         = false;
+  clearStorage(j);
+  slot.longMilliSecondsCleared += now - slot.admissionMillis;
+  slot.longMilliSecondsPrevious = now;
+  slot.dischargeReadMillis      = now;
+  secondsTimer(j);
+}
@@ -0,0 +1,29 @@
+// CycleCheckpoint.h
+// Per-slot snapshot saved to non-volatile storage so a cycle survives a reset.
+// Only what cannot be re-measured is kept; estimators (capacity fit,
+// relaxation, storage pulses) restart from scratch after a resume.
+
+#ifndef CYCLE_CHECKPOINT_H
+#define CYCLE_CHECKPOINT_H
+
+#include <stdint.h>
+
+struct CycleCheckpoint
+{
+  uint8_t  cycleState;
+  uint8_t  batteryFaultCode;
+  uint8_t  pendingEvent;
+  uint8_t  awaitingAdmission;
+  uint32_t elapsedSeconds;   // Time in the current state
+  float    batteryInitialVoltage;
+  float    dischargeMilliamps;
+  float    dischargeMilliwattHours;
+  int16_t  milliOhmsValue;
+  uint16_t chargeSeconds;
+  uint8_t  batteryInitialTemp;
+  uint8_t  batteryHighestTemp;
+  char     cellGrade;
+  uint16_t openMillivolts;   // Cell OCV when saved, tells a swapped cell from the same one on resume
+};
+
+#endif // CYCLE_CHECKPOINT_H
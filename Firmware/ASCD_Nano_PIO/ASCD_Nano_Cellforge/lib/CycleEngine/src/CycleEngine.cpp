@@ -0,0 +1,324 @@
+// CycleEngine.cpp
+// Engine core: state / transition tables, dispatch, timer and shared helpers.
+
+#include "CycleEngine.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define CYCLE_PROGMEM PROGMEM
+#define cycleReadByte(address) pgm_read_byte(address)
+#define cycleReadPtr(address)  pgm_read_ptr(address)
+#else
+#define CYCLE_PROGMEM
+#define cycleReadByte(address) (*(const uint8_t *)(address))
+#define cycleReadPtr(address)  (*(void *const *)(address))
+#endif
+
+// ----------------------
+// State handler table (indexed by CycleState)
+// ----------------------
+
+const CycleEngine::StateHandler CycleEngine::stateHandlers[CYCLE_STATE_COUNT] CYCLE_PROGMEM =
+{
+  {&CycleEngine::enterNone,      &CycleEngine::tickCheckBattery, 0},                                     // 0 Check Battery Voltage
+  {&CycleEngine::enterBarcode,   &CycleEngine::tickBarcode,      0},                                     // 1 Battery Barcode
+  {&CycleEngine::enterCharge,    &CycleEngine::tickCharge,       GUARD_ADMISSION | GUARD_TEMPERATURE | GUARD_CHARGE_TIMEOUT}, // 2 Charge Battery
+  {&CycleEngine::enterNone,      &CycleEngine::tickResistance,   GUARD_ADMISSION},                       // 3 Check Battery Milli Ohms
+  {&CycleEngine::enterRest,      &CycleEngine::tickRest,         0},                                     // 4 Rest Battery
+  {&CycleEngine::enterDischarge, &CycleEngine::tickDischarge,    GUARD_ADMISSION | GUARD_TEMPERATURE},   // 5 Discharge Battery
+  {&CycleEngine::enterRecharge,  &CycleEngine::tickRecharge,     GUARD_ADMISSION | GUARD_TEMPERATURE | GUARD_CHARGE_TIMEOUT}, // 6 Recharge Battery
+  {&CycleEngine::enterCompleted, &CycleEngine::tickCompleted,    0},                                     // 7 Completed
+  {&CycleEngine::enterStorage,   &CycleEngine::tickStorage,      GUARD_ADMISSION | GUARD_TEMPERATURE}   // 8 Storage Battery
+};
+
+// ----------------------
+// Transition table: state + event -> next state, fault code, insert handshake
+// ----------------------
+
+const CycleEngine::Transition CycleEngine::transitions[] CYCLE_PROGMEM =
+{
+  {CYCLE_CHECK_BATTERY, EVENT_BATTERY_INSERTED,            CYCLE_BARCODE,       0, false},
+  {CYCLE_BARCODE,       EVENT_BARCODE_SCANNED,             CYCLE_CHARGE,        0, false},
+  {CYCLE_BARCODE,       EVENT_BATTERY_REMOVED,             CYCLE_CHECK_BATTERY, 0, false},
+  {CYCLE_CHARGE,        EVENT_CHARGED,                     CYCLE_RESISTANCE,    0, true},
+  {CYCLE_CHARGE,        EVENT_OVER_TEMPERATURE,            CYCLE_COMPLETED,     7, true},  // High Temperature
+  {CYCLE_CHARGE,        EVENT_CHARGE_TIMEOUT,              CYCLE_COMPLETED,     9, true},  // Charging Timeout
+  {CYCLE_RESISTANCE,    EVENT_HIGH_RESISTANCE,             CYCLE_COMPLETED,     3, false}, // High Milli Ohms
+  {CYCLE_RESISTANCE,    EVENT_RESISTANCE_MEASURED,         CYCLE_REST,          0, false},
+  {CYCLE_RESISTANCE,    EVENT_RESISTANCE_MEASURED_RESTED,  CYCLE_DISCHARGE,     0, false},
+  {CYCLE_REST,          EVENT_RESTED,                      CYCLE_DISCHARGE,     0, false},
+  {CYCLE_DISCHARGE,     EVENT_OVER_TEMPERATURE,            CYCLE_COMPLETED,     7, true},  // High Temperature
+  {CYCLE_DISCHARGE,     EVENT_PREDICTED_LOW_CAPACITY,      CYCLE_COMPLETED,     6, true},  // Predicted Low Milliamps
+  {CYCLE_DISCHARGE,     EVENT_LOW_CAPACITY,                CYCLE_COMPLETED,     5, true},  // Low Milliamps
+  {CYCLE_DISCHARGE,     EVENT_DISCHARGED,                  CYCLE_RECHARGE,      0, true},
+  {CYCLE_RECHARGE,      EVENT_OVER_TEMPERATURE,            CYCLE_COMPLETED,     7, true},  // High Temperature
+  {CYCLE_RECHARGE,      EVENT_CHARGE_TIMEOUT,              CYCLE_COMPLETED,     9, true},  // Charging Timeout
+  {CYCLE_RECHARGE,      EVENT_CHARGED,                     CYCLE_COMPLETED,     0, true},
+  {CYCLE_RECHARGE,      EVENT_CHARGED_TO_STORAGE,          CYCLE_STORAGE,       0, true},
+  {CYCLE_STORAGE,       EVENT_OVER_TEMPERATURE,            CYCLE_COMPLETED,     7, true},  // High Temperature
+  {CYCLE_STORAGE,       EVENT_STORAGE_REACHED,             CYCLE_COMPLETED,     0, true},
+  {CYCLE_COMPLETED,     EVENT_BATTERY_REMOVED,             CYCLE_CHECK_BATTERY, 0, false}
+};
+
+CycleEngine::CycleEngine(CycleSlot *slots, uint8_t slotCount, const CycleSettings &settings, CycleIO &io, CycleClock &clock)
+  : slots(slots), count(slotCount), settings(settings), io(io), clock(clock),
+    startMillis(0), lastStartMillis(0), cellsCompleted(0), cellsOverTemperature(0), started(false)
+{
+}
+
+void CycleEngine::tick()
+{
+  for (uint8_t j = 0; j < count; j++)
+  {
+    tickSlot(j);
+  }
+}
+
+void CycleEngine::tickSlot(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+
+  if (!started)
+  {
+    startMillis     = clock.millis();
+    lastStartMillis = startMillis - (settings.phaseStaggerSeconds * 1000UL); // First start is not staggered
+    started         = true;
+  }
+
+  // Charged to the state the tick starts in, state 0 only once a cell is seen
+  uint8_t account    = slot.cycleState;
+  uint8_t cellChecks = slot.cycleCount;
+
+  if (slot.awaitingAdmission)
+  {
+    // Outputs are off, start the phase once the scheduler has room for it
+    account = ACCOUNT_ADMISSION;
+    if (admit(j))
+    {
+      EnterHandler enterHandler = (EnterHandler)cycleReadPtr(&stateHandlers[slot.cycleState].enter);
+      slot.awaitingAdmission = false;
+      if (slot.admissionResumes)
+        resumeAdmitted(j);
+      else
+        enterHandler(*this, j);
+    }
+  }
+  else if (slot.pendingEvent != EVENT_NONE)
+  {
+    // Outputs are already off, wait for the server to acknowledge the data insert
+    account = ACCOUNT_INSERT;
+    if (slot.insertData)
+    {
+      Transition transition;
+      slot.insertData = false;
+      if (findTransition(slot.cycleState, slot.pendingEvent, transition))
+        enterState(j, transition.nextState);
+      else
+        slot.pendingEvent = EVENT_NONE;
+    }
+  }
+  else if (slot.cycleState < CYCLE_STATE_COUNT)
+  {
+    const StateHandler *handler = &stateHandlers[slot.cycleState];
+    uint8_t    guards = cycleReadByte(&handler->guards);
+    CycleEvent event  = EVENT_NONE;
+
+    if ((guards & GUARD_TEMPERATURE) && processTemperature(j) == 2)
+    {
+      // Battery Temperature is >= MAX Threshold considered faulty
+      outputsOff(j);
+      event = EVENT_OVER_TEMPERATURE;
+    }
+    else if ((guards & GUARD_CHARGE_TIMEOUT) && slot.hours >= settings.chargingTimeout)
+    {
+      // Either battery will not hold charge, has high capacity or the TP5100 is faulty
+      outputsOff(j);
+      event = EVENT_CHARGE_TIMEOUT;
+    }
+    else if ((guards & GUARD_ADMISSION) && overBudget(j))
+    {
+      // The derated budget no longer holds the running phases: give way and carry on once admitted again
+      outputsOff(j);
+      slot.dischargeAmps     = 0.0; // Load off, and the first reading after the wait comes at once
+      slot.awaitingAdmission = true;
+      slot.admissionResumes  = true;
+      slot.admissionMillis   = clock.millis();
+    }
+    else
+    {
+      TickHandler tickHandler = (TickHandler)cycleReadPtr(&handler->tick);
+      event = tickHandler(*this, j);
+    }
+
+    if (event != EVENT_NONE)
+      dispatch(j, event);
+  }
+  if (account == CYCLE_CHECK_BATTERY && slot.cycleState == CYCLE_CHECK_BATTERY && slot.cycleCount == cellChecks)
+    account = ACCOUNT_EMPTY;
+  if (account < ACCOUNT_COUNT)
+    slot.accountSeconds[account]++;
+  secondsTimer(j);
+}
+
+void CycleEngine::dispatch(uint8_t j, CycleEvent event)
+{
+  CycleSlot &slot = slots[j];
+  Transition transition;
+
+  if (!findTransition(slot.cycleState, event, transition))
+    return;
+
+  if (transition.faultCode != 0)
+    slot.batteryFaultCode = transition.faultCode;
+
+  if (transition.needsInsert)
+  {
+    // Clear any stale acknowledgement so only a reply to this request commits the transition
+    slot.insertData   = false;
+    slot.pendingEvent = event;
+  }
+  else
+  {
+    enterState(j, transition.nextState);
+  }
+}
+
+void CycleEngine::enterState(uint8_t j, uint8_t state)
+{
+  CycleSlot &slot = slots[j];
+
+  slot.cycleState   = state;
+  slot.cycleCount   = 0; // Reset cycleCount for use in other Cycles
+  slot.pendingEvent = EVENT_NONE;
+
+  if (admissionGuarded(state))
+  {
+    // Enter handler runs from tickSlot() once the scheduler admits the slot
+    slot.awaitingAdmission = true;
+    slot.admissionMillis   = clock.millis();
+    return;
+  }
+
+  EnterHandler enterHandler = (EnterHandler)cycleReadPtr(&stateHandlers[state].enter);
+  enterHandler(*this, j);
+}
+
+bool CycleEngine::admissionGuarded(uint8_t state) const
+{
+  return cycleReadByte(&stateHandlers[state].guards) & GUARD_ADMISSION;
+}
+
+bool CycleEngine::findTransition(uint8_t state, uint8_t event, Transition &transition) const
+{
+  for (uint8_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++)
+  {
+    if (cycleReadByte(&transitions[i].state) == state && cycleReadByte(&transitions[i].event) == event)
+    {
+      transition.state       = state;
+      transition.event       = event;
+      transition.nextState   = cycleReadByte(&transitions[i].nextState);
+      transition.faultCode   = cycleReadByte(&transitions[i].faultCode);
+      transition.needsInsert = cycleReadByte(&transitions[i].needsInsert);
+      return true;
+    }
+  }
+  return false;
+}
+
+// ----------------------
+// Shared helpers
+// ----------------------
+
+uint32_t CycleEngine::elapsedSeconds(uint8_t j) const
+{
+  return slots[j].seconds + (slots[j].minutes * 60UL) + (slots[j].hours * 3600UL);
+}
+
+uint8_t CycleEngine::temperatureRise(uint8_t j) const
+{
+  const CycleSlot &slot = slots[j];
+  if (slot.batteryHighestTemp > slot.batteryInitialTemp && slot.batteryHighestTemp != 99)
+    return slot.batteryHighestTemp - slot.batteryInitialTemp;
+  return 0;
+}
+
+void CycleEngine::secondsTimer(uint8_t j)
+{
+  uint32_t longMilliSecondsCount = clock.millis() - slots[j].longMilliSecondsCleared;
+  slots[j].hours   = longMilliSecondsCount / (1000UL * 60UL * 60UL);
+  slots[j].minutes = (longMilliSecondsCount % (1000UL * 60UL * 60UL)) / (1000UL * 60UL);
+  slots[j].seconds = (longMilliSecondsCount % (1000UL * 60UL)) / 1000UL;
+}
+
+void CycleEngine::clearSecondsTimer(uint8_t j)
+{
+  slots[j].longMilliSecondsCleared = clock.millis();
+  slots[j].seconds = 0;
+  slots[j].minutes = 0;
+  slots[j].hours   = 0;
+}
+
+void CycleEngine::initializeVariables(uint8_t j)
+{
+  // Reset per-cycle values
+  CycleSlot &slot = slots[j];
+  slot.batteryBarcode           = false;
+  slot.insertData               = false;
+  slot.pendingEvent             = EVENT_NONE;
+  slot.resultReady              = false;
+  slot.awaitingAdmission        = false;
+  slot.admissionResumes         = false;
+  slot.tempMilliOhmsValue       = 0;
+  slot.milliOhmsValue           = 0;
+  slot.longMilliSecondsPrevious = 0;
+  slot.dischargeMilliamps       = 0.0;
+  slot.dischargeMilliwattHours  = 0.0;
+  slot.dischargeVoltage         = 0.00;
+  slot.dischargeAmps            = 0.00;
+  slot.hardwareCutoff           = false;
+  slot.cutoffReady              = false;
+  slot.cutoffMillis             = 0;
+  slot.batteryFaultCode         = 0;
+  slot.batteryInitialTemp       = 0;
+  slot.batteryCurrentTemp       = 0;
+  slot.batteryHighestTemp       = 0;
+  slot.chargeSeconds            = 0;
+  slot.cellGrade                = 0;
+  clearCapacityPrediction(j);
+  clearRelaxation(j);
+  clearStorage(j);
+}
+
+bool CycleEngine::batteryCheck(uint8_t j)
+{
+  slots[j].batteryVoltage = io.batteryVoltage(j);
+  return slots[j].batteryVoltage > settings.batteryVolatgeLeak;
+}
+
+uint8_t CycleEngine::processTemperature(uint8_t j)
+{
+  CycleSlot &slot = slots[j];
+  uint8_t ambient = io.ambientTemperature();
+
+  slot.batteryCurrentTemp = io.temperature(j);
+
+  // Track highest temp (except invalid 99)
+  if (slot.batteryCurrentTemp > slot.batteryHighestTemp && slot.batteryCurrentTemp != 99)
+    slot.batteryHighestTemp = slot.batteryCurrentTemp;
+
+  if (slot.batteryCurrentTemp == 99 || slot.batteryCurrentTemp <= ambient)
+    return 0; // Within safe range
+  if ((slot.batteryCurrentTemp - ambient) > settings.tempMaxThreshold)
+    return 2; // Above maximum threshold = fault
+  if ((slot.batteryCurrentTemp - ambient) > settings.tempThreshold)
+    return 1; // Above warning threshold (no current action)
+  return 0;
+}
+
+void CycleEngine::outputsOff(uint8_t j)
+{
+  io.setCharger(j, false);
+  io.setDischarge(j, false);
+  slots[j].storageDischarging = false;
+  slots[j].storageCharging    = false;
+}
@@ -0,0 +1,147 @@
+// CycleEngine.h
+// Table driven charge / IR / rest / discharge cycle for the ASCD Nano slots.
+//
+// The engine owns no hardware: readings, MOSFET outputs and time come from
+// the injected CycleIO and CycleClock, so the same code runs on the Nano and
+// in host builds. Each state has a handler row (enter, tick, guards) and each
+// handler returns a CycleEvent that the transition table maps to the next
+// state and fault code. Transitions that report data to the server are held
+// in slot.pendingEvent until slot.insertData is set by the acknowledgement.
+
+#ifndef CYCLE_ENGINE_H
+#define CYCLE_ENGINE_H
+
+#include <stdint.h>
+
+#include "CycleCheckpoint.h"
+#include "CycleIO.h"
+#include "CycleSettings.h"
+#include "CycleSlot.h"
+
+class CycleEngine
+{
+public:
+  CycleEngine(CycleSlot *slots, uint8_t slotCount, const CycleSettings &settings, CycleIO &io, CycleClock &clock);
+
+  void tick();              // Advance every slot by one cycle tick (called once per second)
+  void tickSlot(uint8_t j); // Advance one slot
+
+  bool     awaitingInsert(uint8_t j) const { return slots[j].pendingEvent != EVENT_NONE; }
+  uint32_t elapsedSeconds(uint8_t j) const;
+  uint8_t  temperatureRise(uint8_t j) const;
+  uint8_t  slotCount() const { return count; }
+
+  // Throughput since the first tick (per slot: slot.cellsCompleted, and slot.accountSeconds by CycleAccount)
+  uint16_t completedCells() const { return cellsCompleted; }
+  uint16_t thermalFaults() const { return cellsOverTemperature; }
+  float    cellsPerHour() const;
+
+  // Checkpoints: save when due, resume a slot from the newest saved checkpoint
+  bool checkpointDue(uint8_t j) const;
+  void checkpoint(uint8_t j, CycleCheckpoint &checkpoint);
+  bool resume(uint8_t j, const CycleCheckpoint &checkpoint);
+
+private:
+  typedef CycleEvent (*TickHandler)(CycleEngine &engine, uint8_t j);
+  typedef void (*EnterHandler)(CycleEngine &engine, uint8_t j);
+
+  struct StateHandler
+  {
+    EnterHandler enter;
+    TickHandler  tick;
+    uint8_t      guards; // GUARD_* checks run before the tick handler
+  };
+
+  struct Transition
+  {
+    uint8_t state;
+    uint8_t event;
+    uint8_t nextState;
+    uint8_t faultCode;   // 0 leaves the fault code unchanged
+    bool    needsInsert; // Hold until the server acknowledges the data insert
+  };
+
+  enum
+  {
+    GUARD_TEMPERATURE    = 0x01,
+    GUARD_CHARGE_TIMEOUT = 0x02,
+    GUARD_ADMISSION      = 0x04  // Enter handler waits for the scheduler
+  };
+
+  static const StateHandler stateHandlers[CYCLE_STATE_COUNT];
+  static const Transition   transitions[];
+
+  CycleSlot           *slots;
+  uint8_t              count;
+  const CycleSettings &settings;
+  CycleIO             &io;
+  CycleClock          &clock;
+  uint32_t             startMillis;
+  uint32_t             lastStartMillis;      // Last charge / discharge phase start
+  uint16_t             cellsCompleted;
+  uint16_t             cellsOverTemperature;
+  bool                 started;
+
+  void dispatch(uint8_t j, CycleEvent event);
+  void enterState(uint8_t j, uint8_t state);
+  bool findTransition(uint8_t state, uint8_t event, Transition &transition) const;
+  bool admissionGuarded(uint8_t state) const;
+
+  // CycleCheckpoint.cpp
+  static uint16_t checkpointKeyOf(const CycleSlot &slot);
+  uint16_t        openMillivolts(uint8_t j) const;
+  void            resumeAdmitted(uint8_t j);
+
+  // CycleScheduler.cpp: phase admission against the current and thermal budget
+  bool  admit(uint8_t j);
+  bool  olderWaiter(uint8_t j) const;
+  bool  overBudget(uint8_t j) const;
+  float budgetScale() const;
+  float slotDischargeAmps(uint8_t j) const;
+
+  // CycleEngine.cpp: shared helpers
+  void    secondsTimer(uint8_t j);
+  void    clearSecondsTimer(uint8_t j);
+  void    initializeVariables(uint8_t j);
+  bool    batteryCheck(uint8_t j);
+  uint8_t processTemperature(uint8_t j);
+  void    outputsOff(uint8_t j);
+
+  // CycleHandlers.cpp: per-state handlers
+  static void       enterNone(CycleEngine &engine, uint8_t j);
+  static void       enterBarcode(CycleEngine &engine, uint8_t j);
+  static void       enterCharge(CycleEngine &engine, uint8_t j);
+  static void       enterRest(CycleEngine &engine, uint8_t j);
+  static void       enterDischarge(CycleEngine &engine, uint8_t j);
+  static void       enterRecharge(CycleEngine &engine, uint8_t j);
+  static void       enterCompleted(CycleEngine &engine, uint8_t j);
+  static void       enterStorage(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickCheckBattery(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickBarcode(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickCharge(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickResistance(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickRest(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickDischarge(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickRecharge(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickCompleted(CycleEngine &engine, uint8_t j);
+  static CycleEvent tickStorage(CycleEngine &engine, uint8_t j);
+
+  // CycleAnalysis.cpp: measurement and estimation helpers
+  float milliOhms(uint8_t j);
+  bool  dischargeCycle(uint8_t j);
+  void  clearCapacityPrediction(uint8_t j);
+  void  updateCapacityPrediction(uint8_t j);
+  float stateOfCharge(float openVoltage) const;
+  float openCircuitVoltage(float soc) const;
+  bool  capacityPredictionReject(uint8_t j);
+  void  clearRelaxation(uint8_t j);
+  bool  relaxationSettled(uint8_t j);
+  void  relaxationTau(uint8_t j);
+  void  clearStorage(uint8_t j);
+  bool  storageCycle(uint8_t j);
+  bool  storageChargeCycle(uint8_t j);
+  uint16_t storagePulse(uint8_t j, float moved, float remaining, uint16_t maxSeconds);
+  char  gradeCell(uint8_t j);
+};
+
+#endif // CYCLE_ENGINE_H
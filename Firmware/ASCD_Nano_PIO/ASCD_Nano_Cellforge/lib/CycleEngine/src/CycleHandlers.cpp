@@ -0,0 +1,204 @@
+// CycleHandlers.cpp
+// Per-state enter and tick handlers. Tick handlers return the event that
+// ends their state (or EVENT_NONE); the temperature and charge timeout checks
+// are applied by the engine from the state's guard flags.
+
+#include "CycleEngine.h"
+
+// ----------------------
+// Enter handlers (run once when the state is committed)
+// ----------------------
+
+void CycleEngine::enterNone(CycleEngine &engine, uint8_t j)
+{
+  (void)engine;
+  (void)j;
+}
+
+void CycleEngine::enterBarcode(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  engine.initializeVariables(j);
+  slot.batteryCurrentTemp = engine.io.temperature(j);
+  slot.batteryInitialTemp = slot.batteryCurrentTemp;
+  slot.batteryHighestTemp = slot.batteryCurrentTemp;
+  engine.clearSecondsTimer(j);
+  slot.batteryVoltage        = engine.io.batteryVoltage(j); // Get battery voltage for Charge Cycle
+  slot.batteryInitialVoltage = slot.batteryVoltage;
+}
+
+void CycleEngine::enterCharge(CycleEngine &engine, uint8_t j)
+{
+  engine.clearSecondsTimer(j);
+  engine.slots[j].batteryInitialVoltage = engine.slots[j].batteryVoltage; // Reset Initial voltage
+}
+
+void CycleEngine::enterRest(CycleEngine &engine, uint8_t j)
+{
+  engine.clearSecondsTimer(j);
+  engine.clearRelaxation(j);
+}
+
+void CycleEngine::enterDischarge(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  engine.clearSecondsTimer(j);
+  slot.batteryInitialVoltage    = slot.batteryVoltage; // Reset Initial voltage
+  slot.longMilliSecondsPrevious = engine.clock.millis();
+  slot.dischargeReadMillis      = slot.longMilliSecondsPrevious;
+}
+
+void CycleEngine::enterRecharge(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  slot.batteryVoltage        = engine.io.batteryVoltage(j); // Get battery voltage for Recharge Cycle
+  slot.batteryInitialVoltage = slot.batteryVoltage;         // Reset Initial voltage
+  engine.clearSecondsTimer(j);
+  engine.clearStorage(j);
+}
+
+void CycleEngine::enterCompleted(CycleEngine &engine, uint8_t j)
+{
+  engine.clearSecondsTimer(j);
+  engine.slots[j].cellGrade   = engine.gradeCell(j);
+  engine.slots[j].resultReady = true;
+  engine.cellsCompleted++;
+  engine.slots[j].cellsCompleted++;
+  if (engine.slots[j].batteryFaultCode == 7)
+    engine.cellsOverTemperature++;
+}
+
+void CycleEngine::enterStorage(CycleEngine &engine, uint8_t j)
+{
+  engine.clearSecondsTimer(j);
+  engine.clearStorage(j);
+}
+
+// ----------------------
+// Tick handlers (run once per second while in the state)
+// ----------------------
+
+CycleEvent CycleEngine::tickCheckBattery(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  if (engine.batteryCheck(j))
+    slot.cycleCount++;
+  if (slot.cycleCount >= 5)
+    return EVENT_BATTERY_INSERTED;
+  return EVENT_NONE;
+}
+
+CycleEvent CycleEngine::tickBarcode(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  slot.batteryVoltage = engine.io.batteryVoltage(j);
+  if (slot.batteryBarcode)
+    return EVENT_BARCODE_SCANNED;
+
+  // Check if battery has been removed
+  if (!engine.batteryCheck(j))
+    slot.cycleCount++;
+  if (slot.cycleCount >= 5)
+    return EVENT_BATTERY_REMOVED;
+  return EVENT_NONE;
+}
+
+CycleEvent CycleEngine::tickCharge(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  slot.batteryVoltage = engine.io.batteryVoltage(j);
+  engine.io.setCharger(j, true); // Turn on TP5100
+  slot.cycleCount += engine.io.chargerDone(j);
+  if (slot.cycleCount < 10)
+    return EVENT_NONE;
+
+  engine.io.setCharger(j, false); // Turn off TP5100
+  slot.chargeSeconds = engine.elapsedSeconds(j);
+  return EVENT_CHARGED;
+}
+
+CycleEvent CycleEngine::tickResistance(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  slot.tempMilliOhmsValue += engine.milliOhms(j);
+  slot.cycleCount++;
+  if (slot.cycleCount < 4)
+    return EVENT_NONE;
+
+  slot.milliOhmsValue = slot.tempMilliOhmsValue / 4;
+  if (slot.milliOhmsValue > engine.settings.highMilliOhms)
+    return EVENT_HIGH_RESISTANCE;
+  if (slot.chargeSeconds < 120) // No need to rest the battery if it is already charged
+    return EVENT_RESISTANCE_MEASURED_RESTED;
+  return EVENT_RESISTANCE_MEASURED;
+}
+
+CycleEvent CycleEngine::tickRest(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  slot.batteryVoltage     = engine.io.batteryVoltage(j);
+  slot.batteryCurrentTemp = engine.io.temperature(j);
+  if (engine.relaxationSettled(j)) // Open circuit voltage has settled or the maximum rest time has passed
+    return EVENT_RESTED;
+  return EVENT_NONE;
+}
+
+CycleEvent CycleEngine::tickDischarge(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+
+  if (engine.capacityPredictionReject(j)) // Upper capacity bound is already below lowMilliamps
+  {
+    engine.io.setDischarge(j, false);
+    return EVENT_PREDICTED_LOW_CAPACITY;
+  }
+
+  if (engine.dischargeCycle(j))
+    slot.cycleCount++;
+  if (slot.cycleCount < 10 && !slot.hardwareCutoff) // A hardware cutoff needs no confirming readings
+    return EVENT_NONE;
+
+  engine.io.setDischarge(j, false); // Turn off Discharge Mosfet
+  if (slot.dischargeMilliamps < engine.settings.lowMilliamps) // No need to recharge the battery if it has low Milliamps
+    return EVENT_LOW_CAPACITY;
+  return EVENT_DISCHARGED;
+}
+
+CycleEvent CycleEngine::tickRecharge(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+
+  if (engine.settings.storageChargeVoltage > 0.00) // Charge pulses up to the storage OCV, not to full
+  {
+    if (!engine.storageChargeCycle(j))
+      return EVENT_NONE;
+    engine.io.setCharger(j, false); // Turn off TP5100
+    return EVENT_CHARGED_TO_STORAGE;
+  }
+
+  slot.batteryVoltage = engine.io.batteryVoltage(j);
+  engine.io.setCharger(j, true); // Turn on TP5100
+  slot.cycleCount += engine.io.chargerDone(j);
+  if (slot.cycleCount < 10)
+    return EVENT_NONE;
+
+  engine.io.setCharger(j, false); // Turn off TP5100
+  return EVENT_CHARGED;
+}
+
+CycleEvent CycleEngine::tickCompleted(CycleEngine &engine, uint8_t j)
+{
+  CycleSlot &slot = engine.slots[j];
+  if (!engine.batteryCheck(j))
+    slot.cycleCount++;
+  if (slot.cycleCount >= 2)
+    return EVENT_BATTERY_REMOVED;
+  return EVENT_NONE;
+}
+
+CycleEvent CycleEngine::tickStorage(CycleEngine &engine, uint8_t j)
+{
+  if (engine.storageCycle(j))
+    return EVENT_STORAGE_REACHED;
+  return EVENT_NONE;
+}
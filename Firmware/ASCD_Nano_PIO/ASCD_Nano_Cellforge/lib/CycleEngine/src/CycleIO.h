@@ -0,0 +1,37 @@
+// CycleIO.h
+// Hardware and clock interfaces injected into the cycle engine.
+// The firmware implements them on the mux / 74HC595 / DS18B20; host builds use fakes.
+
+#ifndef CYCLE_IO_H
+#define CYCLE_IO_H
+
+#include <stdint.h>
+
+class CycleIO
+{
+public:
+  virtual float   batteryVoltage(uint8_t slot) = 0;     // Calibrated battery voltage (V)
+  virtual float   shuntVoltage(uint8_t slot) = 0;       // Calibrated shunt / voltage drop channel (V)
+  virtual bool    chargerDone(uint8_t slot) = 0;        // TP5100 charge LED reports charge complete
+  virtual void    setCharger(uint8_t slot, bool on) = 0;
+  virtual void    setDischarge(uint8_t slot, bool on) = 0;
+  virtual uint8_t temperature(uint8_t slot) = 0;        // Cell temperature (C), 99 = invalid
+  virtual uint8_t ambientTemperature() = 0;             // Board ambient temperature (C)
+
+  // Hardware cutoff: true once if the discharge MOSFET was opened below cutoff
+  // between readings, with the millis() of the trip. Boards without one keep the default.
+  virtual bool dischargeTripped(uint8_t slot, uint32_t &tripMillis)
+  {
+    (void)slot;
+    (void)tripMillis;
+    return false;
+  }
+};
+
+class CycleClock
+{
+public:
+  virtual uint32_t millis() = 0;
+};
+
+#endif // CYCLE_IO_H
@@ -0,0 +1,140 @@
+// CycleScheduler.cpp
+// Slot scheduler. Charge, IR, discharge and storage phases are entered through
+// admit(): the slot waits with its outputs off until the phase fits the
+// discharge current and charger budgets, both derated by board (ambient)
+// temperature. Charge and discharge starts are staggered so the heat load
+// ramps instead of stepping, and the longest waiting slot goes first.
+// Running phases are not derated, but at boardTempLimit they all give way
+// (outputs off, back to waiting) and are admitted again, staggered, once the
+// board has cooled below it.
+
+#include "CycleEngine.h"
+
+namespace
+{
+
+// Slots compete only with slots waiting for the same kind of phase
+uint8_t phaseClass(uint8_t state)
+{
+  if (state == CYCLE_RECHARGE)
+    return CYCLE_CHARGE;
+  if (state == CYCLE_STORAGE)
+    return CYCLE_DISCHARGE;
+  return state;
+}
+
+bool charging(const CycleSlot &slot)
+{
+  return (slot.cycleState == CYCLE_CHARGE || slot.cycleState == CYCLE_RECHARGE) && !slot.awaitingAdmission;
+}
+
+// A storage slot keeps its share between pulses, the next one needs no admission
+bool discharging(const CycleSlot &slot)
+{
+  return phaseClass(slot.cycleState) == CYCLE_DISCHARGE && !slot.awaitingAdmission;
+}
+
+} // namespace
+
+bool CycleEngine::admit(uint8_t j)
+{
+  const CycleSlot &slot = slots[j];
+  uint32_t now   = clock.millis();
+  float    scale = budgetScale();
+
+  if (olderWaiter(j))
+    return false;
+
+  if (slot.cycleState == CYCLE_RESISTANCE)
+  {
+    // One IR measurement at a time so a neighbour's load step does not skew the reading
+    for (uint8_t k = 0; k < count; k++)
+    {
+      if (k != j && slots[k].cycleState == CYCLE_RESISTANCE && !slots[k].awaitingAdmission)
+        return false;
+    }
+    return true;
+  }
+
+  if (scale <= 0.0 || (now - lastStartMillis) < (settings.phaseStaggerSeconds * 1000UL))
+    return false;
+
+  if (phaseClass(slot.cycleState) == CYCLE_DISCHARGE)
+  {
+    float   amps   = slotDischargeAmps(j);
+    uint8_t active = 0;
+    for (uint8_t k = 0; k < count; k++)
+    {
+      if (k != j && discharging(slots[k]))
+      {
+        amps += slotDischargeAmps(k);
+        active++;
+      }
+    }
+    // A single slot always runs, even if it alone is over the budget
+    if (active > 0 && amps > settings.dischargeBudgetAmps * scale)
+      return false;
+  }
+  else
+  {
+    uint8_t active = 1;
+    for (uint8_t k = 0; k < count; k++)
+    {
+      if (k != j && charging(slots[k]))
+        active++;
+    }
+    if (active > 1 && active > settings.chargeBudgetSlots * scale)
+      return false;
+  }
+
+  lastStartMillis = now;
+  return true;
+}
+
+bool CycleEngine::olderWaiter(uint8_t j) const
+{
+  const CycleSlot &slot = slots[j];
+  for (uint8_t k = 0; k < count; k++)
+  {
+    const CycleSlot &other = slots[k];
+    if (k == j || !other.awaitingAdmission || phaseClass(other.cycleState) != phaseClass(slot.cycleState))
+      continue;
+    int32_t age = (int32_t)(slot.admissionMillis - other.admissionMillis);
+    if (age > 0 || (age == 0 && k < j))
+      return true;
+  }
+  return false;
+}
+
+bool CycleEngine::overBudget(uint8_t j) const
+{
+  // The IR check is a few seconds of load, not worth interrupting
+  return slots[j].cycleState != CYCLE_RESISTANCE && budgetScale() <= 0.0;
+}
+
+float CycleEngine::budgetScale() const
+{
+  uint8_t ambient = io.ambientTemperature();
+
+  if (ambient == 99 || ambient <= settings.boardTempDerate)
+    return 1.0; // Unknown or cool board: full budget
+  if (ambient >= settings.boardTempLimit)
+    return 0.0;
+  return (float)(settings.boardTempLimit - ambient) / (settings.boardTempLimit - settings.boardTempDerate);
+}
+
+float CycleEngine::slotDischargeAmps(uint8_t j) const
+{
+  // Measured current once discharging, else the expected load current from the last voltage
+  if (slots[j].cycleState == CYCLE_DISCHARGE && slots[j].dischargeAmps > 0.0)
+    return slots[j].dischargeAmps;
+  return slots[j].batteryVoltage / settings.shuntResistor[j];
+}
+
+float CycleEngine::cellsPerHour() const
+{
+  float hours = (clock.millis() - startMillis) / 3600000.0;
+  if (!started || hours <= 0.0)
+    return 0.0;
+  return cellsCompleted / hours;
+}
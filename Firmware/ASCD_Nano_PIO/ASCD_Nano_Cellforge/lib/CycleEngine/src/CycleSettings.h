@@ -0,0 +1,54 @@
+// CycleSettings.h
+// Thresholds and timings used by the cycle state machine.
+// Defaults match the ASCD Nano hardware; override fields before the first tick.
+
+#ifndef CYCLE_SETTINGS_H
+#define CYCLE_SETTINGS_H
+
+#include <stdint.h>
+
+struct CycleSettings
+{
+  float    shuntResistor[4]            = {3.3, 3.3, 3.3, 3.3};
+  float    defaultBatteryCutOffVoltage = 2.8;
+  uint8_t  restTimeMinutes             = 1;     // Longest rest before discharge, even if the cell is still relaxing
+  uint8_t  restMinSeconds              = 30;    // Shortest rest before the relaxation check may end it
+  uint8_t  restSampleSeconds           = 20;    // Rest readings are averaged over windows of this length
+  float    restSettledSlope            = 5.0;   // Rest ends once |dV/dt| falls below this (mV per minute)
+  int16_t  lowMilliamps                = 1000;
+  int16_t  highMilliOhms               = 500;
+  int16_t  offsetMilliOhms             = 0;
+  uint8_t  chargingTimeout             = 8;
+  uint8_t  tempThreshold               = 7;
+  uint8_t  tempMaxThreshold            = 20;
+  float    batteryVolatgeLeak          = 0.50;
+  uint16_t dischargeReadInterval       = 5000;
+  float    storageChargeVoltage        = 0.00;  // Storage target OCV, 0.00 disables storage finishing
+  float    storageToleranceVoltage     = 0.02;  // Storage finishing ends once OCV is within this of the target
+  uint8_t  storageRelaxSeconds         = 15;    // Relaxation before each storage OCV check
+  uint8_t  storageMaxPulseSeconds      = 120;   // Longest storage discharge pulse between OCV checks
+  uint16_t storageMaxChargeSeconds     = 600;   // Longest storage recharge pulse between OCV checks
+  // Grade thresholds for A, B and C (a cell gets the lowest grade any value allows, else R)
+  int16_t  gradeMinMilliamps[3]        = {2500, 2000, 1500};
+  int16_t  gradeMinMilliwattHours[3]   = {9000, 7200, 5400};
+  int16_t  gradeMaxMilliOhms[3]        = {60, 100, 150};
+  uint8_t  gradeMaxTempRise[3]         = {8, 12, 16};     // Peak rise above the initial temperature (C)
+  int16_t  gradeMaxChargeMinutes[3]    = {180, 240, 300};
+  bool     predictEarlyAbort           = true;  // End discharge early when the predicted capacity cannot reach lowMilliamps
+  int16_t  predictMinMilliamps         = 300;   // mAh discharged before the capacity prediction is trusted
+  uint8_t  predictMinSamples           = 36;    // Discharge readings before the load step gives the effective resistance (~3 min)
+  float    predictVoltageMargin        = 0.03;  // OCV error allowed for the upper capacity bound (V)
+  // NMC 18650 open-circuit voltage at 0 %, 10 % ... 100 % state of charge (mV)
+  uint16_t ocvCurveMillivolts[11]      = {3000, 3450, 3550, 3620, 3680, 3740, 3820, 3900, 3980, 4070, 4200};
+  // Slot scheduler: charge, IR and discharge phases start only when the budget allows
+  float    dischargeBudgetAmps         = 5.0;   // Total discharge current across slots: four fresh cells at 4.2 V (~1.3 A each) do
+                                                // not all start at once, the fourth joins once the others have sagged
+  uint8_t  chargeBudgetSlots           = 4;     // TP5100s charging at once
+  uint8_t  boardTempDerate             = 40;    // Ambient (C) above which the budgets shrink linearly
+  uint8_t  boardTempLimit              = 50;    // Ambient (C) at which no new charge or discharge starts and running ones pause
+  uint8_t  phaseStaggerSeconds         = 30;    // Least time between charge / discharge starts on different slots
+  uint8_t  checkpointMinutes           = 3;     // Checkpoint interval in long states (state changes are always saved)
+  float    resumeVoltageWindow         = 0.30;  // A checkpoint resumes only if the cell reads within this of its saved OCV (V)
+};
+
+#endif // CYCLE_SETTINGS_H
@@ -0,0 +1,143 @@
+// CycleSlot.h
+// Per-slot cycle state, cycle states and transition events.
+
+#ifndef CYCLE_SLOT_H
+#define CYCLE_SLOT_H
+
+#include <stdint.h>
+
+// Cycle states (reported to the server as &CS<slot>=<state>)
+enum CycleState : uint8_t
+{
+  CYCLE_CHECK_BATTERY = 0,
+  CYCLE_BARCODE       = 1,
+  CYCLE_CHARGE        = 2,
+  CYCLE_RESISTANCE    = 3,
+  CYCLE_REST          = 4,
+  CYCLE_DISCHARGE     = 5,
+  CYCLE_RECHARGE      = 6,
+  CYCLE_COMPLETED     = 7,
+  CYCLE_STORAGE       = 8,
+  CYCLE_STATE_COUNT
+};
+
+// Events returned by the state handlers and looked up in the transition table
+enum CycleEvent : uint8_t
+{
+  EVENT_NONE = 0,
+  EVENT_BATTERY_INSERTED,
+  EVENT_BATTERY_REMOVED,
+  EVENT_BARCODE_SCANNED,
+  EVENT_CHARGED,
+  EVENT_CHARGED_TO_STORAGE,
+  EVENT_OVER_TEMPERATURE,
+  EVENT_CHARGE_TIMEOUT,
+  EVENT_HIGH_RESISTANCE,
+  EVENT_RESISTANCE_MEASURED,
+  EVENT_RESISTANCE_MEASURED_RESTED, // Charge was short, the cell is already rested
+  EVENT_RESTED,
+  EVENT_DISCHARGED,
+  EVENT_LOW_CAPACITY,
+  EVENT_PREDICTED_LOW_CAPACITY,
+  EVENT_STORAGE_REACHED
+};
+
+// Time accounting buckets, one per engine tick. CYCLE_CHECK_BATTERY ..
+// CYCLE_STORAGE count the ticks a slot spends in that state (state 0: only
+// while confirming an inserted cell), the rest the ticks it is empty or held.
+enum CycleAccount : uint8_t
+{
+  ACCOUNT_EMPTY = CYCLE_STATE_COUNT, // State 0, no cell
+  ACCOUNT_ADMISSION,                 // Held by the scheduler before a phase (&WA)
+  ACCOUNT_INSERT,                    // Waiting for the server to acknowledge the data insert (&ID)
+  ACCOUNT_COUNT
+};
+
+struct CycleSlot
+{
+  // Timer
+  uint32_t longMilliSecondsCleared;
+  uint8_t  seconds;
+  uint8_t  minutes;
+  uint8_t  hours;
+
+  // Module Cycle
+  uint8_t  cycleCount;
+  bool     batteryBarcode;
+  bool     insertData;
+  uint8_t  cycleState;
+  uint8_t  batteryFaultCode;
+  uint8_t  pendingEvent;      // Transition held until the server acknowledges the data insert
+  bool     resultReady;       // Grade computed, result record not sent yet
+  bool     awaitingAdmission; // State entered, held by the scheduler until the budget allows it
+  uint32_t admissionMillis;   // When the slot started waiting, oldest waiter goes first
+  bool     admissionResumes;  // Waiting to continue a phase resumed from a checkpoint, entered before the reset
+  uint16_t checkpointKey;     // State / pending event / admission at the last checkpoint
+  uint32_t checkpointMillis;  // When the last checkpoint was taken
+
+  // Voltage Readings
+  float    batteryInitialVoltage;
+  float    batteryVoltage;
+
+  // Temperature Readings
+  uint8_t  batteryInitialTemp;
+  uint8_t  batteryHighestTemp;
+  uint8_t  batteryCurrentTemp;
+
+  // Milli Ohms
+  float    tempMilliOhmsValue;
+  float    milliOhmsValue;
+
+  // Discharge
+  uint32_t longMilliSecondsPrevious; // Last capacity integration
+  uint32_t dischargeReadMillis;      // Last discharge reading
+  float    dischargeMilliamps;
+  float    dischargeMilliwattHours;
+  float    dischargeVoltage;
+  float    dischargeAmps;
+  bool     hardwareCutoff;    // Discharge ended by the hardware cutoff
+  bool     cutoffReady;       // Cutoff captured, cutoff record not sent yet
+  uint32_t cutoffMillis;      // Hardware cutoff time since the discharge started
+
+  // Grading
+  uint16_t chargeSeconds;
+  char     cellGrade;
+
+  // Capacity Prediction (IR-compensated OCV against the OCV-SoC curve)
+  float    predictStartSoc;       // State of charge of the rested OCV the discharge started from
+  float    predictStepVoltage;    // Loaded voltage, current and mAh once the polarisation has built up
+  float    predictStepAmps;
+  float    predictStepMilliamps;
+  float    predictOhms;           // Effective resistance: IR plus polarisation under load
+  float    predictCapacity;       // Full capacity of the last estimate (mAh), 0 until known
+  uint8_t  predictSamples;
+  int16_t  predictedMilliamps;
+  int16_t  predictedMilliampsHigh;
+
+  // Rest Relaxation
+  float    restVoltageSum;
+  float    restPreviousMean;
+  uint8_t  restSamples;
+  uint8_t  restWindows;
+  float    restTauVoltageSum;     // Tau uses half windows, so it has estimates before the rest can end
+  float    restTauPreviousMean;
+  float    restTauPreviousDelta;
+  float    restTauWeight;
+  uint8_t  restTauSamples;
+  uint8_t  restTauWindows;
+  int16_t  relaxationSeconds;     // -1 until the first estimate
+
+  // Storage Finishing
+  float    storageLastVoltage;
+  float    storageGain;
+  uint16_t storageCountdown;
+  uint16_t storagePulseSeconds;
+  bool     storageDischarging;
+  bool     storageCharging;
+
+  // Accounting (since power-on, kept from cell to cell)
+  uint32_t accountSeconds[ACCOUNT_COUNT]; // Ticks per CycleAccount bucket
+  uint16_t cellsCompleted;                // Cells graded in this slot
+};
+
+#endif // CYCLE_SLOT_H
@@ -0,0 +1,233 @@
+// LogDecode.cpp
+// Turns the binary log frames in a USB serial capture back into text, using
+// the format strings of src/LogTokens.h that the firmware never stores.
+// Every other line, telemetry included, passes through untouched, and any
+// prefix in front of a frame (the [hh:mm:ss.mmm] of the simulator, the
+// epoch milliseconds of a fleetd unit log) is kept:
+//
+//   [00:00:00.112] LOG WARN CALIBRATION: calibration invalid, defaults loaded
+//
+//   pio run -e logdecode && .pio/build/logdecode/program [-l] [capture.log...]
+//   (or) g++ -O2 -std=gnu++11 -Isrc logdecode/LogDecode.cpp -o logdecode
+//
+//   -l  print only the log lines
+//
+// Reads standard input when no capture is given, so it also sits behind a
+// serial monitor. A token the table does not know (capture from a newer
+// firmware) is printed as its number and raw bytes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "LogTokens.h"
+
+namespace
+{
+
+const unsigned char frameStart = 0x1E;
+const unsigned char escape     = 0x1B;
+
+struct Token
+{
+  const char *name;
+  LogModule   module;
+  int         level;
+  const char *format;
+};
+
+#define TOKEN_ENTRY(name, module, level, format) {#name, LOG_MODULE_##module, level, format},
+const Token tokens[] = {LOG_TOKENS(TOKEN_ENTRY)};
+#undef TOKEN_ENTRY
+
+#define MODULE_NAME(name) #name,
+const char *const moduleNames[] = {LOG_MODULES_TABLE(MODULE_NAME)};
+#undef MODULE_NAME
+
+const char *const levelNames[] = {"OFF", "ERROR", "WARN", "INFO", "DEBUG"};
+
+// Little-endian argument of `bytes` bytes, sign extended when asked
+bool takeArgument(const std::string &frame, size_t &at, int bytes, bool isSigned, uint32_t &value)
+{
+  if (at + bytes > frame.size())
+    return false;
+  value = 0;
+  for (int b = 0; b < bytes; b++)
+    value |= (uint32_t)(unsigned char)frame[at + b] << (8 * b);
+  at += bytes;
+  if (isSigned && bytes < 4 && (value & (1UL << (8 * bytes - 1))))
+    value |= ~0UL << (8 * bytes);
+  return true;
+}
+
+// Expands `format` with the arguments in frame[at...], false if the frame ran short
+bool expand(const char *format, const std::string &frame, size_t at, std::string &text)
+{
+  char piece[64];
+  for (const char *c = format; *c; c++)
+  {
+    if (*c != '%')
+    {
+      text += *c;
+      continue;
+    }
+    if (c[1] == '%')
+    {
+      text += '%';
+      c++;
+      continue;
+    }
+
+    // Flags and width are kept, the length modifier only sets the size on the wire
+    std::string spec = "%";
+    for (c++; strchr("0123456789.-+ #", *c) && *c; c++)
+      spec += *c;
+    int bytes = 2;
+    if (*c == 'l')
+    {
+      bytes = 4;
+      c++;
+    }
+    else if (c[0] == 'h' && c[1] == 'h')
+    {
+      bytes = 1;
+      c += 2;
+    }
+    char conversion = *c;
+    if (conversion == 'c')
+      bytes = 1;
+    else if (conversion == 'f')
+      bytes = 4;
+    else if (!conversion)
+      break;
+
+    uint32_t value;
+    if (!takeArgument(frame, at, bytes, conversion == 'd' || conversion == 'i', value))
+      return false;
+    if (conversion == 'f')
+    {
+      float number;
+      memcpy(&number, &value, sizeof(number));
+      snprintf(piece, sizeof(piece), (spec + 'f').c_str(), number);
+    }
+    else if (conversion == 'c')
+    {
+      snprintf(piece, sizeof(piece), (spec + 'c').c_str(), (int)value);
+    }
+    else if (conversion == 'd' || conversion == 'i')
+    {
+      snprintf(piece, sizeof(piece), (spec + "ld").c_str(), (long)(int32_t)value);
+    }
+    else
+    {
+      snprintf(piece, sizeof(piece), (spec + 'l' + conversion).c_str(), (unsigned long)value);
+    }
+    text += piece;
+  }
+  return at == frame.size();
+}
+
+// Text for one frame (escapes already removed)
+std::string decode(const std::string &frame)
+{
+  char        head[96];
+  std::string text;
+  unsigned    id = frame.empty() ? 0 : (unsigned char)frame[0];
+  if (frame.empty() || id >= sizeof(tokens) / sizeof(tokens[0]))
+  {
+    snprintf(head, sizeof(head), "LOG ? token %u:", id);
+    text = head;
+    for (size_t i = 1; i < frame.size(); i++)
+    {
+      snprintf(head, sizeof(head), " %02x", (unsigned char)frame[i]);
+      text += head;
+    }
+    return text;
+  }
+
+  const Token &token = tokens[id];
+  snprintf(head, sizeof(head), "LOG %s %s: ", levelNames[token.level], moduleNames[token.module]);
+  text = head;
+  if (!expand(token.format, frame, 1, text))
+  {
+    snprintf(head, sizeof(head), " (%s frame of %u bytes does not match its format)", token.name,
+             (unsigned)frame.size());
+    text += head;
+  }
+  return text;
+}
+
+void decodeStream(FILE *input, bool logOnly)
+{
+  std::string line;
+  int         c;
+  do
+  {
+    c = fgetc(input);
+    if (c != '\n' && c != EOF)
+    {
+      line += (char)c;
+      continue;
+    }
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+
+    size_t start = line.find((char)frameStart);
+    if (start != std::string::npos)
+    {
+      std::string frame;
+      for (size_t i = start + 1; i < line.size(); i++)
+      {
+        unsigned char b = line[i];
+        if (b == escape && i + 1 < line.size())
+          b = line[++i] ^ 0x20;
+        frame += (char)b;
+      }
+      printf("%s%s\n", line.substr(0, start).c_str(), decode(frame).c_str());
+    }
+    else if (!logOnly && (c != EOF || !line.empty()))
+    {
+      printf("%s\n", line.c_str());
+    }
+    line.clear();
+  } while (c != EOF);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  bool logOnly = false;
+  int  first   = 1;
+  if (first < argc && strcmp(argv[first], "-l") == 0)
+  {
+    logOnly = true;
+    first++;
+  }
+  if (first < argc && argv[first][0] == '-' && argv[first][1] != '\0')
+  {
+    fprintf(stderr, "usage: %s [-l] [capture.log...]\n", argv[0]);
+    return 2;
+  }
+
+  if (first == argc)
+  {
+    decodeStream(stdin, logOnly);
+    return 0;
+  }
+  for (int i = first; i < argc; i++)
+  {
+    FILE *input = strcmp(argv[i], "-") == 0 ? stdin : fopen(argv[i], "rb");
+    if (!input)
+    {
+      fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[i]);
+      return 2;
+    }
+    decodeStream(input, logOnly);
+    if (input != stdin)
+      fclose(input);
+  }
+  return 0;
+}
@@ -0,0 +1,426 @@
+// ReplayLog.cpp
+
+#include "ReplayLog.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace replay
+{
+
+namespace
+{
+
+const uint32_t ticksPerFrame = 4;    // sendSerial() every 4000 ms, cycleStateValues() every 1000 ms
+const uint8_t  insertTicks   = 5;    // tickCheckBattery() / tickBarcode() count to 5
+const uint8_t  removeTicks   = 2;    // tickCompleted() counts to 2
+const uint8_t  doneTicks     = 10;   // tickCharge() / tickRecharge() count to 10
+const uint8_t  restWindow    = 20;   // CycleSettings::restSampleSeconds
+const uint8_t  readInterval  = 5;    // CycleSettings::dischargeReadInterval, s
+const int      smoothSpan    = 3;    // Discharge readings either side in the local line fit
+const float    halfStep      = 0.005f; // %d.%02d truncates, the reading was up to 10 mV / 10 mA higher
+const float    ampsTrim      = 0.01f;  // Most the current is scaled to follow &MA, the 10 mA step at ~1 A
+
+// Splits the capture timestamp off the line. Returns the text, sets time and
+// millis (-1 if the line has none).
+const char *splitTime(const char *line, std::string &time, long long &millis)
+{
+  millis = -1;
+  time.clear();
+  if (line[0] == '[')
+  {
+    const char *end = strstr(line, "] ");
+    unsigned    hours, minutes, seconds, ms;
+    if (end && sscanf(line, "[%u:%u:%u.%u]", &hours, &minutes, &seconds, &ms) == 4)
+    {
+      time.assign(line + 1, end - line - 1);
+      millis = ((hours * 60LL + minutes) * 60 + seconds) * 1000 + ms;
+      return end + 2;
+    }
+    return line;
+  }
+  const char *digits = line;
+  while (*digits >= '0' && *digits <= '9')
+    digits++;
+  if (digits > line && *digits == ' ')
+  {
+    time.assign(line, digits - line);
+    millis = atoll(line);
+    return digits + 1;
+  }
+  return line;
+}
+
+// &<key><slot>[=<value>] fields of a telemetry frame
+void parseFrame(const char *text, Frame &frame)
+{
+  for (const char *field = strchr(text, '&'); field; field = strchr(field + 1, '&'))
+  {
+    const char *key = field + 1;
+    if (strncmp(key, "AT=", 3) == 0)
+    {
+      frame.ambient = atoi(key + 3);
+      continue;
+    }
+    int slot = key[2] - '0';
+    if (slot < 0 || slot >= slotCount)
+      continue;
+    SlotFrame  &s     = frame.slots[slot];
+    const char *value = key[3] == '=' ? key + 4 : "";
+    if (strncmp(key, "CS", 2) == 0)
+      s.state = atoi(value);
+    else if (strncmp(key, "WA", 2) == 0)
+      s.waiting = true;
+    else if (strncmp(key, "ID", 2) == 0)
+      s.insert = true;
+    else if (strncmp(key, "CV", 2) == 0)
+      s.volts = atof(value) + halfStep;
+    else if (strncmp(key, "IV", 2) == 0)
+      s.initialVolts = atof(value) + halfStep;
+    else if (strncmp(key, "DA", 2) == 0)
+      s.amps = atof(value) > 0 ? atof(value) + halfStep : 0.0f; // 0.00 is the MOSFET off
+    else if (strncmp(key, "MA", 2) == 0)
+      s.milliamps = atoi(value);
+    else if (strncmp(key, "CT", 2) == 0)
+      s.temperature = atoi(value);
+    else if (strncmp(key, "IT", 2) == 0)
+      s.initialTemp = atoi(value);
+    else if (strncmp(key, "MO", 2) == 0)
+      s.milliOhms = atoi(value);
+    else if (strncmp(key, "TI", 2) == 0)
+      s.elapsed = atoi(value);
+    else if (strncmp(key, "FC", 2) == 0)
+      s.faultCode = atoi(value);
+  }
+}
+
+// Replies, scanner and result lines, kept for the next frame
+void parseLine(const char *text, Frame &next)
+{
+  int slot;
+  if (sscanf(text, "BARCODE_CONTINUE_%d", &slot) == 1 && slot >= 0 && slot < slotCount)
+    next.barcodeFound |= 1 << slot;
+  else if (sscanf(text, "INSERT_DATA_SUCCESSFUL_%d", &slot) == 1 && slot >= 0 && slot < slotCount)
+    next.insertAcked |= 1 << slot;
+  else if (strncmp(text, "BC", 2) == 0 && text[2] >= '0' && text[2] < '0' + slotCount && strncmp(text + 3, "=OK", 3) == 0)
+    next.scanned |= 1 << (text[2] - '0');
+  else if (strncmp(text, "&CO", 3) == 0 && text[3] >= '0' && text[3] < '0' + slotCount && text[4] == '=')
+    next.cutoffMillis[text[3] - '0'] = atol(text + 5);
+  else if (strncmp(text, "&RR", 3) == 0 && text[3] >= '0' && text[3] < '0' + slotCount && text[4] == '=')
+  {
+    SlotResult result;
+    int        mwh, mohm, rise, minutes;
+    if (sscanf(text + 5, "%c,%d,%d,%d,%d,%d,%d", &result.grade, &result.milliamps, &mwh, &mohm, &rise, &minutes,
+               &result.faultCode) == 7)
+      next.results[text[3] - '0'].push_back(result);
+  }
+}
+
+// Engine ticks between two frames
+uint32_t ticksBetween(const Frame &previous, const Frame &frame, long long previousMillis, long long millis)
+{
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    const SlotFrame &a = previous.slots[j], &b = frame.slots[j];
+    if (a.state == b.state && !a.waiting && !b.waiting && a.elapsed >= 0 && b.elapsed > a.elapsed &&
+        b.elapsed - a.elapsed <= 60)
+      return b.elapsed - a.elapsed;
+  }
+  if (previousMillis >= 0 && millis > previousMillis)
+  {
+    long long ticks = (millis - previousMillis + 500) / 1000;
+    return ticks > 0 ? (uint32_t)ticks : 1;
+  }
+  return ticksPerFrame;
+}
+
+// Reading n moved onto the line fitted through its neighbours, but kept inside the 10 mV / 10 mA
+// it was truncated to, so thresholds fall on the same reading
+void smoothReadings(std::vector<float> &values, const std::vector<bool> &valid)
+{
+  std::vector<float> raw = values;
+  int                count = (int)raw.size();
+  for (int n = 0; n < count; n++)
+  {
+    if (!valid[n] || raw[n] <= 0)
+      continue;
+    double sum = 0, sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (int m = std::max(0, n - smoothSpan); m <= std::min(count - 1, n + smoothSpan); m++)
+    {
+      if (!valid[m] || raw[m] <= 0)
+        continue;
+      sum++;
+      sumX += m - n;
+      sumY += raw[m];
+      sumXX += (m - n) * (m - n);
+      sumXY += (m - n) * raw[m];
+    }
+    double denominator = sum * sumXX - sumX * sumX;
+    if (sum < 3 || denominator <= 0)
+      continue;
+    double fitted = (sumY * sumXX - sumX * sumXY) / denominator; // Line at m = n
+    values[n]     = std::min(raw[n] + halfStep * 0.99f, std::max(raw[n] - halfStep, (float)fitted));
+  }
+}
+
+// Discharge readings are taken every readInterval ticks from the first discharge tick and each one shows
+// in the next frame. The truncation steps would widen the capacity prediction bound, so the readings
+// are smoothed before they are fed back on their own ticks. A reading no frame shows, such as the one
+// the discharge ended on when the next frame already has the MOSFET off, holds the one before it.
+void dischargeReadings(Capture &capture, uint8_t j, float shuntResistor)
+{
+  const std::vector<Frame> &frames = capture.frames;
+  for (size_t k = 0; k < frames.size();)
+  {
+    const SlotFrame &s = frames[k].slots[j];
+    if (s.state != 5 || s.waiting || s.elapsed < 0 || frames[k].tick < (uint32_t)s.elapsed)
+    {
+      k++;
+      continue;
+    }
+    uint32_t start = frames[k].tick - s.elapsed; // enterDischarge()
+    size_t   last  = k;
+    while (last + 1 < frames.size() && frames[last + 1].slots[j].state == 5 && !frames[last + 1].slots[j].waiting)
+      last++;
+
+    size_t             count = frames[last].tick > start ? (frames[last].tick - start - 1) / readInterval + 1 : 0;
+    std::vector<float> volts(count), amps(count);
+    std::vector<bool>  valid(count, false);
+    size_t counted = count;        // Reading the last &MA of the loaded discharge was sent after
+    int    countedMilliamps = -1;
+    for (size_t m = k; m <= last; m++)
+    {
+      const SlotFrame &frame = frames[m].slots[j];
+      if (frames[m].tick > start && !frame.insert && frame.milliamps >= 0)
+      {
+        counted          = (frames[m].tick - start - 1) / readInterval;
+        countedMilliamps = frame.milliamps;
+      }
+      if (frames[m].tick <= start || frame.volts < 0 || frame.amps < 0)
+        continue;
+      // Discharge ended on this frame's ticks and the MOSFET is off: the last loaded reading carries on
+      if (frame.insert && frame.amps == 0)
+        continue;
+      size_t n = (frames[m].tick - start - 1) / readInterval;
+      volts[n] = frame.volts;
+      amps[n]  = frame.amps;
+      valid[n] = true;
+    }
+    smoothReadings(volts, valid);
+    smoothReadings(amps, valid);
+    for (size_t n = 1; n < count; n++)
+    {
+      if (valid[n] || !valid[n - 1])
+        continue;
+      volts[n] = volts[n - 1];
+      amps[n]  = amps[n - 1];
+      valid[n] = true;
+    }
+
+    // The 10 mA steps of &DA add up to mAh over a discharge, enough to move a decision taken at an
+    // mAh threshold by a reading. Scale the current so the replay has counted what &MA showed.
+    if (counted < count && countedMilliamps > 0)
+    {
+      double replayed = 0;
+      for (size_t n = 1; n <= counted; n++)
+        replayed += valid[n] ? amps[n] * readInterval / 3.6 : 0.0;
+      if (replayed > 0)
+      {
+        float scale = std::min(1.0f + ampsTrim, std::max(1.0f - ampsTrim, (float)((countedMilliamps + 0.5) / replayed)));
+        for (size_t n = 0; n < count; n++)
+          amps[n] *= scale;
+      }
+    }
+    for (size_t n = 0; n < count; n++)
+    {
+      if (!valid[n])
+        continue;
+      uint32_t first = start + 1 + n * readInterval;
+      for (uint32_t t = first; t < first + readInterval && t <= frames[last].tick; t++)
+      {
+        TickInput &input  = capture.inputs[t * slotCount + j];
+        input.volts       = volts[n];
+        input.loadedVolts = volts[n];
+        input.shuntVolts  = volts[n] - amps[n] * shuntResistor;
+      }
+    }
+    k = last + 1;
+  }
+}
+
+void buildInputs(Capture &capture, float shuntResistor)
+{
+  std::vector<Frame> &frames = capture.frames;
+  uint32_t            ticks  = frames.back().tick + 1;
+  capture.inputs.assign((size_t)ticks * slotCount, TickInput());
+  capture.ambients.assign(ticks, 22);
+
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    // Voltage and temperature of the cell going in, taken from the phase that follows
+    // (&IV / &IT of the charge), for the states that do not report them
+    std::vector<float> aheadVolts(frames.size());
+    std::vector<int>   aheadTemp(frames.size());
+    float              volts = 0;
+    int                temp  = -1;
+    for (size_t k = frames.size(); k-- > 0;)
+    {
+      const SlotFrame &s = frames[k].slots[j];
+      if (s.state == 0 && !s.waiting)
+      {
+        volts = 0;
+        temp  = -1;
+      }
+      if (s.initialVolts >= 0)
+        volts = s.initialVolts;
+      else if (s.volts >= 0)
+        volts = s.volts;
+      if (s.initialTemp >= 0)
+        temp = s.initialTemp;
+      else if (s.temperature >= 0)
+        temp = s.temperature;
+      aheadVolts[k] = volts;
+      aheadTemp[k]  = temp;
+    }
+
+    // Readings held back over the ticks of their frame
+    uint32_t first = 0;
+    for (size_t k = 0; k < frames.size(); k++)
+    {
+      const Frame     &frame = frames[k];
+      const SlotFrame &s     = frame.slots[j];
+      TickInput        input;
+      input.volts       = s.volts >= 0 ? s.volts : (s.state == 0 ? 0.0f : aheadVolts[k]);
+      input.loadedVolts = input.volts;
+      if (s.state == 3 && s.milliOhms > 0)
+        input.loadedVolts = input.volts * shuntResistor / (shuntResistor + s.milliOhms / 1000.0f);
+      input.shuntVolts  = s.state == 5 && s.amps >= 0 ? input.volts - s.amps * shuntResistor : input.volts;
+      int temperature   = s.temperature >= 0 ? s.temperature : aheadTemp[k] >= 0 ? aheadTemp[k] : frame.ambient;
+      input.temperature = temperature >= 0 && temperature < 256 ? temperature : 99;
+      input.chargerDone = false;
+      for (uint32_t t = first; t <= frame.tick; t++)
+      {
+        capture.inputs[t * slotCount + j] = input;
+        if (j == 0 && frame.ambient >= 0)
+          capture.ambients[t] = frame.ambient;
+      }
+      first = frame.tick + 1;
+    }
+
+    // Inputs the telemetry does not carry, set on the ticks before the recorded transitions
+    auto set = [&](uint32_t tick, uint8_t count, float volts, bool done) {
+      for (uint32_t t = tick >= count - 1u ? tick - (count - 1u) : 0; t <= tick; t++)
+      {
+        TickInput &input = capture.inputs[t * slotCount + j];
+        if (done)
+        {
+          input.chargerDone = true;
+        }
+        else
+        {
+          input.volts       = volts;
+          input.loadedVolts = volts;
+          input.shuntVolts  = volts;
+        }
+      }
+    };
+    for (size_t k = 1; k < frames.size(); k++)
+    {
+      const SlotFrame &a = frames[k - 1].slots[j], &b = frames[k].slots[j];
+      uint32_t         tick = frames[k].tick;
+      if (a.state == 0 && b.state > 0)
+      {
+        // Straight through state 1 (scanned barcode): inserted a tick before the charge started
+        uint32_t inserted = tick;
+        if (b.state > 1)
+          inserted = b.state == 2 && !b.waiting && b.elapsed >= 0 && tick > (uint32_t)b.elapsed ? tick - b.elapsed - 1
+                                                                                              : tick - 1;
+        set(std::max(inserted, frames[k - 1].tick + 1), insertTicks, aheadVolts[k], false);
+      }
+      else if (a.state == 1 && b.state == 0)
+        set(tick, insertTicks, 0.0f, false);
+      else if (a.state == 7 && b.state == 0)
+        set(tick, removeTicks, 0.0f, false);
+
+      // Charge ended: the first frame asking for the insert, unless the phase ended on a fault
+      bool charging = (a.state == 2 || a.state == 6) && !a.waiting;
+      if (charging && !a.insert && b.state == a.state && b.insert)
+      {
+        size_t m = k;
+        while (m < frames.size() && frames[m].slots[j].state == a.state)
+          m++;
+        const SlotFrame *after = m < frames.size() ? &frames[m].slots[j] : 0;
+        if (!after || after->state != 7 || (a.state == 6 && after->faultCode == 0))
+          set(tick, doneTicks, 0.0f, true);
+      }
+
+      // Rest: the 10 mV telemetry cannot show the slope relaxationSettled() sees, so the voltage
+      // falls steeply until the last two windows before the recorded end and is flat across them
+      if (a.state == 4 && b.state != 4 && a.elapsed >= 0)
+      {
+        uint32_t restStart = frames[k - 1].tick - a.elapsed;
+        uint32_t settled   = restStart + (tick - restStart) / restWindow * restWindow;
+        uint32_t flat      = settled > frames[k - 1].tick && settled >= restStart + 2 * restWindow
+                               ? settled - 2 * restWindow : tick;
+        float    level     = a.volts;
+        for (uint32_t t = restStart + 1; t <= tick; t++)
+        {
+          TickInput &input  = capture.inputs[t * slotCount + j];
+          input.volts       = level + (t < flat ? 0.002f * (flat - t) : 0.0f);
+          input.loadedVolts = input.volts;
+          input.shuntVolts  = input.volts;
+        }
+      }
+    }
+    dischargeReadings(capture, j, shuntResistor);
+  }
+}
+
+} // namespace
+
+bool readCapture(const std::string &path, float shuntResistor, Capture &capture)
+{
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file)
+    return false;
+
+  capture.frames.clear();
+  Frame       next;
+  long long   previousMillis = -1;
+  char        line[1024];
+  size_t      number = 0;
+  std::string time;
+  while (fgets(line, sizeof(line), file))
+  {
+    number++;
+    line[strcspn(line, "\r\n")] = '\0';
+    long long   millis;
+    const char *text = splitTime(line, time, millis);
+    if (strncmp(text, "&AT=", 4) != 0)
+    {
+      parseLine(text, next);
+      continue;
+    }
+
+    Frame &frame = next;
+    frame.line   = number;
+    frame.time   = time;
+    parseFrame(text, frame);
+    frame.tick = capture.frames.empty() ? 0 : capture.frames.back().tick +
+                 ticksBetween(capture.frames.back(), frame, previousMillis, millis);
+    previousMillis = millis;
+    capture.frames.push_back(frame);
+    next = Frame();
+  }
+  fclose(file);
+
+  if (capture.frames.empty())
+    return false;
+  buildInputs(capture, shuntResistor);
+  return true;
+}
+
+} // namespace replay
@@ -0,0 +1,98 @@
+// ReplayLog.h
+// Reads a USB serial capture of the firmware (raw, "[hh:mm:ss.mmm] " from
+// the simulator's -v, or "<epoch ms> " from fleetd's unit logs) and rebuilds
+// the inputs of every cycle engine tick from it.
+//
+// The firmware ticks the engine once a second but sends a telemetry frame
+// only every 4 s, so each frame stands for the ticks since the previous one
+// (counted from &TI, else the timestamps, else 4). Readings are held from
+// the frame that reported them back over its ticks, half a digit up as the
+// firmware truncates them. Inputs that are never
+// reported are inferred from the recorded transitions:
+//   - a cell is present for the 5 ticks before state 0 -> 1 and absent for
+//     the 5 ticks before 1 -> 0 and the 2 ticks before 7 -> 0
+//   - the TP5100 reports done for the 10 ticks before a charge that ends
+//     without a fault
+//   - the loaded voltage of the IR check comes from &MO
+//   - the rest voltage settles exactly when the recorded rest ended, the
+//     10 mV readings are too coarse for the relaxation slope
+//   - the discharge current is trimmed (at most 1 %) so the mAh the engine
+//     counts follow &MA, the 10 mA &DA steps would drift by a mAh or more
+// Server replies and scanner barcodes come from the lines the firmware
+// echoes (BARCODE_CONTINUE_<j>, INSERT_DATA_SUCCESSFUL_<j>, BC<j>=OK), and
+// hardware cutoffs from the &CO records.
+
+#ifndef REPLAY_LOG_H
+#define REPLAY_LOG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace replay
+{
+
+const uint8_t slotCount = 4;
+
+struct SlotFrame
+{
+  int8_t state        = -1;    // &CS, -1 = not reported
+  bool   waiting      = false; // &WA, held by the scheduler
+  bool   insert       = false; // &ID, waiting for the insert acknowledgement
+  float  volts        = -1;    // &CV
+  float  initialVolts = -1;    // &IV
+  float  amps         = -1;    // &DA
+  int    milliamps    = -1;    // &MA
+  int    temperature  = -1;    // &CT
+  int    initialTemp  = -1;    // &IT
+  int    milliOhms    = -1;    // &MO
+  int    elapsed      = -1;    // &TI
+  int    faultCode    = -1;    // &FC
+};
+
+struct SlotResult
+{
+  char grade;
+  int  milliamps;
+  int  faultCode;
+};
+
+struct Frame
+{
+  size_t      line;           // In the capture, 1 based
+  std::string time;           // Timestamp as captured, may be empty
+  uint32_t    tick;           // Engine tick the frame was sent after
+  int         ambient = -1;   // &AT
+  SlotFrame   slots[slotCount];
+
+  // Lines between the previous frame and this one (the ticks of this frame)
+  uint8_t                 barcodeFound = 0; // Bit per slot, 100-103
+  uint8_t                 insertAcked  = 0; // Bit per slot, 200-203
+  uint8_t                 scanned      = 0; // Bit per slot, BC<j>=OK
+  int32_t                 cutoffMillis[slotCount] = {-1, -1, -1, -1}; // &CO, ms since the discharge started
+  std::vector<SlotResult> results[slotCount];                         // &RR
+};
+
+// Engine inputs for one slot at one tick
+struct TickInput
+{
+  float   volts;       // Battery channel as read
+  float   loadedVolts; // Battery channel with the discharge MOSFET on
+  float   shuntVolts;  // Shunt channel
+  uint8_t temperature;
+  bool    chargerDone;
+};
+
+struct Capture
+{
+  std::vector<Frame>     frames;
+  std::vector<TickInput> inputs;   // [tick * slotCount + slot]
+  std::vector<uint8_t>   ambients; // [tick]
+};
+
+// False if the file cannot be opened or holds no telemetry frame
+bool readCapture(const std::string &path, float shuntResistor, Capture &capture);
+
+} // namespace replay
+
+#endif // REPLAY_LOG_H
@@ -0,0 +1,386 @@
+// ReplayMain.cpp
+// Replays a USB serial capture of a unit through lib/CycleEngine built for
+// the host and checks that the state machine takes the recorded
+// transitions. The inputs of every tick are rebuilt from the capture
+// (ReplayLog.h); the engine runs as fast as it can, so a capture of a whole
+// bench day replays in well under a second and a behaviour change can be
+// bisected across firmware versions:
+//
+//   git bisect run sh -c 'pio run -e replay && .pio/build/replay/program unit.log'
+//
+//   pio run -e replay && .pio/build/replay/program [-v] capture.log
+//   (or) g++ -O2 -std=gnu++11 -Ilib/CycleEngine/src replay/*.cpp lib/CycleEngine/src/*.cpp -o ascd_replay
+//
+//   -v  print every recorded transition as it is reproduced
+//
+// After every frame the replayed state, scheduler hold (&WA) and insert
+// handshake (&ID) of each slot are compared with the frame, and each result
+// record (&RR) with the grade and fault code the engine computed. A slot
+// that was mid-cycle when the capture started, or that diverged, follows
+// the recording until its next empty slot (state 0) and is checked again
+// from there. Exit status 0 = everything reproduced, 1 = divergence.
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CycleEngine.h>
+
+#include "ReplayLog.h"
+
+using replay::slotCount;
+
+namespace
+{
+
+class ReplayClock : public CycleClock
+{
+public:
+  uint32_t now = 0;
+  uint32_t millis() override { return now; }
+};
+
+// Tick inputs from the capture; outputs are only remembered
+class ReplayIO : public CycleIO
+{
+public:
+  ReplayIO(const replay::Capture &capture, const CycleSlot *slots) : capture(capture), slots(slots) {}
+
+  float batteryVoltage(uint8_t j) override
+  {
+    const replay::TickInput &in = input(j);
+    return discharging[j] ? in.loadedVolts : in.volts;
+  }
+  float   shuntVoltage(uint8_t j) override { return input(j).shuntVolts; }
+  bool    chargerDone(uint8_t j) override { return input(j).chargerDone; }
+  void    setCharger(uint8_t j, bool on) override { charging[j] = on; }
+  void    setDischarge(uint8_t j, bool on) override { discharging[j] = on; }
+  uint8_t temperature(uint8_t j) override { return input(j).temperature; }
+  uint8_t ambientTemperature() override { return capture.ambients[tick]; }
+  bool    dischargeTripped(uint8_t j, uint32_t &tripMillis) override
+  {
+    if (cutoffMillis[j] < 0)
+      return false;
+    tripMillis      = slots[j].longMilliSecondsCleared + cutoffMillis[j];
+    cutoffMillis[j] = -1;
+    return true;
+  }
+
+  uint32_t tick = 0;
+  int32_t  cutoffMillis[slotCount] = {-1, -1, -1, -1}; // &CO waiting to be seen by dischargeCycle()
+  bool     charging[slotCount]     = {};
+  bool     discharging[slotCount]  = {};
+
+private:
+  const replay::TickInput &input(uint8_t j) const { return capture.inputs[tick * slotCount + j]; }
+
+  const replay::Capture &capture;
+  const CycleSlot       *slots;
+};
+
+// Scanner barcodes as src/Barcode.ino hands them to the slot
+struct BarcodeMirror
+{
+  enum { NONE, QUEUED, STARTING, UNREGISTERED } state = NONE;
+  bool owed = false; // Server found the barcode before the replay reached state 1
+
+  void update(CycleSlot &slot)
+  {
+    if (owed && slot.cycleState == CYCLE_BARCODE)
+    {
+      slot.batteryBarcode = true;
+      owed                = false;
+    }
+    if (state == QUEUED || state == STARTING)
+    {
+      if (slot.cycleState == CYCLE_BARCODE)
+      {
+        slot.batteryBarcode = true;
+        state               = STARTING;
+      }
+      else if (slot.cycleState != CYCLE_CHECK_BATTERY)
+        state = UNREGISTERED;
+      else if (state == STARTING)
+        state = NONE;
+    }
+    else if (state == UNREGISTERED && slot.cycleState == CYCLE_CHECK_BATTERY)
+      state = NONE;
+  }
+
+  // Server reply 100-103: registers a scanned barcode, else the server found it
+  void found(CycleSlot &slot)
+  {
+    if (state == UNREGISTERED)
+      state = NONE;
+    else if (slot.cycleState == CYCLE_BARCODE)
+      slot.batteryBarcode = true;
+    else
+      owed = true;
+  }
+};
+
+struct SlotCheck
+{
+  bool          checked = false;       // Replayed by the engine, else following the recording
+  unsigned long frames = 0;            // Frames that matched
+  unsigned long transitions = 0;       // Recorded state changes reproduced
+  unsigned long results = 0;           // &RR records matched
+  unsigned      divergences = 0;
+  unsigned      slips = 0;             // Transitions reproduced a few frames early or late
+  unsigned      maxSlip = 0;           // Frames
+  int           maxMilliampsError = 0; // Largest |mAh| difference of a matched result
+  bool          insertOwed = false;    // Acknowledgement arrived before the replay asked for it
+  unsigned      mismatched = 0;        // Frames out of step so far
+  std::string   firstMismatch;
+  uint32_t      waitingSince = 0;      // Following the recording: when &WA was first seen
+  std::deque<replay::SlotResult> computed, recorded;
+
+  // Checked again from an empty slot, or following the recording
+  void restart(bool replaying)
+  {
+    checked    = replaying;
+    insertOwed = false;
+    mismatched = 0;
+    firstMismatch.clear();
+    computed.clear();
+    recorded.clear();
+  }
+};
+
+const char *where(const replay::Frame &frame)
+{
+  static char text[64];
+  snprintf(text, sizeof(text), "line %zu%s%s", frame.line, frame.time.empty() ? "" : " ", frame.time.c_str());
+  return text;
+}
+
+// Empty slot in state 0, as after a reset
+void clearSlot(CycleSlot &slot)
+{
+  memset(&slot, 0, sizeof(slot));
+  slot.cycleState = CYCLE_CHECK_BATTERY;
+}
+
+// Mirror the recorded slot into the engine so the scheduler sees the other slots' load
+void follow(CycleSlot &slot, SlotCheck &check, const replay::SlotFrame &recorded, const replay::TickInput &input,
+            uint32_t now)
+{
+  if (recorded.state < 0 || recorded.state >= CYCLE_STATE_COUNT)
+    return;
+  if (recorded.waiting && !slot.awaitingAdmission)
+    check.waitingSince = now;
+  slot.cycleState         = recorded.state;
+  slot.awaitingAdmission  = recorded.waiting;
+  slot.admissionMillis    = check.waitingSince;
+  slot.pendingEvent       = EVENT_NONE;
+  slot.batteryVoltage     = input.volts;
+  slot.dischargeAmps      = recorded.state == CYCLE_DISCHARGE && recorded.amps > 0 ? recorded.amps : 0.0f;
+  slot.storageDischarging = false;
+}
+
+void diverge(SlotCheck &check, const std::string &message)
+{
+  printf("%s\n", message.c_str());
+  check.divergences++;
+  check.restart(false);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  bool        verbose = false;
+  unsigned    grace   = 3;
+  const char *path    = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    const char *value = i + 1 < argc ? argv[i + 1] : "";
+    if (strcmp(argv[i], "-v") == 0)      { verbose = true; }
+    else if (strcmp(argv[i], "-g") == 0) { grace = atoi(value); i++; }
+    else if (argv[i][0] != '-' && !path) { path = argv[i]; }
+    else
+    {
+      path = 0;
+      break;
+    }
+  }
+  if (!path)
+  {
+    fprintf(stderr, "usage: %s [-v] [-g frames] capture.log\n", argv[0]);
+    return 2;
+  }
+
+  CycleSettings   settings;
+  replay::Capture capture;
+  auto            start = std::chrono::steady_clock::now();
+  if (!replay::readCapture(path, settings.shuntResistor[0], capture))
+  {
+    fprintf(stderr, "%s: no telemetry frames in %s\n", argv[0], path);
+    return 2;
+  }
+  double readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  CycleSlot     slots[slotCount];
+  SlotCheck     checks[slotCount];
+  BarcodeMirror barcodes[slotCount];
+  ReplayClock   clock;
+  ReplayIO      io(capture, slots);
+  CycleEngine   engine(slots, slotCount, settings, io, clock);
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    clearSlot(slots[j]);
+    const replay::SlotFrame &first = capture.frames[0].slots[j];
+    checks[j].restart(first.state == CYCLE_CHECK_BATTERY && !first.waiting);
+  }
+
+  start         = std::chrono::steady_clock::now();
+  uint32_t tick = 0;
+  char     message[160];
+  for (size_t k = 0; k < capture.frames.size(); k++)
+  {
+    const replay::Frame &frame = capture.frames[k];
+
+    // Replies, scanner commands and records that came after the previous frame
+    for (uint8_t j = 0; j < slotCount; j++)
+    {
+      if (frame.scanned & (1 << j))
+      {
+        barcodes[j].state = BarcodeMirror::QUEUED;
+        barcodes[j].update(slots[j]);
+      }
+      if (frame.barcodeFound & (1 << j))
+        barcodes[j].found(slots[j]);
+      if (frame.insertAcked & (1 << j))
+      {
+        if (engine.awaitingInsert(j))
+          slots[j].insertData = true;
+        else
+          checks[j].insertOwed = checks[j].checked;
+      }
+      io.cutoffMillis[j] = frame.cutoffMillis[j];
+      if (checks[j].checked)
+        checks[j].recorded.insert(checks[j].recorded.end(), frame.results[j].begin(), frame.results[j].end());
+    }
+
+    for (; tick <= frame.tick; tick++)
+    {
+      io.tick   = tick;
+      clock.now = 1000 + tick * 1000UL;
+      for (uint8_t j = 0; j < slotCount; j++)
+      {
+        SlotCheck &check = checks[j];
+        if (!check.checked)
+        {
+          follow(slots[j], check, frame.slots[j], capture.inputs[tick * slotCount + j], clock.now);
+          continue;
+        }
+        if (check.insertOwed && engine.awaitingInsert(j))
+        {
+          slots[j].insertData = true;
+          check.insertOwed    = false;
+        }
+        barcodes[j].update(slots[j]);
+        engine.tickSlot(j);
+        if (slots[j].resultReady)
+        {
+          slots[j].resultReady = false;
+          check.computed.push_back({slots[j].cellGrade, (int)slots[j].dischargeMilliamps, slots[j].batteryFaultCode});
+        }
+      }
+    }
+
+    for (uint8_t j = 0; j < slotCount; j++)
+    {
+      const replay::SlotFrame &recorded = frame.slots[j];
+      SlotCheck               &check    = checks[j];
+      const CycleSlot         &slot     = slots[j];
+      if (!check.checked)
+      {
+        // Back in step once the recorded slot is empty
+        if (recorded.state == CYCLE_CHECK_BATTERY && !recorded.waiting)
+        {
+          clearSlot(slots[j]);
+          barcodes[j] = BarcodeMirror();
+          check.restart(true);
+        }
+        continue;
+      }
+      if (recorded.state < 0)
+        continue;
+
+      // Results in the order they were recorded
+      bool resultsMatch = true;
+      while (resultsMatch && !check.computed.empty() && !check.recorded.empty())
+      {
+        replay::SlotResult a = check.recorded.front(), b = check.computed.front();
+        check.recorded.pop_front();
+        check.computed.pop_front();
+        check.maxMilliampsError = std::max(check.maxMilliampsError, abs(a.milliamps - b.milliamps));
+        resultsMatch = a.grade == b.grade && a.faultCode == b.faultCode;
+        if (resultsMatch)
+        {
+          check.results++;
+          continue;
+        }
+        snprintf(message, sizeof(message), "%s  slot %d result diverged: recorded %c fault %d %d mAh, replay %c fault %d %d mAh",
+                 where(frame), j, a.grade, a.faultCode, a.milliamps, b.grade, b.faultCode, b.milliamps);
+      }
+      if (!resultsMatch)
+      {
+        diverge(check, message);
+        continue;
+      }
+
+      bool stateMatches = slot.cycleState == recorded.state && slot.awaitingAdmission == recorded.waiting &&
+                          engine.awaitingInsert(j) == recorded.insert;
+      if (!stateMatches)
+      {
+        // Readings between frames are not recorded, so timing decisions may land a few frames off
+        if (check.mismatched++ == 0)
+        {
+          snprintf(message, sizeof(message), "%s  slot %d diverged: recorded state %d%s%s, replay %d%s%s", where(frame),
+                   j, recorded.state, recorded.waiting ? " waiting" : "", recorded.insert ? " insert" : "",
+                   slot.cycleState, slot.awaitingAdmission ? " waiting" : "", engine.awaitingInsert(j) ? " insert" : "");
+          check.firstMismatch = message;
+        }
+        if (check.mismatched > grace)
+          diverge(check, check.firstMismatch);
+        continue;
+      }
+
+      if (check.mismatched > 0)
+      {
+        check.slips++;
+        check.maxSlip    = std::max(check.maxSlip, check.mismatched);
+        check.mismatched = 0;
+      }
+      check.frames++;
+      const replay::SlotFrame &previous = capture.frames[k > 0 ? k - 1 : 0].slots[j];
+      if (previous.state != recorded.state)
+      {
+        check.transitions++;
+        if (verbose)
+          printf("%s  slot %d  %d -> %d\n", where(frame), j, previous.state, recorded.state);
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  unsigned divergences = 0;
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    const SlotCheck &check = checks[j];
+    divergences += check.divergences;
+    printf("slot %d:       %lu frames matched, %lu transitions (%u up to %u frames off) and %lu results reproduced "
+           "(mAh within %d), %u divergences\n",
+           j, check.frames, check.transitions, check.slips, check.maxSlip, check.results, check.maxMilliampsError,
+           check.divergences);
+  }
+  printf("replay:       %zu frames, %u ticks (%.2f h) in %.3f s + %.3f s reading (%.0fx real time)\n",
+         capture.frames.size(), tick, tick / 3600.0, seconds, readSeconds, tick / (seconds + readSeconds));
+  return divergences ? 1 : 0;
+}
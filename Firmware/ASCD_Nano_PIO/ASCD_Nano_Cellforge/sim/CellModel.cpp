@@ -0,0 +1,66 @@
+// CellModel.cpp
+
+#include "CellModel.h"
+
+#include <math.h>
+
+namespace sim
+{
+
+namespace
+{
+
+// NMC 18650 open circuit voltage at 0 %, 10 % ... 100 % state of charge
+const float ocvTable[11] = {3.00f, 3.45f, 3.55f, 3.62f, 3.68f, 3.74f, 3.82f, 3.90f, 3.98f, 4.07f, 4.20f};
+
+} // namespace
+
+void CellModel::insert(const CellSpec &cellSpec, float surroundings)
+{
+  spec            = cellSpec;
+  soc             = spec.initialSoc;
+  polarisation    = 0.0f;
+  temperature     = surroundings;
+  peakTemperature = surroundings;
+  chargedAh       = 0.0;
+  dischargedAh    = 0.0;
+}
+
+float CellModel::openCircuitVoltage() const
+{
+  // Falls away steeply once the cell is past empty
+  if (soc <= 0.0f)
+    return ocvTable[0] + soc * 10.0f;
+  if (soc >= 1.0f)
+    return ocvTable[10] + (soc - 1.0f) * 2.0f;
+  float position = soc * 10.0f;
+  int   index    = (int)position;
+  float fraction = position - index;
+  return ocvTable[index] + (ocvTable[index + 1] - ocvTable[index]) * fraction;
+}
+
+void CellModel::step(float amps, float seconds, float surroundings, float airflow)
+{
+  if (seconds <= 0.0f)
+    return;
+
+  float hours = seconds / 3600.0f;
+  soc += amps * hours / spec.capacityAh;
+  if (amps > 0.0f)
+    chargedAh += amps * hours;
+  else
+    dischargedAh -= amps * hours;
+
+  // RC branch relaxes towards I * Rp
+  float target = amps * spec.polarisationOhms;
+  polarisation = target + (polarisation - target) * expf(-seconds / spec.polarisationSeconds);
+
+  // Joule heat in both resistances, loss to the board (doubled by the fan at full speed)
+  float heat = amps * amps * spec.internalOhms + polarisation * polarisation / spec.polarisationOhms;
+  float loss = (temperature - surroundings) * (1.0f + airflow) / spec.thermalOhms;
+  temperature += (heat - loss) * seconds / spec.heatCapacity;
+  if (temperature > peakTemperature)
+    peakTemperature = temperature;
+}
+
+} // namespace sim
@@ -0,0 +1,44 @@
+// CellModel.h
+// Lumped 18650 model for the simulator: open circuit voltage from state of
+// charge, series resistance, one RC polarisation branch (so rest and
+// relaxation behave like a real cell) and a single thermal mass.
+// Current is positive into the cell (charging).
+
+#ifndef SIM_CELL_MODEL_H
+#define SIM_CELL_MODEL_H
+
+namespace sim
+{
+
+struct CellSpec
+{
+  float capacityAh;
+  float internalOhms;
+  float initialSoc;            // 0..1
+  float polarisationOhms;      // RC branch resistance
+  float polarisationSeconds;   // RC branch time constant
+  float heatCapacity;          // J/K (45 g cell)
+  float thermalOhms;           // K/W to the board
+};
+
+class CellModel
+{
+public:
+  void  insert(const CellSpec &spec, float temperature);
+  float openCircuitVoltage() const;
+  float sourceVoltage() const { return openCircuitVoltage() + polarisation; } // Behind the series resistance
+  float terminalVoltage(float amps) const { return sourceVoltage() + amps * spec.internalOhms; }
+  void  step(float amps, float seconds, float surroundings, float airflow = 0.0f); // airflow 0..1, fan duty
+
+  CellSpec spec;
+  float    soc;
+  float    polarisation;
+  float    temperature;
+  float    peakTemperature;
+  double   chargedAh;
+  double   dischargedAh;
+};
+
+} // namespace sim
+
+#endif // SIM_CELL_MODEL_H
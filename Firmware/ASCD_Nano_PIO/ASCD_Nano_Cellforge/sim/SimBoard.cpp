@@ -0,0 +1,527 @@
+// SimBoard.cpp
+
+#include "SimBoard.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Arduino.h>
+#include <CycleSlot.h>
+#include <DallasTemperature.h>
+
+// Defined by the firmware (src/Temp_Sensor_Serials.h), sensors are matched by address
+extern DeviceAddress tempSensorSerial[5];
+extern CycleSlot     module[4];
+
+// Firmware interrupt handlers, absent ones are never called
+extern "C" void ADC_vect(void) __attribute__((weak));
+extern "C" void WDT_vect(void) __attribute__((weak));
+extern "C" void TWI_vect(void) __attribute__((weak));
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+
+namespace sim
+{
+
+Board board;
+
+namespace
+{
+
+const float avcc            = 5.02f;  // Matches settings.referenceVoltage
+const float loadOhms        = 3.3f;   // Discharge resistor
+const float mosfetOhms      = 0.06f;  // MOSFET and wiring, seen by the drop channel
+const float chargeAmps      = 1.0f;   // TP5100 constant current
+const float chargeVolts     = 4.2f;   // TP5100 constant voltage
+const float terminationAmps = 0.1f;   // TP5100 ends the charge below C/10 in CV
+const float ledChargingVolts = 0.35f; // CHRG pulled low while charging
+const float ledStandbyVolts  = 3.10f;
+const float boardHeatCapacity = 150.0f; // J/K around the ambient sensor
+const float boardHeatShare    = 0.3f;   // Share of load and charger heat reaching the sensor
+const float boardThermalOhms  = 1.6f;   // K/W to the room, halved with the fan at full speed
+const uint32_t adcConversionsPerStep = 5;  // One confirmed decision (discard + 4 samples)
+const uint64_t syncMicrosMin         = 100000;
+const uint8_t  lcdAddress            = 0x27;   // PCF8574 backpack
+
+enum ChannelKind
+{
+  CHANNEL_NONE,
+  CHANNEL_VOLTAGE,
+  CHANNEL_DROP,
+  CHANNEL_LED
+};
+
+struct Channel
+{
+  uint8_t slot;
+  uint8_t kind;
+};
+
+// CD74HC4067 channel (S3 S2 S1 S0) to signal, as wired on the PCB
+const Channel channels[16] =
+{
+  {0, CHANNEL_NONE},    {0, CHANNEL_NONE},    {0, CHANNEL_NONE},    {0, CHANNEL_NONE},
+  {3, CHANNEL_LED},     {3, CHANNEL_VOLTAGE}, {2, CHANNEL_LED},     {2, CHANNEL_VOLTAGE},
+  {1, CHANNEL_LED},     {1, CHANNEL_VOLTAGE}, {0, CHANNEL_LED},     {0, CHANNEL_VOLTAGE},
+  {3, CHANNEL_DROP},    {2, CHANNEL_DROP},    {1, CHANNEL_DROP},    {0, CHANNEL_DROP}
+};
+
+bool charging(uint8_t outputs, uint8_t j)    { return outputs & (1 << (2 * j)); }
+bool discharging(uint8_t outputs, uint8_t j) { return outputs & (1 << (2 * j + 1)); }
+
+} // namespace
+
+Board::Board()
+  : now(0), verbose(false), ptyFd(-1), ptyDropped(0), scanner(false), scanDelay(2000000), watchdogReset(false), fanDuty(0), fanSeconds(0), peakBoardTemperature(0), serialLines(0),
+    serverFrames(0), adcInterrupts(0), i2cBytes(0), shiftRegister(0), outputs(0), room(22.0f), boardTemperature(22.0f),
+    passes(1), syncMicros(0), watchdogMicros(0), watchdogTimeout(0), noise(1), channelsValid(0), twiPending(false),
+    twiStatus(0), twiAddressNext(false), twiSelected(false), timer1Micros(0), timer2Micros(0)
+{
+}
+
+void Board::begin(const CellSpec cellSpecs[slotCount], float roomTemperature, unsigned passCount)
+{
+  room                 = roomTemperature;
+  boardTemperature     = roomTemperature;
+  peakBoardTemperature = roomTemperature;
+  passes               = passCount;
+  PINC.value           = 0xFF; // Button released (active low)
+  SREG.value           = _BV(SREG_I);
+  MCUSR.value          = _BV(PORF);
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    specs[j]      = cellSpecs[j];
+    present[j]    = true;
+    terminated[j] = false;
+    cells[j].insert(specs[j], room);
+    runs[j]       = SlotRun();
+    if (scanner)
+      runs[j].scanMicros = scanDelay ? scanDelay : 1; // Changeover is only timed on swaps, setup() comes first here
+  }
+}
+
+void Board::inserted(uint8_t j)
+{
+  runs[j].insertMicros = now ? now : 1;
+  if (scanner)
+    runs[j].scanMicros = now + scanDelay ? now + scanDelay : 1;
+}
+
+void Board::press(uint64_t atMicros, uint32_t holdMicros)
+{
+  presses.push_back(std::make_pair(atMicros, atMicros + holdMicros));
+}
+
+// Button pin (A1 = PC1, active low) at time t
+void Board::buttonLevel(uint64_t at)
+{
+  bool down = false;
+  for (size_t i = 0; i < presses.size(); i++)
+    down |= at >= presses[i].first && at < presses[i].second;
+  if (down)
+    PINC.value &= ~_BV(PC1);
+  else
+    PINC.value |= _BV(PC1);
+}
+
+bool Board::finished() const
+{
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    if (runs[j].results < passes)
+      return false;
+  }
+  return true;
+}
+
+float Board::slotAmps(uint8_t j, float &loadAmps) const
+{
+  loadAmps = 0.0f;
+  if (!present[j])
+    return 0.0f;
+
+  const CellModel &cell = cells[j];
+  float source = cell.sourceVoltage();
+  float ohms   = cell.spec.internalOhms;
+  float load   = loadOhms + mosfetOhms;
+
+  float charger = 0.0f;
+  if (charging(outputs, j) && !terminated[j])
+  {
+    charger = (chargeVolts - source) / ohms;
+    if (charger > chargeAmps)
+      charger = chargeAmps;
+    if (charger < 0.0f)
+      charger = 0.0f;
+  }
+  if (!discharging(outputs, j))
+    return charger;
+
+  // Load across the terminals, charger current (if any) into the same node
+  float terminal = (source + charger * ohms) / (1.0f + ohms / load);
+  loadAmps = terminal / load;
+  return charger - loadAmps;
+}
+
+void Board::sync(bool force)
+{
+  // Readings may lag the model by a few steps, output changes may not
+  if (!force && now - syncMicros < syncMicrosMin)
+    return;
+  channelsValid = 0;
+  while (syncMicros < now)
+  {
+    uint64_t chunk   = now - syncMicros > 1000000 ? 1000000 : now - syncMicros;
+    float    seconds = chunk / 1e6f;
+    float    heat    = 0.0f;
+
+    for (uint8_t j = 0; j < slotCount; j++)
+    {
+      if (!present[j])
+        continue;
+      float loadAmps;
+      float amps = slotAmps(j, loadAmps);
+      heat += loadAmps * loadAmps * loadOhms;
+      if (charging(outputs, j) && !terminated[j])
+      {
+        heat += 0.1f * 5.0f * (amps + loadAmps); // TP5100 losses
+        if (amps + loadAmps < chargeAmps && amps + loadAmps < terminationAmps)
+          terminated[j] = true;
+      }
+      cells[j].step(amps, seconds, boardTemperature, fanDuty / 255.0f);
+    }
+
+    float thermalOhms = boardThermalOhms * (1.0f - 0.5f * fanDuty / 255.0f);
+    fanSeconds += fanDuty / 255.0 * seconds;
+    boardTemperature += (heat * boardHeatShare - (boardTemperature - room) / thermalOhms) * seconds / boardHeatCapacity;
+    if (boardTemperature > peakBoardTemperature)
+      peakBoardTemperature = boardTemperature;
+    syncMicros += chunk;
+  }
+}
+
+float Board::channelVoltage(uint8_t channel)
+{
+  const Channel &signal = channels[channel & 0x0F];
+  uint8_t j = signal.slot;
+  if (signal.kind == CHANNEL_NONE)
+    return 0.0f;
+  if (signal.kind == CHANNEL_LED)
+    return charging(outputs, j) && present[j] && !terminated[j] ? ledChargingVolts : ledStandbyVolts;
+  if (!present[j])
+    return 0.0f; // Pulled down
+
+  float loadAmps;
+  float amps     = slotAmps(j, loadAmps);
+  float terminal = cells[j].terminalVoltage(amps);
+  if (signal.kind == CHANNEL_DROP && discharging(outputs, j))
+    return loadAmps * mosfetOhms;
+  return terminal;
+}
+
+uint16_t Board::convert(uint8_t admux)
+{
+  sync();
+
+  float volts;
+  if ((admux & 0x0F) == 0x0E)
+  {
+    volts = 1.1f; // Bandgap
+  }
+  else
+  {
+    // S0..S3 = PB4..PB1
+    uint8_t port    = PORTB.value;
+    uint8_t channel = ((port >> 4) & 1) | (((port >> 3) & 1) << 1) | (((port >> 2) & 1) << 2) | (((port >> 1) & 1) << 3);
+    if (!(channelsValid & (1 << channel)))
+    {
+      channelVolts[channel] = channelVoltage(channel);
+      channelsValid |= 1 << channel;
+    }
+    volts = channelVolts[channel];
+  }
+
+  // About half an LSB of noise, the firmware averages its readings
+  noise = noise * 1103515245u + 12345u;
+  float dither = ((noise >> 16) & 0x3FF) / 1024.0f - 0.5f;
+  int counts = (int)(volts * 1023.0f / avcc + 0.5f + dither);
+  if (counts < 0)
+    counts = 0;
+  if (counts > 1023)
+    counts = 1023;
+  return counts;
+}
+
+float Board::sensorTemperature(const uint8_t *address)
+{
+  sync();
+  float celsius = DEVICE_DISCONNECTED_C;
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    if (memcmp(address, tempSensorSerial[i], 8) != 0)
+      continue;
+    celsius = (i < slotCount && present[i]) ? cells[i].temperature : boardTemperature;
+    break;
+  }
+  return (int)(celsius * 16.0f) / 16.0f; // 12 bit resolution
+}
+
+void Board::shiftClock(bool data)
+{
+  shiftRegister = (shiftRegister << 1) | (data ? 1 : 0);
+}
+
+void Board::latch()
+{
+  sync(true);
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    if (!charging(shiftRegister, j))
+      terminated[j] = false; // TP5100 starts a new charge on the next enable
+  }
+  outputs = shiftRegister;
+}
+
+void Board::watchdogConfigure(uint8_t wdtcsr)
+{
+  if (!(wdtcsr & (_BV(WDE) | _BV(WDIE))))
+  {
+    watchdogTimeout = 0;
+    return;
+  }
+  uint8_t prescaler = (wdtcsr & 0x07) | ((wdtcsr & _BV(WDP3)) ? 0x08 : 0);
+  watchdogTimeout   = 16000UL << prescaler;
+  watchdogMicros    = now;
+}
+
+// TWCR written with TWINT set: clears the flag and puts START, STOP or TWDR on the bus
+void Board::twiControl(uint8_t twcr)
+{
+  if (!(twcr & _BV(TWEN)) || !(twcr & _BV(TWINT)))
+    return;
+  TWCR.value &= ~_BV(TWINT);
+
+  if (twcr & _BV(TWSTA))
+  {
+    twiStatus      = twiSelected ? 0x10 : 0x08; // Repeated START inside a transaction
+    twiAddressNext = true;
+    twiPending     = true;
+  }
+  else if (twcr & _BV(TWSTO))
+  {
+    TWCR.value &= ~_BV(TWSTO); // No interrupt, the flag clears once STOP is out
+    twiSelected    = false;
+    twiAddressNext = false;
+  }
+  else
+  {
+    i2cBytes++;
+    if (twiAddressNext)
+    {
+      twiAddressNext = false;
+      twiSelected    = TWDR.value == (lcdAddress << 1);
+      twiStatus      = twiSelected ? 0x18 : 0x20;
+    }
+    else
+    {
+      if (twiSelected)
+        lcd.expander(TWDR.value);
+      twiStatus = twiSelected ? 0x28 : 0x30;
+    }
+    twiPending = true;
+  }
+}
+
+void Board::twiComplete()
+{
+  if (!twiPending)
+    return;
+  twiPending = false;
+  TWSR.value = (TWSR.value & 0x07) | twiStatus;
+  TWCR.value |= _BV(TWINT);
+}
+
+void Board::runInterrupts(uint32_t micros)
+{
+  // Free running conversions (ADSC restarted by the ISR): a conversion takes ~104 us,
+  // but a few per step are enough to keep it cycling through the armed slots
+  if (ADC_vect)
+  {
+    uint32_t conversions = micros / 104 + 1;
+    if (conversions > adcConversionsPerStep)
+      conversions = adcConversionsPerStep;
+    while (conversions-- && (SREG.value & _BV(SREG_I)) && (ADCSRA.value & _BV(ADIE)) && (ADCSRA.value & _BV(ADSC)))
+    {
+      ADC = convert(ADMUX.value);
+      ADCSRA.value &= ~(_BV(ADSC) | _BV(ADIF));
+      adcInterrupts++;
+      ADC_vect();
+    }
+  }
+
+  // TWI bytes take 9 bit times, as many as fit in the step
+  if (TWI_vect)
+  {
+    uint32_t busHz = F_CPU / (16 + 2 * TWBR.value);
+    uint32_t bytes = (uint64_t)micros * busHz / 9000000 + 1;
+    while (bytes-- && (SREG.value & _BV(SREG_I)) && (TWCR.value & _BV(TWIE)) && (twiPending || (TWCR.value & _BV(TWINT))))
+    {
+      twiComplete();
+      TWI_vect();
+    }
+  }
+
+  // Timer1 in CTC mode on OCR1A, the firmware's millis() timebase
+  static const uint16_t timer1Prescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+  uint16_t prescale = timer1Prescale[TCCR1B.value & 0x07];
+  if (TIMER1_COMPA_vect && prescale && (TCCR1B.value & _BV(WGM12)) && (TIMSK1.value & _BV(OCIE1A)))
+  {
+    uint64_t period = (uint64_t)prescale * (OCR1A + 1) * 1000000 / F_CPU;
+    timer1Micros += micros;
+    while (timer1Micros >= period)
+    {
+      timer1Micros -= period;
+      if (SREG.value & _BV(SREG_I))
+        TIMER1_COMPA_vect();
+
+      // Compare match B (OCR1B <= OCR1A) sets its flag, its rising edge auto triggers the ADC when selected
+      bool rising = !(TIFR1.value & _BV(OCF1B));
+      TIFR1.value |= _BV(OCF1B);
+      if (ADC_vect && rising && (ADCSRA.value & _BV(ADATE)) && (ADCSRB.value & 0x07) == 0x05 &&
+          (ADCSRA.value & _BV(ADIE)) && (SREG.value & _BV(SREG_I)))
+      {
+        ADC = convert(ADMUX.value);
+        ADCSRA.value &= ~_BV(ADIF);
+        adcInterrupts++;
+        ADC_vect();
+      }
+    }
+  }
+
+  // Timer2 in CTC mode: every compare match in the step, with the button pin as it was then
+  static const uint16_t timer2Prescale[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+  prescale = timer2Prescale[TCCR2B.value & 0x07];
+  if (TIMER2_COMPA_vect && prescale && (TIMSK2.value & _BV(OCIE2A)))
+  {
+    uint64_t period = (uint64_t)prescale * (OCR2A.value + 1) * 1000000 / F_CPU;
+    timer2Micros += micros;
+    while (timer2Micros >= period)
+    {
+      timer2Micros -= period;
+      buttonLevel(now - timer2Micros);
+      if (SREG.value & _BV(SREG_I))
+        TIMER2_COMPA_vect();
+    }
+  }
+  buttonLevel(now);
+
+  if (watchdogTimeout && now - watchdogMicros >= watchdogTimeout)
+  {
+    watchdogMicros = now;
+    if (WDTCSR.value & _BV(WDIE))
+    {
+      // Interrupt first, the next timeout resets
+      WDTCSR.value &= ~_BV(WDIE);
+      if (WDT_vect && (SREG.value & _BV(SREG_I)))
+        WDT_vect();
+    }
+    else if (WDTCSR.value & _BV(WDE))
+    {
+      watchdogReset = true;
+    }
+  }
+}
+
+void Board::advance(uint32_t micros)
+{
+  now += micros;
+
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    if (runs[j].reinsertMicros && now >= runs[j].reinsertMicros)
+    {
+      sync(true);
+      cells[j].insert(specs[j], boardTemperature);
+      present[j]             = true;
+      runs[j].reinsertMicros = 0;
+      inserted(j);
+    }
+    if (runs[j].scanMicros && now >= runs[j].scanMicros)
+    {
+      char command[24];
+      snprintf(command, sizeof(command), "BC%d=SIM%d-%u\n", j, j, runs[j].results);
+      Serial.inject(command);
+      runs[j].scanMicros = 0;
+    }
+    if (runs[j].insertMicros && module[j].cycleState == CYCLE_CHARGE)
+    {
+      runs[j].changeovers++;
+      runs[j].changeoverMicros += now - runs[j].insertMicros;
+      runs[j].insertMicros = 0;
+    }
+  }
+  sync();
+  runInterrupts(micros);
+}
+
+void Board::serialLine(const char *line)
+{
+  serialLines++;
+  if (ptyFd >= 0)
+  {
+    // As Serial.println() sends it; a full pty (host not reading) drops the line like a USB CDC port
+    std::string text = std::string(line) + "\r\n";
+    if (write(ptyFd, text.data(), text.size()) != (ssize_t)text.size())
+      ptyDropped++;
+  }
+  if (verbose)
+  {
+    unsigned long ms = now / 1000;
+    printf("[%02lu:%02lu:%02lu.%03lu] %s\n", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000, line);
+  }
+  else if (strncmp(line, "&WD", 3) == 0)
+  {
+    printf("%s\n", line);
+  }
+
+  // &RR<slot>=...: the cycle is over, swap the cell if more passes are wanted
+  if (strncmp(line, "&RR", 3) == 0 && line[3] >= '0' && line[3] < '0' + slotCount)
+  {
+    uint8_t j = line[3] - '0';
+    SlotRun &run = runs[j];
+    run.results++;
+    run.lastResult      = line;
+    run.dischargedAh    = cells[j].dischargedAh;
+    run.chargedAh       = cells[j].chargedAh;
+    run.peakTemperature = cells[j].peakTemperature;
+    if (run.results < passes)
+    {
+      sync(true);
+      present[j]         = false;
+      run.reinsertMicros = now + 60000000ULL;
+    }
+  }
+}
+
+std::string Board::serverReply(const char *frame)
+{
+  // Every barcode is known (100-103), every insert acknowledged (200-203).
+  // With the scanner the server registers the scanned barcodes (&BC) instead.
+  std::string reply;
+  char        key[8];
+  serverFrames++;
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    snprintf(key, sizeof(key), scanner ? "&BC%d=" : "&CS%d=1", j);
+    const char *at = strstr(frame, key);
+    if (at && (scanner || at[6] == '\0' || at[6] == '&'))
+      reply += (reply.empty() ? "" : ":") + std::to_string(100 + j);
+    snprintf(key, sizeof(key), "&ID%d", j);
+    if (strstr(frame, key))
+      reply += (reply.empty() ? "" : ":") + std::to_string(200 + j);
+  }
+  return reply.empty() ? "0" : reply;
+}
+
+} // namespace sim
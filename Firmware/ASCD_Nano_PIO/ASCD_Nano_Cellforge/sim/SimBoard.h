@@ -0,0 +1,115 @@
+// SimBoard.h
+// Simulated ASCD Nano board for the native build: CD74HC4067 mux into the
+// ADC, 74HC595 driving the TP5100 and discharge MOSFETs, 3.3 ohm loads,
+// DS18B20s, the fan, the watchdog, the LCD backpack on the TWI bus, the
+// button (scripted presses, sampled by the Timer2 interrupt) and a
+// fake ESP8266 / server that finds every barcode and acknowledges every
+// insert. With the scanner on, barcodes are scanned at the host instead
+// (BC<slot>= over USB) and the server only registers them. Time is a virtual clock that the driver advances between loop()
+// calls.
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "CellModel.h"
+#include "SimLcd.h"
+
+namespace sim
+{
+
+const uint8_t slotCount = 4;
+
+struct SlotRun
+{
+  unsigned    results;          // &RR records seen
+  std::string lastResult;
+  double      dischargedAh;     // Model side, for the last pass
+  double      chargedAh;
+  float       peakTemperature;
+  uint64_t    reinsertMicros;   // Cell put back at this time, 0 = present or done
+  uint64_t    insertMicros;     // Cell swapped in, state 2 not reached yet (0 = not waiting)
+  uint64_t    scanMicros;       // Host scanner sends the barcode at this time, 0 = none due
+  unsigned    changeovers;      // Swap to state 2, counted and summed
+  uint64_t    changeoverMicros;
+};
+
+class Board
+{
+public:
+  Board();
+
+  void begin(const CellSpec specs[slotCount], float roomTemperature, unsigned passes);
+  void advance(uint32_t micros);
+  bool finished() const;
+  void press(uint64_t atMicros, uint32_t holdMicros);
+
+  // Used by the HAL
+  void     sync(bool force = false);
+  uint16_t convert(uint8_t admux);
+  float    sensorTemperature(const uint8_t *address);
+  void     shiftClock(bool data);
+  void     latch();
+  void     watchdogPet() { watchdogMicros = now; }
+  void     watchdogConfigure(uint8_t wdtcsr);
+  void     serialLine(const char *line);
+  std::string serverReply(const char *frame);
+  void     twiControl(uint8_t twcr);
+  void     twiComplete();
+
+  uint64_t  now;               // Virtual time (us)
+  bool      verbose;
+  int       ptyFd;             // USB serial output also goes here (SimEmulator), -1 = none
+  unsigned long ptyDropped;    // Lines lost to a full pty
+  bool      scanner;           // Barcodes come from a host scanner, scanDelay after the insert
+  uint32_t  scanDelay;         // us
+  bool      watchdogReset;
+  uint8_t   fanDuty;
+  double    fanSeconds;        // Time at full speed equivalent
+  float     peakBoardTemperature;
+  unsigned long serialLines;
+  unsigned long serverFrames;
+  unsigned long adcInterrupts;
+  unsigned long i2cBytes;      // Address bytes included
+  Lcd       lcd;
+  SlotRun   runs[slotCount];
+  CellModel cells[slotCount];
+  bool      present[slotCount];
+
+private:
+  float slotAmps(uint8_t j, float &loadAmps) const;
+  float channelVoltage(uint8_t channel);
+  void  runInterrupts(uint32_t micros);
+  void  buttonLevel(uint64_t at);
+  void  inserted(uint8_t j);
+
+  CellSpec specs[slotCount];
+  bool     terminated[slotCount]; // TP5100 finished, LED shows standby until the charger is switched off
+  uint8_t  shiftRegister;
+  uint8_t  outputs;
+  float    room;
+  float    boardTemperature;
+  unsigned passes;
+  uint64_t syncMicros;
+  uint64_t watchdogMicros;
+  uint32_t watchdogTimeout;    // us, 0 = off
+  uint32_t noise;
+  float    channelVolts[16];    // Mux channel voltages since the last sync
+  uint16_t channelsValid;
+  bool     twiPending;          // Byte or START on the bus, TWINT follows
+  uint8_t  twiStatus;
+  bool     twiAddressNext;
+  bool     twiSelected;
+  uint64_t timer1Micros;        // Time since the last Timer1 compare match
+  uint64_t timer2Micros;        // Time since the last Timer2 compare match
+  std::vector<std::pair<uint64_t, uint64_t> > presses; // Button down, up (us)
+};
+
+extern Board board;
+
+} // namespace sim
+
+#endif // SIM_BOARD_H
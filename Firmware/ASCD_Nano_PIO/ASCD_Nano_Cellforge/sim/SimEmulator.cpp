@@ -0,0 +1,210 @@
+// SimEmulator.cpp
+
+#include "SimEmulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+namespace sim
+{
+
+namespace
+{
+
+volatile sig_atomic_t stopRequested = 0;
+
+void requestStop(int)
+{
+  stopRequested = 1;
+}
+
+uint64_t wallMicros()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// The given cells with capacity, resistance and starting charge varied per unit
+void unitCells(unsigned unit, const CellSpec base[slotCount], CellSpec cells[slotCount])
+{
+  uint32_t state = unit * 2654435761u + 1;
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    float random[3];
+    for (uint8_t k = 0; k < 3; k++)
+    {
+      state     = state * 1664525u + 1013904223u;
+      random[k] = (state >> 8) / 16777216.0f;
+    }
+    cells[j] = base[j];
+    cells[j].capacityAh *= 0.85f + 0.25f * random[0];
+    cells[j].internalOhms *= 0.8f + 0.5f * random[1];
+    cells[j].initialSoc = 0.1f + 0.6f * random[2];
+  }
+}
+
+// Pty pair with the slave in raw mode; the slave stays open here so the
+// master neither hangs up nor fails writes while no host has the port open
+bool openUnitPty(int &master, int &slave, std::string &slavePath)
+{
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return false;
+  slavePath = ptsname(master);
+  slave     = open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+  if (slave < 0)
+    return false;
+  termios tty;
+  tcgetattr(slave, &tty);
+  cfmakeraw(&tty);
+  tcsetattr(slave, TCSANOW, &tty);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  fcntl(master, F_SETFD, FD_CLOEXEC);
+  fcntl(slave, F_SETFD, FD_CLOEXEC);
+  return true;
+}
+
+void runUnit(int master, const EmulatorOptions &options, const CellSpec cells[slotCount])
+{
+  board.ptyFd = master;
+  board.begin(cells, options.room, UINT_MAX); // Never finished, the cells are swapped forever
+  setup();
+
+  // Sleep and look for host commands about every 20 ms of wall time
+  unsigned loopsPerPoll = (unsigned)(20.0 * options.scale / options.stepMillis);
+  if (loopsPerPoll == 0)
+    loopsPerPoll = 1;
+
+  uint64_t start = wallMicros();
+  unsigned loops = 0;
+  char     input[128];
+  while (!stopRequested && !board.watchdogReset)
+  {
+    loop();
+    board.advance(options.stepMillis * 1000);
+    if (++loops % loopsPerPoll != 0)
+      continue;
+
+    // Hold the virtual clock at scale x wall time; the poll is the sleep and picks up host commands
+    int64_t ahead = (int64_t)(board.now / options.scale) - (int64_t)(wallMicros() - start);
+    pollfd  port  = {master, POLLIN, 0};
+    if (poll(&port, 1, ahead > 1000 ? (int)(ahead / 1000) : 0) > 0 && (port.revents & POLLIN))
+    {
+      ssize_t count;
+      while ((count = read(master, input, sizeof(input) - 1)) > 0)
+      {
+        input[count] = '\0';
+        Serial.inject(input);
+      }
+    }
+  }
+}
+
+} // namespace
+
+int emulateUnits(const EmulatorOptions &options, const CellSpec cells[slotCount])
+{
+  if (mkdir(options.directory, 0755) != 0 && errno != EEXIST)
+  {
+    perror(options.directory);
+    return 1;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = requestStop;
+  sigaction(SIGINT, &action, 0);
+  sigaction(SIGTERM, &action, 0);
+
+  std::string              listPath = std::string(options.directory) + "/ports.txt";
+  FILE                    *list     = fopen(listPath.c_str(), "w");
+  std::vector<std::string> links;
+  std::vector<pid_t>       children;
+  for (unsigned unit = 0; unit < options.units && list; unit++)
+  {
+    int         master, slave;
+    std::string slavePath;
+    char        link[PATH_MAX];
+    if (!openUnitPty(master, slave, slavePath))
+    {
+      perror("pty");
+      break;
+    }
+    snprintf(link, sizeof(link), "%s/unit%03u", options.directory, unit);
+    unlink(link);
+    if (symlink(slavePath.c_str(), link) != 0)
+    {
+      perror(link);
+      close(master);
+      close(slave);
+      break;
+    }
+    links.push_back(link);
+    fprintf(list, "%s\n", link);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      // Each unit is its own process: the firmware's globals are per board
+      CellSpec unitSpecs[slotCount];
+      unitCells(unit, cells, unitSpecs);
+      runUnit(master, options, unitSpecs);
+      if (board.watchdogReset)
+        fprintf(stderr, "unit%03u: watchdog reset at %.3f s\n", unit, board.now / 1e6);
+      _exit(board.watchdogReset ? 2 : 0);
+    }
+    close(master);
+    close(slave);
+    if (pid < 0)
+    {
+      perror("fork");
+      break;
+    }
+    children.push_back(pid);
+  }
+  if (list)
+    fclose(list);
+
+  printf("%zu units: %s/unit000 .. (list in %s), %.0fx real time, ^C to stop\n", children.size(), options.directory,
+         listPath.c_str(), options.scale);
+  fflush(stdout);
+
+  int    status  = children.size() == options.units ? 0 : 1;
+  size_t running = children.size();
+  while (running > 0 && !stopRequested)
+  {
+    int   childStatus;
+    pid_t pid = wait(&childStatus);
+    if (pid > 0)
+    {
+      running--;
+      status = 2;
+    }
+  }
+  for (pid_t pid : children)
+    kill(pid, SIGTERM);
+  while (wait(0) > 0)
+    ;
+  for (const std::string &link : links)
+    unlink(link.c_str());
+  unlink(listPath.c_str());
+  return status;
+}
+
+} // namespace sim
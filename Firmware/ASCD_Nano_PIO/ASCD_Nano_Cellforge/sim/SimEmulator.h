@@ -0,0 +1,36 @@
+// SimEmulator.h
+// Virtual ASCD units for load testing host tools (fleetd and the like).
+// Forks one simulated board per unit, each running the whole firmware with
+// its USB serial on a pty, so every unit speaks exactly the protocol of the
+// real firmware: telemetry frames, server return codes echoed from the
+// ESP8266 link, result and cutoff records, and answers to USB commands.
+// The server behind the ESP8266 link is the simulated one (every barcode
+// found, every insert acknowledged). Cells are swapped a minute after each
+// result, forever, and the virtual clock is held at a multiple of wall time.
+
+#ifndef SIM_EMULATOR_H
+#define SIM_EMULATOR_H
+
+#include <stdint.h>
+
+#include "CellModel.h"
+#include "SimBoard.h"
+
+namespace sim
+{
+
+struct EmulatorOptions
+{
+  unsigned    units      = 0;
+  const char *directory  = "/tmp/ascd-units"; // unit000 .. symlinks to the pty slaves, and ports.txt
+  double      scale      = 1.0;               // Virtual seconds per wall second
+  uint32_t    stepMillis = 20;
+  float       room       = 22.0f;
+};
+
+// Runs until SIGINT / SIGTERM, returns the exit status
+int emulateUnits(const EmulatorOptions &options, const CellSpec cells[slotCount]);
+
+} // namespace sim
+
+#endif // SIM_EMULATOR_H
@@ -0,0 +1,347 @@
+// SimHal.cpp
+// Arduino core, AVR registers and library objects for the native build,
+// backed by the simulated board.
+
+#include <stdarg.h>
+
+#include <Arduino.h>
+#include <DallasTemperature.h>
+#include <EEPROM.h>
+#include <SoftwareSerial.h>
+#include <avr/wdt.h>
+
+#include "SimBoard.h"
+
+using sim::board;
+
+// ----------------------
+// Registers
+// ----------------------
+
+SimRegister PINB, DDRB, PORTB;
+SimRegister PINC, DDRC, PORTC;
+SimRegister PIND, DDRD, PORTD;
+SimRegister SREG, MCUSR, WDTCSR;
+SimRegister ADMUX, ADCSRA, ADCSRB, DIDR0;
+volatile uint16_t ADC;
+SimRegister TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+SimRegister TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+SimRegister TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+SimRegister PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+SimRegister TWBR, TWSR, TWAR, TWDR, TWCR;
+
+// Arduino core time, advanced by the firmware's Timer1 ISR; millis() here reads the board clock
+extern "C"
+{
+volatile unsigned long timer0_millis         = 0;
+volatile unsigned long timer0_overflow_count = 0;
+}
+
+HardwareSerial Serial;
+EEPROMClass    EEPROM;
+
+namespace
+{
+
+// 74HC595: SH_CP on PB0, DS on PD6, ST_CP on PD7
+void portBWrite(uint8_t before, uint8_t after)
+{
+  if (!(before & _BV(PB0)) && (after & _BV(PB0)))
+    board.shiftClock(PORTD.value & _BV(PD6));
+}
+
+// Fan on PD5: OC0B PWM while COM0B1 is set, the port bit otherwise
+void fanUpdate(uint8_t, uint8_t)
+{
+  uint8_t duty;
+  if (TCCR0A.value & _BV(COM0B1))
+  {
+    uint16_t top = (TCCR0B.value & _BV(WGM02)) ? OCR0A.value : 255;
+    duty = OCR0B.value >= top ? 255 : OCR0B.value * 256 / (top + 1);
+  }
+  else
+  {
+    duty = (PORTD.value & _BV(PD5)) ? 255 : 0;
+  }
+  if (duty != board.fanDuty)
+  {
+    board.sync(true);
+    board.fanDuty = duty;
+  }
+}
+
+void portDWrite(uint8_t before, uint8_t after)
+{
+  if (!(before & _BV(PD7)) && (after & _BV(PD7)))
+    board.latch();
+  if ((before ^ after) & _BV(PD5))
+    fanUpdate(before, after);
+}
+
+// A polled conversion completes as soon as the firmware looks at ADSC
+uint8_t adcsraRead(uint8_t value)
+{
+  if (value & _BV(ADSC))
+  {
+    ADC = board.convert(ADMUX.value);
+    value = (value & ~_BV(ADSC)) | _BV(ADIF);
+  }
+  return value;
+}
+
+void twcrWrite(uint8_t, uint8_t after)
+{
+  board.twiControl(after);
+}
+
+// Polled TWI: the byte in flight is done as soon as the firmware looks at TWINT
+uint8_t twcrRead(uint8_t)
+{
+  board.twiComplete();
+  return TWCR.value;
+}
+
+// Interrupt flags are cleared by writing a one
+void tifr1Write(uint8_t before, uint8_t after)
+{
+  TIFR1.value = before & ~after;
+}
+
+void wdtcsrWrite(uint8_t, uint8_t after)
+{
+  board.watchdogConfigure(after);
+}
+
+void serialLine(const char *line)
+{
+  board.serialLine(line);
+}
+
+struct HalInit
+{
+  HalInit()
+  {
+    PORTB.onWrite  = portBWrite;
+    PORTD.onWrite  = portDWrite;
+    ADCSRA.onRead  = adcsraRead;
+    WDTCSR.onWrite = wdtcsrWrite;
+    TIFR1.onWrite  = tifr1Write;
+    TWCR.onWrite   = twcrWrite;
+    TWCR.onRead    = twcrRead;
+    TCCR0A.onWrite = fanUpdate;
+    TCCR0B.onWrite = fanUpdate;
+    OCR0A.onWrite  = fanUpdate;
+    OCR0B.onWrite  = fanUpdate;
+    Serial.onLine  = serialLine;
+  }
+} halInit;
+
+SimRegister *portRegister(uint8_t pin, SimRegister *&ddr, SimRegister *&input, uint8_t &bit)
+{
+  if (pin < 8)
+  {
+    bit = pin; ddr = &DDRD; input = &PIND;
+    return &PORTD;
+  }
+  if (pin < 14)
+  {
+    bit = pin - 8; ddr = &DDRB; input = &PINB;
+    return &PORTB;
+  }
+  bit = pin - 14; ddr = &DDRC; input = &PINC;
+  return &PORTC;
+}
+
+} // namespace
+
+// ----------------------
+// Time
+// ----------------------
+
+unsigned long millis()
+{
+  return (uint32_t)(board.now / 1000);
+}
+
+unsigned long micros()
+{
+  return (uint32_t)board.now;
+}
+
+void delay(unsigned long ms)
+{
+  // In 1 ms steps so interrupts keep running
+  while (ms--)
+    board.advance(1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  board.advance(us);
+}
+
+// ----------------------
+// Pins
+// ----------------------
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  SimRegister *ddr, *input;
+  uint8_t      bit;
+  SimRegister *port = portRegister(pin, ddr, input, bit);
+  if (mode == OUTPUT)
+  {
+    *ddr |= _BV(bit);
+  }
+  else
+  {
+    *ddr &= ~_BV(bit);
+    if (mode == INPUT_PULLUP)
+      *port |= _BV(bit);
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  SimRegister *ddr, *input;
+  uint8_t      bit;
+  SimRegister *port = portRegister(pin, ddr, input, bit);
+  if (pin == 5)
+    TCCR0A &= ~_BV(COM0B1); // As the core's turnOffPWM()
+  if (value)
+    *port |= _BV(bit);
+  else
+    *port &= ~_BV(bit);
+}
+
+int digitalRead(uint8_t pin)
+{
+  SimRegister *ddr, *input;
+  uint8_t      bit;
+  SimRegister *port = portRegister(pin, ddr, input, bit);
+  uint8_t      value = (ddr->value & _BV(bit)) ? port->value : (uint8_t)*input;
+  return (value & _BV(bit)) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+  // Only SIG (A0) is used; the mux channel comes from PORTB
+  ADMUX = _BV(REFS0) | ((pin >= 14 ? pin - 14 : pin) & 0x07);
+  return board.convert(ADMUX.value);
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+  if (pin == 5)
+  {
+    board.sync(true);
+    board.fanDuty = value < 0 ? 0 : (value > 255 ? 255 : value);
+  }
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value)
+{
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint8_t bit = bitOrder == LSBFIRST ? (value >> i) & 1 : (value >> (7 - i)) & 1;
+    digitalWrite(dataPin, bit);
+    digitalWrite(clockPin, HIGH);
+    digitalWrite(clockPin, LOW);
+  }
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// ----------------------
+// Flash strings
+// ----------------------
+
+namespace
+{
+
+int formatP(char *buffer, size_t size, const char *format, va_list args)
+{
+  char hostFormat[256];
+  size_t n = 0;
+  for (const char *p = format; *p && n < sizeof(hostFormat) - 1; p++)
+  {
+    hostFormat[n++] = *p;
+    if (p[0] == '%' && p[1] == '%')
+    {
+      hostFormat[n++] = *++p;
+      continue;
+    }
+    if (p[0] == '%')
+    {
+      // Flags, width and precision, then the conversion
+      while (p[1] && strchr("-+ #0123456789.", p[1]) && n < sizeof(hostFormat) - 2)
+        hostFormat[n++] = *++p;
+      if (p[1] == 'S')
+      {
+        hostFormat[n++] = 's';
+        p++;
+      }
+    }
+  }
+  hostFormat[n] = '\0';
+  return vsnprintf(buffer, size, hostFormat, args);
+}
+
+} // namespace
+
+int sprintf_P(char *buffer, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int n = formatP(buffer, 4096, format, args);
+  va_end(args);
+  return n;
+}
+
+int snprintf_P(char *buffer, size_t size, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int n = formatP(buffer, size, format, args);
+  va_end(args);
+  return n;
+}
+
+int vsnprintf_P(char *buffer, size_t size, const char *format, va_list args)
+{
+  return formatP(buffer, size, format, args);
+}
+
+// ----------------------
+// Watchdog, sensors, ESP8266
+// ----------------------
+
+void wdt_reset()
+{
+  board.watchdogPet();
+}
+
+void wdt_enable(uint8_t timeout)
+{
+  WDTCSR = _BV(WDE) | (timeout & 0x07) | ((timeout & 0x08) ? _BV(WDP3) : 0);
+  board.watchdogPet();
+}
+
+void wdt_disable()
+{
+  WDTCSR = 0;
+}
+
+float simSensorTemperature(const uint8_t *address)
+{
+  return board.sensorTemperature(address);
+}
+
+std::string simServerReply(const char *frame)
+{
+  return board.serverReply(frame);
+}
@@ -0,0 +1,93 @@
+// SimLcd.cpp
+
+#include "SimLcd.h"
+
+#include <string.h>
+
+namespace sim
+{
+
+namespace
+{
+
+const uint8_t pinRs     = 0x01;
+const uint8_t pinEnable = 0x04;
+
+} // namespace
+
+Lcd::Lcd() : characters(0), commands(0), port(0), fourBit(false), haveHigh(false), high(0), address(0)
+{
+  memset(ram, ' ', sizeof(ram));
+  memset(text, ' ', sizeof(text));
+  text[0][16] = text[1][16] = '\0';
+}
+
+void Lcd::expander(uint8_t value)
+{
+  bool falling = (port & pinEnable) && !(value & pinEnable);
+  uint8_t latched = port; // Data and RS as they were while E was high
+  port = value;
+  if (!falling)
+    return;
+
+  uint8_t nibble = latched & 0xF0;
+  bool    data   = latched & pinRs;
+  if (!fourBit)
+  {
+    // D0..D3 are not wired, the low half of an 8-bit write reads as zero
+    execute(nibble, data);
+    return;
+  }
+  if (!haveHigh)
+  {
+    high     = nibble;
+    haveHigh = true;
+    return;
+  }
+  haveHigh = false;
+  execute(high | (nibble >> 4), data);
+}
+
+void Lcd::execute(uint8_t value, bool data)
+{
+  if (data)
+  {
+    characters++;
+    uint8_t row    = address >= 0x40 ? 1 : 0;
+    uint8_t column = address - (row ? 0x40 : 0x00);
+    if (column < 40)
+      ram[row][column] = (char)value;
+    if (column < 16)
+      text[row][column] = (char)value;
+    address++;
+    if (address == 0x28)
+      address = 0x40;
+    else if (address == 0x68)
+      address = 0x00;
+    return;
+  }
+
+  commands++;
+  if (value & 0x80) // Set DDRAM address
+  {
+    address = value & 0x7F;
+  }
+  else if ((value & 0xE0) == 0x20) // Function set, DL selects the interface width
+  {
+    fourBit  = !(value & 0x10);
+    haveHigh = false;
+  }
+  else if (value == 0x01) // Clear
+  {
+    memset(ram, ' ', sizeof(ram));
+    memset(text, ' ', sizeof(text));
+    text[0][16] = text[1][16] = '\0';
+    address = 0;
+  }
+  else if ((value & 0xFE) == 0x02) // Home
+  {
+    address = 0;
+  }
+}
+
+} // namespace sim
@@ -0,0 +1,40 @@
+// SimLcd.h
+// HD44780 behind a PCF8574 backpack for the native build: takes the
+// expander bytes the firmware sends over TWI, latches a nibble on every E
+// falling edge (8-bit mode until the function set switches to 4-bit) and
+// keeps the display RAM so the simulator can show and check the screen.
+
+#ifndef SIM_LCD_H
+#define SIM_LCD_H
+
+#include <stdint.h>
+
+namespace sim
+{
+
+class Lcd
+{
+public:
+  Lcd();
+
+  void        expander(uint8_t value); // PCF8574 port write
+  const char *line(uint8_t row) const { return text[row < 2 ? row : 1]; }
+
+  unsigned long characters;
+  unsigned long commands;
+
+private:
+  void execute(uint8_t value, bool data);
+
+  uint8_t port;
+  bool    fourBit;
+  bool    haveHigh;
+  uint8_t high;
+  uint8_t address;  // DDRAM: 0x00..0x27 line 1, 0x40..0x67 line 2
+  char    ram[2][40];
+  char    text[2][17];
+};
+
+} // namespace sim
+
+#endif // SIM_LCD_H
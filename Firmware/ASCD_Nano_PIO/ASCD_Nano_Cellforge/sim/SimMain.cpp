@@ -0,0 +1,165 @@
+// SimMain.cpp
+// Native build of the firmware against the simulated board (sim/hal). Runs
+// setup() and loop() on a virtual clock, advancing it by a fixed step after
+// every loop() call, until every slot has reported its result (&RR) the
+// requested number of times.
+//
+//   pio run -e native && .pio/build/native/program [options]
+//   (or) cat src/ASCD_Nano.ino $(ls src/*.ino | grep -v ASCD_Nano.ino) > /tmp/sketch.cpp
+//        g++ -O2 -std=gnu++11 -Isim/hal -Isim -Isrc -Ilib/CycleEngine/src -x c++ /tmp/sketch.cpp
+//            -x none sim/*.cpp lib/CycleEngine/src/*.cpp -o ascd_sim
+//
+//   -s <ms>     clock step per loop() call (default 20)
+//   -n <passes> cycles per slot, the cell is swapped after each result (default 1)
+//   -t <hours>  give up after this much simulated time (default 48)
+//   -r <C>      room temperature (default 22)
+//   -c <line>   USB serial command sent after setup() (repeatable)
+//   -p <s>[:ms] press the button at s seconds for ms (default 100, repeatable)
+//   -b [s]      scan barcodes at the host s seconds after each insert (default 2)
+//               instead of waiting for the server to find them
+//   -v          print the USB serial output with simulated timestamps
+//   -e <units>  emulate units on ptys for host tools instead (SimEmulator.h), with
+//   -x <scale>  virtual seconds per wall second (default 1)
+//   -d <dir>    pty symlinks and ports.txt (default /tmp/ascd-units)
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Arduino.h>
+#include <DallasTemperature.h>
+#include <EEPROM.h>
+
+#include "SimBoard.h"
+#include "SimEmulator.h"
+
+using sim::board;
+
+namespace
+{
+
+// Four different cells: typical, worn, high capacity, and one too weak to pass
+const sim::CellSpec defaultCells[sim::slotCount] =
+{
+  // Ah    ohms   SoC   Rp     tau    J/K   K/W
+  {2.60f, 0.045f, 0.35f, 0.020f, 60.0f, 45.0f, 15.0f},
+  {2.00f, 0.070f, 0.60f, 0.030f, 60.0f, 45.0f, 15.0f},
+  {3.00f, 0.035f, 0.20f, 0.015f, 60.0f, 45.0f, 15.0f},
+  {0.80f, 0.180f, 0.50f, 0.060f, 60.0f, 45.0f, 15.0f},
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t    stepMillis = 20;
+  unsigned    passes     = 1;
+  double      limitHours = 48.0;
+  float       room       = 22.0f;
+  std::string commands;
+  sim::EmulatorOptions emulator;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *value = i + 1 < argc ? argv[i + 1] : "";
+    if (strcmp(argv[i], "-s") == 0)      { stepMillis = atoi(value); i++; }
+    else if (strcmp(argv[i], "-n") == 0) { passes = atoi(value); i++; }
+    else if (strcmp(argv[i], "-t") == 0) { limitHours = atof(value); i++; }
+    else if (strcmp(argv[i], "-r") == 0) { room = atof(value); i++; }
+    else if (strcmp(argv[i], "-c") == 0) { commands += value; commands += '\n'; i++; }
+    else if (strcmp(argv[i], "-p") == 0)
+    {
+      const char *hold = strchr(value, ':');
+      board.press((uint64_t)(atof(value) * 1e6), (hold ? atoi(hold + 1) : 100) * 1000);
+      i++;
+    }
+    else if (strcmp(argv[i], "-b") == 0)
+    {
+      board.scanner = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        board.scanDelay = atof(argv[++i]) * 1e6;
+    }
+    else if (strcmp(argv[i], "-v") == 0) { board.verbose = true; }
+    else if (strcmp(argv[i], "-e") == 0) { emulator.units = atoi(value); i++; }
+    else if (strcmp(argv[i], "-x") == 0) { emulator.scale = atof(value); i++; }
+    else if (strcmp(argv[i], "-d") == 0) { emulator.directory = value; i++; }
+    else
+    {
+      fprintf(stderr, "usage: %s [-s ms] [-n passes] [-t hours] [-r C] [-c line]... [-p s[:ms]]... [-b [s]] [-v]\n"
+                      "       %s -e units [-x scale] [-d dir] [-s ms] [-r C] [-b [s]]\n", argv[0], argv[0]);
+      return 1;
+    }
+  }
+  if (stepMillis == 0 || passes == 0)
+    return 1;
+  if (emulator.units > 0)
+  {
+    if (emulator.scale <= 0.0)
+      return 1;
+    emulator.stepMillis = stepMillis;
+    emulator.room       = room;
+    return sim::emulateUnits(emulator, defaultCells);
+  }
+
+  board.begin(defaultCells, room, passes);
+  uint64_t limitMicros = (uint64_t)(limitHours * 3600e6);
+  unsigned long loops  = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  setup();
+  Serial.inject(commands.c_str());
+  while (!board.finished() && !board.watchdogReset && board.now < limitMicros)
+  {
+    loop();
+    board.advance(stepMillis * 1000);
+    loops++;
+  }
+  double wall  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double hours = board.now / 3600e6;
+
+  printf("simulated:    %.2f h in %.3f s (%.0fx), %lu loop() calls\n", hours, wall, hours * 3600.0 / wall, loops);
+  for (uint8_t j = 0; j < sim::slotCount; j++)
+  {
+    const sim::SlotRun &run = board.runs[j];
+    printf("slot %d:       %.2f Ah %3.0f mOhm | model %4.0f mAh out, peak %.1f C | %s\n", j,
+           defaultCells[j].capacityAh, (defaultCells[j].internalOhms + defaultCells[j].polarisationOhms) * 1000.0,
+           run.dischargedAh * 1000.0, run.peakTemperature,
+           run.results ? run.lastResult.c_str() : "(no result)");
+  }
+
+  unsigned      changeovers      = 0;
+  uint64_t      changeoverMicros = 0;
+  for (uint8_t j = 0; j < sim::slotCount; j++)
+  {
+    changeovers += board.runs[j].changeovers;
+    changeoverMicros += board.runs[j].changeoverMicros;
+  }
+  if (changeovers > 0)
+    printf("changeover:   %.1f s mean from cell swap to state 2 (%u swaps, barcodes from the %s)\n",
+           changeoverMicros / 1e6 / changeovers, changeovers, board.scanner ? "scanner" : "server");
+
+  unsigned long eepromWrites = 0;
+  for (int address = 0; address <= E2END; address++)
+  {
+    if (EEPROM.writes[address] > eepromWrites)
+      eepromWrites = EEPROM.writes[address];
+  }
+  printf("board:        peak %.1f C, %lu USB lines, %lu server frames, %lu cutoff conversions\n",
+         board.peakBoardTemperature, board.serialLines, board.serverFrames, board.adcInterrupts);
+  printf("fan:          mean duty %.1f%%\n", board.now ? board.fanSeconds * 100.0 / (board.now / 1e6) : 0.0);
+  printf("i2c:          %lu bytes (%.0f/s), lcd \"%s|%s\"   eeprom: most written cell %lu\n", board.i2cBytes,
+         board.i2cBytes / (board.now / 1e6), board.lcd.line(0), board.lcd.line(1), eepromWrites);
+
+  if (board.watchdogReset)
+  {
+    printf("WATCHDOG RESET at %.3f s\n", board.now / 1e6);
+    return 2;
+  }
+  if (!board.finished())
+  {
+    printf("TIMEOUT\n");
+    return 3;
+  }
+  return 0;
+}
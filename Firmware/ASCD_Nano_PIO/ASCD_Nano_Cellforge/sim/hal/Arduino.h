@@ -0,0 +1,75 @@
+// Arduino.h (simulator)
+// Arduino core for the native build. Time is virtual: millis() and micros()
+// read the simulator clock, delay() advances it and runs due interrupts.
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "HardwareSerial.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define bit(b)                  (1UL << (b))
+#define bitRead(value, b)       (((value) >> (b)) & 0x01)
+#define bitSet(value, b)        ((value) |= (1UL << (b)))
+#define bitClear(value, b)      ((value) &= ~(1UL << (b)))
+#define bitWrite(value, b, v)   ((v) ? bitSet(value, b) : bitClear(value, b))
+#define lowByte(w)              ((uint8_t)((w) & 0xff))
+#define highByte(w)             ((uint8_t)((w) >> 8))
+#define constrain(amt, lo, hi)  ((amt) < (lo) ? (lo) : ((amt) > (hi) ? (hi) : (amt)))
+
+#define interrupts()   sei()
+#define noInterrupts() cli()
+
+template <typename T, typename U> static inline T min(T a, U b) { return a < (T)b ? a : (T)b; }
+template <typename T, typename U> static inline T max(T a, U b) { return a > (T)b ? a : (T)b; }
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+void setup();
+void loop();
+
+#endif // SIM_ARDUINO_H
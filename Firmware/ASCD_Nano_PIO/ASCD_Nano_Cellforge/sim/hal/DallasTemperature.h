@@ -0,0 +1,36 @@
+// DallasTemperature.h (simulator)
+// DS18B20 reads come from the simulated board by sensor address. Conversions
+// complete instantly, readings are quantised to the 12 bit resolution.
+
+#ifndef SIM_DALLAS_TEMPERATURE_H
+#define SIM_DALLAS_TEMPERATURE_H
+
+#include <stdint.h>
+
+#include "OneWire.h"
+
+typedef uint8_t DeviceAddress[8];
+
+#define DEVICE_DISCONNECTED_C -127
+
+// Implemented by the simulated board
+float simSensorTemperature(const uint8_t *address);
+
+class DallasTemperature
+{
+public:
+  DallasTemperature(OneWire *bus) : bus(bus), conversions(0) {}
+
+  void    begin() {}
+  uint8_t getDeviceCount() { return 5; }
+  void    setResolution(uint8_t) {}
+  void    setWaitForConversion(bool) {}
+  void    requestTemperatures() { conversions++; }
+  bool    requestTemperaturesByAddress(const uint8_t *) { conversions++; return true; }
+  float   getTempC(const uint8_t *address) { return simSensorTemperature(address); }
+
+  OneWire      *bus;
+  unsigned long conversions;
+};
+
+#endif // SIM_DALLAS_TEMPERATURE_H
@@ -0,0 +1,47 @@
+// EEPROM.h (simulator)
+// 1 KB EEPROM in RAM, erased to 0xFF, with a write counter per cell.
+
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <avr/io.h>
+
+class EEPROMClass
+{
+public:
+  EEPROMClass()
+  {
+    memset(data, 0xFF, sizeof(data));
+    memset(writes, 0, sizeof(writes));
+  }
+
+  uint8_t  read(int address) { return data[address]; }
+  void     write(int address, uint8_t value) { data[address] = value; writes[address]++; }
+  void     update(int address, uint8_t value) { if (data[address] != value) write(address, value); }
+  uint16_t length() { return E2END + 1; }
+
+  template <typename T> T &get(int address, T &value)
+  {
+    memcpy(&value, &data[address], sizeof(T));
+    return value;
+  }
+
+  template <typename T> const T &put(int address, const T &value)
+  {
+    const uint8_t *bytes = (const uint8_t *)&value;
+    for (size_t i = 0; i < sizeof(T); i++)
+      update(address + i, bytes[i]);
+    return value;
+  }
+
+  // Simulator side
+  uint8_t       data[E2END + 1];
+  unsigned long writes[E2END + 1];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // SIM_EEPROM_H
@@ -0,0 +1,85 @@
+// HardwareSerial.h (simulator)
+// USB serial: output goes to the simulated board line by line, input comes
+// from commands queued by the simulator.
+
+#ifndef SIM_HARDWARE_SERIAL_H
+#define SIM_HARDWARE_SERIAL_H
+
+#include <deque>
+#include <string>
+
+#include "Stream.h"
+
+class HardwareSerial : public Stream
+{
+public:
+  typedef void (*LineHandler)(const char *line);
+
+  HardwareSerial() : onLine(0) {}
+
+  void begin(unsigned long) {}
+  void end() {}
+  void flush() {}
+  operator bool() { return true; }
+
+  int available() { return input.size(); }
+  int availableForWrite() { return 63; } // Output is never held up, the AVR has a 64 byte ring
+  int read()
+  {
+    if (input.empty())
+      return -1;
+    int c = (unsigned char)input.front();
+    input.pop_front();
+    return c;
+  }
+  int peek() { return input.empty() ? -1 : (unsigned char)input.front(); }
+
+  using Print::write;
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    // Whole runs at a time, the telemetry frames are a few hundred characters
+    const uint8_t *end = buffer + size;
+    while (buffer < end)
+    {
+      const uint8_t *stop = buffer;
+      while (stop < end && *stop != '\r' && *stop != '\n')
+        stop++;
+      line.append((const char *)buffer, stop - buffer);
+      if (stop < end)
+        write(*stop++);
+      buffer = stop;
+    }
+    return size;
+  }
+  size_t write(uint8_t c)
+  {
+    if (c == '\n')
+    {
+      if (onLine)
+        onLine(line.c_str());
+      line.clear();
+    }
+    else if (c != '\r')
+    {
+      line += (char)c;
+    }
+    return 1;
+  }
+
+  // Simulator side
+  void inject(const char *text)
+  {
+    while (*text)
+      input.push_back(*text++);
+  }
+
+  LineHandler onLine;
+
+private:
+  std::deque<char> input;
+  std::string      line;
+};
+
+extern HardwareSerial Serial;
+
+#endif // SIM_HARDWARE_SERIAL_H
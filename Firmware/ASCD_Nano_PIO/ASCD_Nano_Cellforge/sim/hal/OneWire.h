@@ -0,0 +1,15 @@
+// OneWire.h (simulator)
+
+#ifndef SIM_ONEWIRE_H
+#define SIM_ONEWIRE_H
+
+#include <stdint.h>
+
+class OneWire
+{
+public:
+  OneWire(uint8_t pin) : pin(pin) {}
+  uint8_t pin;
+};
+
+#endif // SIM_ONEWIRE_H
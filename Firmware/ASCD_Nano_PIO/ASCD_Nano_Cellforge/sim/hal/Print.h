@@ -0,0 +1,77 @@
+// Print.h (simulator)
+// Arduino Print formatting over a single virtual write().
+
+#ifndef SIM_PRINT_H
+#define SIM_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *text) { return text ? write((const uint8_t *)text, strlen(text)) : 0; }
+
+  size_t print(const __FlashStringHelper *text) { return write((const char *)text); }
+  size_t print(const String &text)              { return write(text.c_str()); }
+  size_t print(const char *text)                { return write(text); }
+  size_t print(char c)                          { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC)           { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC)  { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC)
+  {
+    if (base == DEC && n < 0)
+      return write('-') + printNumber(-(unsigned long)n, base);
+    return printNumber(n, base);
+  }
+  size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(double n, int digits = 2)
+  {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+    return write(buffer);
+  }
+
+  template <typename T> size_t println(T value)           { size_t n = print(value); return n + println(); }
+  template <typename T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+  size_t println() { return write("\r\n"); }
+
+private:
+  size_t printNumber(unsigned long n, int base)
+  {
+    char buffer[8 * sizeof(long) + 1];
+    char *p = &buffer[sizeof(buffer) - 1];
+    *p = '\0';
+    if (base < 2)
+      base = 10;
+    do
+    {
+      unsigned long digit = n % base;
+      n /= base;
+      *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    } while (n);
+    return write(p);
+  }
+};
+
+#endif // SIM_PRINT_H
@@ -0,0 +1,74 @@
+// SoftwareSerial.h (simulator)
+// ESP8266 link: each line the firmware sends goes to the simulated server,
+// whose reply is read back with readString().
+
+#ifndef SIM_SOFTWARE_SERIAL_H
+#define SIM_SOFTWARE_SERIAL_H
+
+#include <deque>
+#include <string>
+
+#include "Stream.h"
+
+// Implemented by the simulated board, returns the reply to one frame
+std::string simServerReply(const char *frame);
+
+class SoftwareSerial : public Stream
+{
+public:
+  SoftwareSerial(uint8_t rx, uint8_t tx) : rx(rx), tx(tx) {}
+
+  void begin(long) {}
+  bool listen() { return true; }
+
+  int available() { return input.size(); }
+  int read()
+  {
+    if (input.empty())
+      return -1;
+    int c = (unsigned char)input.front();
+    input.pop_front();
+    return c;
+  }
+  int peek() { return input.empty() ? -1 : (unsigned char)input.front(); }
+
+  using Print::write;
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    // Whole runs at a time, the telemetry frames are a few hundred characters
+    const uint8_t *end = buffer + size;
+    while (buffer < end)
+    {
+      const uint8_t *stop = buffer;
+      while (stop < end && *stop != '\r' && *stop != '\n')
+        stop++;
+      line.append((const char *)buffer, stop - buffer);
+      if (stop < end)
+        write(*stop++);
+      buffer = stop;
+    }
+    return size;
+  }
+  size_t write(uint8_t c)
+  {
+    if (c == '\n')
+    {
+      std::string reply = simServerReply(line.c_str());
+      input.insert(input.end(), reply.begin(), reply.end());
+      line.clear();
+    }
+    else if (c != '\r')
+    {
+      line += (char)c;
+    }
+    return 1;
+  }
+
+private:
+  uint8_t          rx;
+  uint8_t          tx;
+  std::deque<char> input;
+  std::string      line;
+};
+
+#endif // SIM_SOFTWARE_SERIAL_H
@@ -0,0 +1,47 @@
+// Stream.h (simulator)
+// Byte streams fed by the simulated board; reads never block.
+
+#ifndef SIM_STREAM_H
+#define SIM_STREAM_H
+
+#include <string>
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+  Stream() : timeout(1000) {}
+
+  virtual int available() = 0;
+  virtual int read()      = 0;
+  virtual int peek()      = 0;
+
+  void setTimeout(unsigned long ms) { timeout = ms; }
+
+  String readString()
+  {
+    std::string text;
+    while (available())
+      text += (char)read();
+    return String(text);
+  }
+
+  size_t readBytesUntil(char terminator, char *buffer, size_t length)
+  {
+    size_t n = 0;
+    while (n < length && available())
+    {
+      int c = read();
+      if (c == terminator)
+        break;
+      buffer[n++] = (char)c;
+    }
+    return n;
+  }
+
+protected:
+  unsigned long timeout;
+};
+
+#endif // SIM_STREAM_H
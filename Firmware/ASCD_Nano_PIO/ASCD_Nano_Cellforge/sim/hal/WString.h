@@ -0,0 +1,56 @@
+// WString.h (simulator)
+// The subset of Arduino String the firmware uses, backed by std::string.
+
+#ifndef SIM_WSTRING_H
+#define SIM_WSTRING_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include <avr/pgmspace.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+class String
+{
+public:
+  String(const char *text = "") : text(text ? text : "") {}
+  String(const std::string &text) : text(text) {}
+  String(char c) : text(1, c) {}
+
+  String &operator+=(char c)              { text += c; return *this; }
+  String &operator+=(const char *s)       { text += s; return *this; }
+  String &operator+=(const String &s)     { text += s.text; return *this; }
+  bool    operator==(const char *s) const { return text == s; }
+  bool    operator!=(const char *s) const { return text != s; }
+
+  unsigned int length() const          { return text.size(); }
+  char         charAt(unsigned int i) const { return i < text.size() ? text[i] : 0; }
+  char         operator[](unsigned int i) const { return charAt(i); }
+  const char  *c_str() const           { return text.c_str(); }
+  long         toInt() const           { return atol(text.c_str()); }
+  float        toFloat() const         { return atof(text.c_str()); }
+  int          indexOf(char c) const   { size_t at = text.find(c); return at == std::string::npos ? -1 : (int)at; }
+  bool         startsWith(const char *s) const { return text.compare(0, strlen(s), s) == 0; }
+
+  String substring(unsigned int from, unsigned int to = (unsigned int)-1) const
+  {
+    if (from > text.size())
+      return String();
+    return String(text.substr(from, to == (unsigned int)-1 ? std::string::npos : to - from));
+  }
+
+  void trim()
+  {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last  = text.find_last_not_of(" \t\r\n");
+    text = first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+  }
+
+private:
+  std::string text;
+};
+
+#endif // SIM_WSTRING_H
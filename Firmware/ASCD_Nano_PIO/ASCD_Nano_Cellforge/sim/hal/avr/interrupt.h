@@ -0,0 +1,15 @@
+// avr/interrupt.h (simulator)
+// ISRs are plain C functions the simulated board calls between loop()
+// iterations and inside delay(), only while the I flag in SREG is set.
+
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= (uint8_t)~_BV(SREG_I))
+
+#endif // SIM_AVR_INTERRUPT_H
@@ -0,0 +1,193 @@
+// avr/io.h (simulator)
+// ATmega328P registers used by the firmware. Registers with side effects
+// (ports, ADC control, watchdog) call back into the simulated board.
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define E2END  0x3FF
+#define RAMEND 0x8FF
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+class SimRegister
+{
+public:
+  typedef void (*WriteHook)(uint8_t before, uint8_t after);
+  typedef uint8_t (*ReadHook)(uint8_t value);
+
+  SimRegister() : value(0), onWrite(0), onRead(0) {}
+
+  operator uint8_t()
+  {
+    if (onRead)
+      value = onRead(value);
+    return value;
+  }
+
+  // int operands, as avr-gcc promotes expressions like ~_BV(bit)
+  SimRegister &operator=(int v)  { set((uint8_t)v); return *this; }
+  SimRegister &operator|=(int v) { set((uint8_t)(value | v)); return *this; }
+  SimRegister &operator&=(int v) { set((uint8_t)(value & v)); return *this; }
+  SimRegister &operator^=(int v) { set((uint8_t)(value ^ v)); return *this; }
+
+  uint8_t   value;
+  WriteHook onWrite;
+  ReadHook  onRead;
+
+private:
+  SimRegister(const SimRegister &);
+
+  void set(uint8_t v)
+  {
+    uint8_t before = value;
+    value = v;
+    if (onWrite)
+      onWrite(before, v);
+  }
+};
+
+// Ports
+extern SimRegister PINB, DDRB, PORTB;
+extern SimRegister PINC, DDRC, PORTC;
+extern SimRegister PIND, DDRD, PORTD;
+
+// Status, reset and watchdog
+extern SimRegister SREG, MCUSR, WDTCSR;
+
+// ADC
+extern SimRegister ADMUX, ADCSRA, ADCSRB, DIDR0;
+extern volatile uint16_t ADC;
+
+// Timers
+extern SimRegister TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+extern SimRegister TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+extern SimRegister TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+
+// Pin change interrupts
+extern SimRegister PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+
+// TWI
+extern SimRegister TWBR, TWSR, TWAR, TWDR, TWCR;
+
+// Port bits
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// SREG
+#define SREG_I 7
+
+// MCUSR
+#define PORF  0
+#define EXTRF 1
+#define BORF  2
+#define WDRF  3
+
+// WDTCSR
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE  3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+
+// ADMUX
+#define MUX0  0
+#define MUX1  1
+#define MUX2  2
+#define MUX3  3
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+
+// ADCSRA
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE  3
+#define ADIF  4
+#define ADATE 5
+#define ADSC  6
+#define ADEN  7
+
+// ADCSRB
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+
+// Timer bits
+#define WGM00  0
+#define WGM01  1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define CS00   0
+#define CS01   1
+#define CS02   2
+#define WGM02  3
+#define TOIE0  0
+#define OCIE0A 1
+#define OCIE0B 2
+#define WGM10  0
+#define WGM11  1
+#define WGM12  3
+#define WGM13  4
+#define CS10   0
+#define CS11   1
+#define CS12   2
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1A  1
+#define OCF1B  2
+#define WGM20  0
+#define WGM21  1
+#define CS20   0
+#define CS21   1
+#define CS22   2
+#define OCIE2A 1
+
+// Pin change
+#define PCIE0  0
+#define PCIE1  1
+#define PCIE2  2
+#define PCINT9 1
+
+// TWCR
+#define TWIE  0
+#define TWEN  2
+#define TWWC  3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA  6
+#define TWINT 7
+
+#endif // SIM_AVR_IO_H
@@ -0,0 +1,36 @@
+// avr/pgmspace.h (simulator)
+// Flash and RAM share one address space on the host.
+
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(address)  (*(const uint8_t *)(address))
+#define pgm_read_word(address)  (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define pgm_read_float(address) (*(const float *)(address))
+#define pgm_read_ptr(address)   (*(void *const *)(address))
+
+#define memcpy_P   memcpy
+#define strcpy_P   strcpy
+#define strncpy_P  strncpy
+#define strcat_P   strcat
+#define strlen_P   strlen
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define strstr_P   strstr
+// avr-libc's %S (string in flash) is %s here, glibc reads %S as a wide string
+int sprintf_P(char *buffer, const char *format, ...);
+int snprintf_P(char *buffer, size_t size, const char *format, ...);
+int vsnprintf_P(char *buffer, size_t size, const char *format, va_list args);
+
+#endif // SIM_AVR_PGMSPACE_H
@@ -0,0 +1,30 @@
+// util/atomic.h (simulator)
+
+#ifndef SIM_UTIL_ATOMIC_H
+#define SIM_UTIL_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+static inline uint8_t simAtomicBegin()
+{
+  uint8_t sreg = SREG;
+  cli();
+  return sreg;
+}
+
+static inline void simAtomicRestore(const uint8_t *sreg)
+{
+  SREG = *sreg;
+}
+
+static inline void simAtomicForceOn(const uint8_t *)
+{
+  sei();
+}
+
+#define ATOMIC_RESTORESTATE uint8_t simSregSave __attribute__((__cleanup__(simAtomicRestore))) = simAtomicBegin()
+#define ATOMIC_FORCEON      uint8_t simSregSave __attribute__((__cleanup__(simAtomicForceOn))) = simAtomicBegin()
+#define NONATOMIC_BLOCK(type) for (int simOnce = 1; simOnce; simOnce = 0)
+#define ATOMIC_BLOCK(type)  for (type, simOnce = 1; simOnce; simOnce = 0)
+
+#endif // SIM_UTIL_ATOMIC_H
@@ -24,11 +24,15 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 // Main file: includes, globals, setup() and loop().
 
 #include <Arduino.h>
-#include <Wire.h>
+#include <stddef.h>
+#include <util/crc16.h>
+#include <util/atomic.h>
+#include <avr/wdt.h>
 #include <OneWire.h>
-#include <LiquidCrystal_I2C.h>
 #include <DallasTemperature.h>
 #include <SoftwareSerial.h>
+#include <EEPROM.h>
+#include <CycleEngine.h>
 
 #include "DebugConfig.h"
 #include "Temp_Sensor_Serials.h"
@@ -68,7 +72,6 @@ const byte FAN = 5;       // PCB Version 1.11+ only
 // Objects
 // ----------------------
 
-LiquidCrystal_I2C lcd(0x27, 16, 2); // LCD at address 0x27, 16x2
 OneWire oneWire(ONE_WIRE_BUS);      // OneWire bus for DS18B20 sensors
 DallasTemperature sensors(&oneWire);
 SoftwareSerial ESP8266(3, 2);       // RX, TX
@@ -79,29 +82,63 @@ SoftwareSerial ESP8266(3, 2);       // RX, TX
 
 typedef struct
 {
-  const float shuntResistor[4]           = {3.3, 3.3, 3.3, 3.3};
   const float chargeLedPinMidVolatge[4]  = {1.8, 1.8, 1.85, 1.85};
-  const float referenceVoltage           = 5.02;
-  const float defaultBatteryCutOffVoltage= 2.8;
-  const byte  restTimeMinutes            = 1;
-  const int   lowMilliamps               = 1000;
-  const int   highMilliOhms              = 500;
-  const int   offsetMilliOhms            = 0;
-  const byte  chargingTimeout            = 8;
-  const byte  tempThreshold              = 7;
-  const byte  tempMaxThreshold           = 20;
-  const float batteryVolatgeLeak         = 0.50;
+  const float referenceVoltage           = 5.02;  // AVcc used until the bandgap has been calibrated
   const byte  moduleCount                = 4;
   const byte  screenTime                 = 4;
-  const int   dischargeReadInterval      = 5000;
-  const float storageChargeVoltage       = 0.00;
-  const byte  pwmFanMinStart             = 115;   // Minimum PWM for fan start
+  const byte  pwmFanMinStart             = 115;   // Minimum PWM for fan start, lowest duty the fan keeps turning at
+  const byte  fanRiseSetpoint            = 4;     // Hottest active slot above ambient (C) the fan loop holds
+  const byte  fanKp                      = 16;    // Fan duty per C of error
+  const byte  fanKi                      = 2;     // Fan duty per C of error, added every second
+  const byte  fanDischargeDuty           = 140;   // Least fan duty while a slot discharges
+  const byte  fanAmbientMax              = 38;    // Full fan speed at or above this ambient (C)
+  const byte  fanKickSeconds             = 2;     // Full duty when the fan starts from standstill
+  const bool  hardwareCutoff             = true;  // Watch discharging slots from the ADC interrupt and open the MOSFET at cutoff
+  const byte  cutoffConfirmSamples       = 4;     // Consecutive conversions below cutoff before the ISR opens the MOSFET
+  const uint16_t memoryWarnBytes         = 128;   // Send an &MW record when the stack has come this close to the heap
+  const uint32_t lcdBusHz                = 100000; // LCD backpack TWI clock, the PCF8574 is specified for 100 kHz; 400000 works on most backpacks (opt-in, check the display)
+  const uint16_t buttonLongPressMillis   = 1000;  // Hold this long for a long press
+  const uint16_t statsSeconds            = 600;   // Send the &SA slot accounting records this often
 } CustomSettings;
 
 CustomSettings settings;
+CycleSettings  cycleSettings; // Cycle thresholds and timings, defaults in lib/CycleEngine/src/CycleSettings.h
 
 // ----------------------
-// Module struct
+// Calibration struct (stored in EEPROM)
+// ----------------------
+
+typedef struct
+{
+  byte  version;
+  float bandgapVoltage;    // Measured internal 1.1 V reference, 0 = not calibrated
+  float voltageGain[4];    // Per-slot battery voltage channel
+  float voltageOffset[4];
+  float shuntGain[4];      // Per-slot shunt (voltage drop) channel
+  float shuntOffset[4];
+  byte  crc;
+} Calibration;
+
+const int calibrationAddress = 0;
+Calibration calibration;
+
+// ----------------------
+// Checkpoint ring (stored in EEPROM after the calibration table)
+// ----------------------
+
+typedef struct
+{
+  uint16_t        sequence;   // Increments on every write, newest entry per slot wins
+  byte            slot;
+  CycleCheckpoint checkpoint; // lib/CycleEngine/src/CycleCheckpoint.h
+  byte            crc;
+} CheckpointEntry;
+
+const int  checkpointAddress = 128;
+const byte checkpointEntries = (E2END + 1 - checkpointAddress) / sizeof(CheckpointEntry);
+
+// ----------------------
+// Module pins
 // ----------------------
 
 typedef struct
@@ -112,48 +149,10 @@ typedef struct
   const bool chargeLedPin[4];
   const byte chargeMosfetPin;
   const byte dischargeMosfetPin;
-
-  // Timer
-  unsigned long longMilliSecondsCleared;
-  byte seconds;
-  byte minutes;
-  byte hours;
-
-  // Module Cycle
-  byte cycleCount;
-  bool batteryBarcode;
-  bool insertData;
-  byte cycleState;
-  byte batteryFaultCode;
-
-  // Voltage Readings
-  float batteryInitialVoltage;
-  float batteryVoltage;
-
-  // Temperature Readings
-  byte batteryInitialTemp;
-  byte batteryHighestTemp;
-  byte batteryCurrentTemp;
-  byte tempCount;
-
-  // Milli Ohms
-  float tempMilliOhmsValue;
-  float milliOhmsValue;
-
-  // Discharge
-  int intMilliSecondsCount;
-  unsigned long longMilliSecondsPreviousCount;
-  unsigned long longMilliSecondsPrevious;
-  unsigned long longMilliSecondsPassed;
-  float dischargeMilliamps;
-  float dischargeVoltage;
-  float dischargeAmps;
-  int dischargeMinutes;
-  bool pendingDischargeRecord;
-} Modules;
+} ModulePins;
 
 // Module pin configuration for 4 slots
-Modules module[4] =
+const ModulePins modulePins[4] =
 {
   {{1, 1, 0, 1}, {1, 1, 1, 1}, {0, 1, 0, 1}, 0, 1},
   {{1, 0, 0, 1}, {0, 1, 1, 1}, {0, 0, 0, 1}, 2, 3},
@@ -161,16 +160,42 @@ Modules module[4] =
   {{1, 0, 1, 0}, {0, 0, 1, 1}, {0, 0, 1, 0}, 6, 7}
 };
 
+// Per-slot cycle state (lib/CycleEngine/src/CycleSlot.h)
+CycleSlot module[4];
+
 // ----------------------
 // Global state
 // ----------------------
 
 byte ambientTemperature = 0;
-bool  buttonPressed     = false;
 bool  readSerialResponse= false;
 char  serialSendString[400];
 byte  countSerialSend   = 0;
-bool  soundBuzzer       = false;
+byte  telemetryFrames   = 0; // Frames sent, wraps
+volatile bool soundBuzzer = false; // Also set by the button ISR
+float vccVoltage        = 5.02; // Measured AVcc, replaces settings.referenceVoltage once calibrated
+volatile byte shiftRegisterState = 0; // 74HC595 outputs (Q0..Q7), also written by the cutoff ISR
+volatile bool outputsLocked = false;   // Set by watchdogTrip(), every MOSFET stays off until the reset
+
+// Button events (Button.ino)
+enum ButtonEvent : byte
+{
+  BUTTON_NONE,
+  BUTTON_SHORT, // Released before settings.buttonLongPressMillis
+  BUTTON_LONG   // Held for settings.buttonLongPressMillis, sent while still held
+};
+
+// Watchdog heartbeat tasks (Watchdog.ino)
+enum WatchdogTask : byte
+{
+  TASK_ADC,
+  TASK_TEMPERATURE,
+  TASK_STATE,
+  TASK_TELEMETRY,
+  TASK_LCD,
+  TASK_COUNT,
+  TASK_NONE = 255
+};
 
 // ----------------------
 // Forward declarations
@@ -181,46 +206,132 @@ bool  soundBuzzer       = false;
 void buzzer();
 
 // FanController.ino
+void fanBegin();
+void fanWrite(byte duty);
 void fanController();
 
 // SerialComm.ino
 void sendSerial();
+bool telemetryAppend_P(const char *format, ...);
 void readSerial();
+void readSerialCommand();
 void returnCodes(int codeID);
+void sendResultRecord(byte j);
+void sendCutoffRecord(byte j);
+void sendStatsRecord(byte j);
+
+// Barcode.ino
+void barcodeCommand(char *args);
+void barcodeUpdate(byte j);
+void barcodeTelemetry();
+bool barcodeRegistered(byte j);
 
 // Button.ino
-void button();
+void buttonBegin();
+void buttonPush(ButtonEvent event);
+ButtonEvent buttonEvent();
 
 // LCD_UI.ino
 void cycleStateLCD();
 void cycleStateLCDOutput(byte j);
-
-// Timing.ino
-void secondsTimer(byte j);
-void clearSecondsTimer(byte j);
-void initializeVariables(byte j);
+void cycleStatsLCDOutput();
+
+// LCD_Frame.ino
+void lcdFrameReset();
+void lcdFrameInvalidate();
+void lcdFrameClear();
+void lcdFrameWrite(byte row, const char *text);
+void lcdFrameWrite_P(byte row, const char *text);
+void lcdFrameFlush();
+bool lcdFramePending();
+bool lcdFrameNext(byte &value, bool &character);
+void lcdFrameCommand(char *args);
+
+// LCD_TWI.ino
+void lcdBegin();
+void lcdTwiKick();
+
+// Timebase.ino
+void timebaseBegin();
+uint32_t timebaseMicros();
+void timebaseDelay(uint16_t ms);
 
 // StateMachine.ino
 void cycleStateValues();
-
-// Discharge.ino
-bool dischargeCycle(byte j);
+void cycleStateTelemetry(byte j);
 
 // Charge.ino
 bool chargeCycle(byte j);
 
-// Resistance.ino
-byte milliOhms(byte j);
-
 // Temperature.ino
 byte getTemperature(byte j);
-byte processTemperature(byte j);
 void getAmbientTemperature();
 
+// Cutoff.ino
+void cutoffArm(byte j, bool on);
+bool cutoffTripped(byte j, uint32_t &tripMillis);
+void cutoffSuspend();
+void cutoffResume();
+
 // IOUtils.ino
-bool  batteryCheck(byte j);
+void  shiftRegisterWrite(byte value);
 void  digitalSwitch(byte j, bool value);
 float readMux(const bool inputArray[]);
+float readBatteryVoltage(byte j);
+float readShuntVoltage(byte j);
+
+// Calibration.ino
+void  loadCalibration();
+void  saveCalibration();
+void  defaultCalibration();
+void  measureReferenceVoltage();
+void  calibrationCommand(char *args);
+
+// Checkpoint.ino
+byte loadCheckpoints();
+void saveCheckpoints();
+void checkpointCommand(char *args);
+
+// Watchdog.ino
+void watchdogEarlyInit() __attribute__((naked, used, section(".init3")));
+void watchdogStart();
+void watchdogService();
+void watchdogReport();
+byte watchdogEnter(byte task);
+void watchdogLeave(byte task, byte outer);
+void watchdogRestore(byte outer);
+
+// Memory.ino
+void memoryPaint() __attribute__((naked, used, section(".init1")));
+void memoryCheck();
+void memoryCommand(char *args);
+
+// ----------------------
+// Cycle engine wiring
+// ----------------------
+
+class BoardIO : public CycleIO
+{
+public:
+  float   batteryVoltage(uint8_t j)           { return readBatteryVoltage(j); }
+  float   shuntVoltage(uint8_t j)             { return readShuntVoltage(j); }
+  bool    chargerDone(uint8_t j)              { return chargeCycle(j); }
+  void    setCharger(uint8_t j, bool on)      { digitalSwitch(modulePins[j].chargeMosfetPin, on); }
+  void    setDischarge(uint8_t j, bool on)    { digitalSwitch(modulePins[j].dischargeMosfetPin, on); cutoffArm(j, on); }
+  uint8_t temperature(uint8_t j)              { return getTemperature(j); }
+  uint8_t ambientTemperature()                { return ::ambientTemperature; }
+  bool    dischargeTripped(uint8_t j, uint32_t &tripMillis) { return cutoffTripped(j, tripMillis); }
+};
+
+class BoardClock : public CycleClock
+{
+public:
+  uint32_t millis() { return ::millis(); }
+};
+
+BoardIO     boardIO;
+BoardClock  boardClock;
+CycleEngine cycleEngine(module, 4, cycleSettings, boardIO, boardClock);
 
 // ----------------------
 // setup() and loop()
@@ -245,7 +356,7 @@ void setup()
   digitalWrite(S3, LOW);
 
   // Button
-  pinMode(BTN, INPUT);
+  buttonBegin();
 
   // Buzzer
   pinMode(BUZZ, OUTPUT);
@@ -260,70 +371,83 @@ void setup()
   DBG_BEGIN(115200);
   Serial.setTimeout(5);
 
+  // Culprit of the last watchdog reset, if any
+  watchdogReport();
+
   // SoftwareSerial to ESP8266
   ESP8266.begin(57600);
   ESP8266.setTimeout(5);
 
   // LCD startup
-  lcd.init();
-  lcd.clear();
-  lcd.backlight();
-  lcd.setCursor(0, 0);
-  lcd.print(F("ASCD NANO V1.0.2"));
-  lcd.setCursor(0, 1);
-  lcd.print(F("Init TP5100....."));
+  lcdBegin();
+  lcdFrameReset();
+  lcdFrameWrite_P(0, PSTR("ASCD NANO V1.0.2"));
+  lcdFrameWrite_P(1, PSTR("Init TP5100....."));
+  lcdFrameFlush();
+
+  // Per-slot calibration and first AVcc measurement
+  loadCalibration();
+  measureReferenceVoltage();
+
+  // Start DallasTemperature library
+  sensors.begin();
+
+  // Slots with a valid checkpoint carry on where they stopped
+  byte resumedSlots = loadCheckpoints();
 
   // Initial module / MOSFET sequence & mux pre-pull down
   for (byte i = 0; i < settings.moduleCount; i++)
   {
+    if (bitRead(resumedSlots, i))
+      continue;
+
     digitalWrite(FAN, HIGH); // Fan on during initialisation
 
-    digitalSwitch(module[i].chargeMosfetPin, 1);
+    digitalSwitch(modulePins[i].chargeMosfetPin, 1);
     delay(500);
-    digitalSwitch(module[i].chargeMosfetPin, 0);
+    digitalSwitch(modulePins[i].chargeMosfetPin, 0);
     delay(500);
 
     // Read each battery voltage input to discharge stray charge
-    readMux(module[i].batteryVolatgePin);
+    readMux(modulePins[i].batteryVolatgePin);
 
-    digitalSwitch(module[i].dischargeMosfetPin, 1);
+    digitalSwitch(modulePins[i].dischargeMosfetPin, 1);
     digitalWrite(FAN, LOW); // Fan off
     delay(500);
-    digitalSwitch(module[i].dischargeMosfetPin, 0);
+    digitalSwitch(modulePins[i].dischargeMosfetPin, 0);
     delay(500);
   }
 
-  lcd.setCursor(0, 1);
-  lcd.print(F("Starting........"));
+  lcdFrameWrite_P(1, PSTR("Starting........"));
+  lcdFrameFlush();
 
-  // Start DallasTemperature library
-  sensors.begin();
+  lcdFrameClear();
 
-  lcd.clear();
+  // Timer1 takes over millis() so Timer0 can run the fan at 25 kHz
+  timebaseBegin();
+  fanBegin();
+  watchdogStart();
 }
 
 void loop()
 {
+  watchdogService();
+
+  // Polled every pass, so it names the culprit of a hang but is not the telemetry heartbeat
+  byte outerTask = watchdogEnter(TASK_TELEMETRY);
   if (readSerialResponse == true)
   {
     readSerial();
   }
+  watchdogRestore(outerTask);
+  readSerialCommand();
 
   // Timers using millis()
-  static long buttonMillis;
   static long cycleStateValuesMillis;
   static long sendSerialMillis;
   static long buzzerMillis;
   long currentMillis = millis();
 
-  // Poll button every 2 ms
-  if (currentMillis - buttonMillis >= 2)
-  {
-    button();
-    buttonMillis = currentMillis;
-  }
-
-  currentMillis = millis();
   // Buzzer update every 50 ms
   if (currentMillis - buzzerMillis >= 50)
   {
@@ -336,6 +460,7 @@ void loop()
   if (currentMillis - cycleStateValuesMillis >= 1000)
   {
     cycleStateValues();
+    memoryCheck();
     cycleStateValuesMillis = currentMillis;
   }
 
@@ -345,8 +470,10 @@ void loop()
   {
     if (readSerialResponse == false || countSerialSend > 5)
     {
+      outerTask = watchdogEnter(TASK_TELEMETRY);
       sendSerial();
       countSerialSend = 0;
+      watchdogLeave(TASK_TELEMETRY, outerTask);
     }
     else
     {
@@ -0,0 +1,160 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * Local barcode ingestion.
+ *
+ * A slot in state 1 normally waits for the server to find a barcode for it
+ * and answer 100-103, a full Wi-Fi and HTTP round trip on every cell. A scanner
+ * on the host (fleetd -b, Tools/FleetController) can instead hand the barcode
+ * straight to the slot over USB serial:
+ *   BC<slot>=<barcode>   Reply BC<slot>=OK, BUSY (cell already running) or INVALID
+ *   BC                   Print BC<slot>=<barcode>,<state> for each slot
+ *                        (0 none, 1 queued, 2 starting, 3 unregistered)
+ *
+ * A scan is accepted in state 0 (cell going in) or 1 and starts the charge on
+ * the next tick in state 1. If the cell is pulled in state 0 or 1, or no cell
+ * reaches state 1 within barcodeQueueSeconds, the scan is dropped rather than
+ * given to the next cell. Once the cell has started, every telemetry frame
+ * carries
+ *   &BC<slot>=<barcode>
+ * until the server registers it and answers 100-103 for the slot; that code
+ * then only clears the registration. The barcode fields go after the slot
+ * states and only into the room left in the frame, the slot that goes first
+ * changes with every frame sent. The barcode is held in RAM, a reset before
+ * the server has answered loses it.
+ */
+
+const byte barcodeLength       = 20; // Longest barcode accepted, characters
+const byte barcodeQueueSeconds = 60; // A scan in state 0 waits this long for its cell to pass the insert check
+
+enum BarcodeState : byte
+{
+	BARCODE_NONE,
+	BARCODE_QUEUED,       // Scanned, the slot has not reached state 1 yet
+	BARCODE_STARTING,     // Handed to the slot in state 1
+	BARCODE_UNREGISTERED  // Cell started, the server has not confirmed the barcode
+};
+
+char barcodeCodes[4][barcodeLength + 1];
+byte barcodeStates[4] = {BARCODE_NONE, BARCODE_NONE, BARCODE_NONE, BARCODE_NONE};
+byte barcodeQueuedSeconds[4]; // Ticks the queued scan has waited in state 0
+bool barcodeCellSeen[4];      // A cell was in the slot since the scan
+
+void barcodeCommand(char *args)
+{
+	if (args[0] == '\0')
+	{
+		char line[barcodeLength + 10];
+		for (byte j = 0; j < settings.moduleCount; j++)
+		{
+			sprintf_P(line, PSTR("BC%d=%s,%d"), j, barcodeCodes[j], barcodeStates[j]);
+			Serial.println(line);
+		}
+		return;
+	}
+
+	byte j = args[0] - '0';
+	bool valid = j < settings.moduleCount && args[1] == '='; // Before reading past args[1], it may end the line
+	char *code = args + 2;
+	byte length = valid ? strlen(code) : 0;
+	valid = valid && length > 0 && length <= barcodeLength;
+	for (byte i = 0; valid && i < length; i++)
+	{
+		// '&' and '=' would split the telemetry field
+		valid = code[i] > ' ' && code[i] <= '~' && code[i] != '&' && code[i] != '=';
+	}
+	if (!valid)
+	{
+		Serial.println(F("BC=INVALID"));
+		return;
+	}
+
+	Serial.print(F("BC"));
+	Serial.print(j);
+	if (barcodeStates[j] == BARCODE_UNREGISTERED ||
+	    (module[j].cycleState != CYCLE_CHECK_BATTERY && module[j].cycleState != CYCLE_BARCODE))
+	{
+		Serial.println(F("=BUSY"));
+		return;
+	}
+	strcpy(barcodeCodes[j], code);
+	barcodeStates[j]        = BARCODE_QUEUED;
+	barcodeQueuedSeconds[j] = 0;
+	barcodeCellSeen[j]      = false;
+	barcodeUpdate(j); // Already waiting in state 1: start on this tick
+	Serial.println(F("=OK"));
+}
+
+void barcodeUpdate(byte j)
+{
+	switch (barcodeStates[j])
+	{
+	case BARCODE_QUEUED:
+	case BARCODE_STARTING:
+		if (module[j].cycleState == CYCLE_BARCODE)
+		{
+			module[j].batteryBarcode = true;
+			barcodeStates[j] = BARCODE_STARTING;
+		}
+		else if (module[j].cycleState != CYCLE_CHECK_BATTERY)
+		{
+			barcodeStates[j] = BARCODE_UNREGISTERED;
+		}
+		else if (barcodeStates[j] == BARCODE_STARTING)
+		{
+			barcodeStates[j] = BARCODE_NONE; // Pulled before the charge started
+		}
+		else
+		{
+			// Still in state 0: the cell was pulled during the insert check, or never came
+			bool cell = module[j].batteryVoltage > cycleSettings.batteryVolatgeLeak;
+			if ((barcodeCellSeen[j] && !cell) || ++barcodeQueuedSeconds[j] >= barcodeQueueSeconds)
+				barcodeStates[j] = BARCODE_NONE;
+			barcodeCellSeen[j] = barcodeCellSeen[j] || cell;
+		}
+		break;
+	case BARCODE_UNREGISTERED:
+		if (module[j].cycleState == CYCLE_CHECK_BATTERY)
+			barcodeStates[j] = BARCODE_NONE; // Cell gone, nothing left to register it for
+		break;
+	}
+}
+
+void barcodeTelemetry()
+{
+	// A full frame does not leave out the same barcode every time
+	for (byte n = 0; n < settings.moduleCount; n++)
+	{
+		byte j = (telemetryFrames + n) % settings.moduleCount;
+		if (barcodeStates[j] == BARCODE_UNREGISTERED)
+			telemetryAppend_P(PSTR("&BC%d=%s"), j, barcodeCodes[j]);
+	}
+}
+
+bool barcodeRegistered(byte j)
+{
+	if (barcodeStates[j] != BARCODE_UNREGISTERED)
+		return false;
+	barcodeStates[j] = BARCODE_NONE;
+	return true;
+}
@@ -22,20 +22,90 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 // Button.ino
 // Handles the front-panel button.
 
-void button()
+/**
+ * The button is sampled every 5 ms from the Timer2 compare interrupt, so
+ * presses are seen however long loop() is blocked. A pin change interrupt
+ * is not possible on this board: SoftwareSerial defines every PCINT vector,
+ * PCINT1 (A1) included.
+ *
+ * An integrator debounces the pin: it counts up while the pin reads pressed
+ * and down while released, and the state only flips at the ends (20 ms).
+ * Releasing before buttonLongPressMillis gives BUTTON_SHORT; holding that
+ * long gives BUTTON_LONG at once, and no short press on release. Events go
+ * into a single producer, single consumer ring: the ISR only moves the
+ * head, buttonEvent() only moves the tail, and both are single bytes, so
+ * neither side needs to disable interrupts. A full ring drops the press.
+ */
+
+const byte buttonSampleHz      = 200;
+const byte buttonDebounceTicks = 4;
+const byte buttonQueueSize     = 4; // Power of two
+
+volatile byte buttonQueue[buttonQueueSize];
+volatile byte buttonHead = 0; // Written by the ISR only
+volatile byte buttonTail = 0; // Written by buttonEvent() only
+
+void buttonBegin()
+{
+  pinMode(BTN, INPUT); // External pull-up, active low
+
+  // Timer2 CTC, /1024, compare A at buttonSampleHz
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20);
+  OCR2A  = F_CPU / 1024 / buttonSampleHz - 1;
+  TIMSK2 = _BV(OCIE2A);
+}
+
+void buttonPush(ButtonEvent event)
+{
+  byte next = (buttonHead + 1) & (buttonQueueSize - 1);
+  if (next == buttonTail)
+    return;
+  buttonQueue[buttonHead] = event;
+  buttonHead = next;
+  soundBuzzer = true;
+}
+
+// Oldest queued event, BUTTON_NONE if there is none
+ButtonEvent buttonEvent()
 {
-  boolean buttonState      = 0;
-  static boolean lastState = 0;
+  byte tail = buttonTail;
+  if (tail == buttonHead)
+    return BUTTON_NONE;
+  ButtonEvent event = (ButtonEvent)buttonQueue[tail];
+  buttonTail = (tail + 1) & (buttonQueueSize - 1);
+  return event;
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+  static byte     integrator = 0;
+  static bool     pressed    = false;
+  static uint16_t heldTicks  = 0;
+  const uint16_t  longTicks  = (uint32_t)settings.buttonLongPressMillis * buttonSampleHz / 1000;
 
-  buttonState = digitalRead(BTN);
+  if (!(PINC & _BV(PC1))) // BTN is A1 = PC1
+  {
+    if (integrator < buttonDebounceTicks)
+      integrator++;
+  }
+  else if (integrator > 0)
+  {
+    integrator--;
+  }
 
-  if (buttonState != lastState)
+  if (!pressed && integrator == buttonDebounceTicks)
   {
-    if (buttonState == LOW) // active on press
-    {
-      buttonPressed = true;
-      soundBuzzer   = true;
-    }
+    pressed   = true;
+    heldTicks = 0;
   }
-  lastState = buttonState;
+  else if (pressed && integrator == 0)
+  {
+    pressed = false;
+    if (heldTicks < longTicks)
+      buttonPush(BUTTON_SHORT);
+  }
+
+  if (pressed && heldTicks < longTicks && ++heldTicks == longTicks)
+    buttonPush(BUTTON_LONG);
 }
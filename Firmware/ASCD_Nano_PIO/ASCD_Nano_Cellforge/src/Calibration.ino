@@ -0,0 +1,231 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * Per-slot calibration and AVcc compensation.
+ *
+ * AVcc is measured against the internal 1.1 V bandgap every tick, so supply
+ * sag no longer shifts the readings. The bandgap itself varies by up to 10 %
+ * between parts, so it is only used once calibrated with "CAL VCC".
+ *
+ * Serial commands (USB, newline terminated):
+ *   CAL SHOW             Print the calibration table
+ *   CAL VCC <volts>      Calibrate the bandgap from a measured 5 V rail
+ *   CAL P <slot> <volts> Capture a point from a known reference in an idle slot
+ *                        (one point sets gain, a second point sets gain and offset)
+ *   CAL SAVE / CAL RESET Store the table in EEPROM / restore defaults
+ */
+
+const byte calibrationVersion = 1;
+
+byte calibrationCrc()
+{
+	const byte *data = (const byte *)&calibration;
+	byte crc = 0;
+	for (byte i = 0; i < offsetof(Calibration, crc); i++)
+	{
+		crc = _crc8_ccitt_update(crc, data[i]);
+	}
+	return crc;
+}
+
+void defaultCalibration()
+{
+	calibration.version        = calibrationVersion;
+	calibration.bandgapVoltage = 0.0;
+	for (byte j = 0; j < 4; j++)
+	{
+		calibration.voltageGain[j]   = 1.0;
+		calibration.voltageOffset[j] = 0.0;
+		calibration.shuntGain[j]     = 1.0;
+		calibration.shuntOffset[j]   = 0.0;
+	}
+}
+
+void loadCalibration()
+{
+	EEPROM.get(calibrationAddress, calibration);
+	if (calibration.version != calibrationVersion || calibration.crc != calibrationCrc())
+	{
+		defaultCalibration();
+		LOG(CAL_DEFAULTS);
+	}
+}
+
+void saveCalibration()
+{
+	calibration.crc = calibrationCrc();
+	EEPROM.put(calibrationAddress, calibration);
+}
+
+float readBandgap()
+{
+	unsigned int bandgapSum = 0;
+
+	cutoffSuspend();
+	ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1); // AVcc reference, 1.1 V bandgap input
+	timebaseDelay(1);										  // Let the bandgap settle on the sample capacitor
+	for (byte i = 0; i < 9; i++)
+	{
+		ADCSRA |= _BV(ADSC);
+		while (ADCSRA & _BV(ADSC))
+			;
+		if (i > 0) // First conversion after switching the input is discarded
+			bandgapSum += ADC;
+	}
+	cutoffResume();
+	return bandgapSum / 8.0;
+}
+
+void measureReferenceVoltage()
+{
+	static bool vccMeasured = false;
+
+	if (calibration.bandgapVoltage <= 0.0)
+	{
+		vccVoltage  = settings.referenceVoltage;
+		vccMeasured = false;
+		return;
+	}
+
+	float bandgapReading = readBandgap();
+	if (bandgapReading < 1.0)
+		return;
+	float measuredVcc = calibration.bandgapVoltage * 1023.0 / bandgapReading;
+	vccVoltage  = vccMeasured ? (vccVoltage * 0.75) + (measuredVcc * 0.25) : measuredVcc;
+	vccMeasured = true;
+}
+
+void printCalibration()
+{
+	Serial.print(F("CAL BG="));
+	Serial.print(calibration.bandgapVoltage, 4);
+	Serial.print(F(" VCC="));
+	Serial.println(vccVoltage, 3);
+	for (byte j = 0; j < settings.moduleCount; j++)
+	{
+		Serial.print(F("CAL "));
+		Serial.print(j);
+		Serial.print(F(" VG="));
+		Serial.print(calibration.voltageGain[j], 4);
+		Serial.print(F(" VO="));
+		Serial.print(calibration.voltageOffset[j], 4);
+		Serial.print(F(" SG="));
+		Serial.print(calibration.shuntGain[j], 4);
+		Serial.print(F(" SO="));
+		Serial.println(calibration.shuntOffset[j], 4);
+	}
+}
+
+void calibrationCommand(char *args)
+{
+	// First captured point of the guided two point calibration
+	static byte  pointSlot = 255;
+	static float pointVolts;
+	static float pointVoltageRaw;
+	static float pointShuntRaw;
+
+	char *command = strtok(args, " ");
+	char *value   = strtok(NULL, " ");
+
+	if (command == NULL || strcmp_P(command, PSTR("SHOW")) == 0)
+	{
+		printCalibration();
+	}
+	else if (strcmp_P(command, PSTR("VCC")) == 0)
+	{
+		float volts = value == NULL ? 0.0 : atof(value);
+		if (volts < 4.0 || volts > 5.5)
+		{
+			Serial.println(F("CAL_ERROR_VCC"));
+			return;
+		}
+		calibration.bandgapVoltage = volts * readBandgap() / 1023.0;
+		vccVoltage = volts;
+		printCalibration();
+	}
+	else if (strcmp_P(command, PSTR("P")) == 0)
+	{
+		char *voltsValue = strtok(NULL, " ");
+		byte slot  = value == NULL ? 255 : atoi(value);
+		float volts = voltsValue == NULL ? 0.0 : atof(voltsValue);
+		if (slot >= settings.moduleCount || volts < 0.5)
+		{
+			Serial.println(F("CAL_ERROR_POINT"));
+			return;
+		}
+		if (module[slot].cycleState > 1) // Never calibrate a slot with MOSFETs in use
+		{
+			Serial.println(F("CAL_ERROR_SLOT_BUSY"));
+			return;
+		}
+
+		float voltageRaw = readMux(modulePins[slot].batteryVolatgePin);
+		float shuntRaw   = readMux(modulePins[slot].batteryVolatgeDropPin);
+		if (voltageRaw < 0.1 || shuntRaw < 0.1)
+		{
+			Serial.println(F("CAL_ERROR_NO_INPUT"));
+			return;
+		}
+
+		if (pointSlot == slot && fabs(volts - pointVolts) >= 0.5 && fabs(voltageRaw - pointVoltageRaw) >= 0.1 && fabs(shuntRaw - pointShuntRaw) >= 0.1)
+		{
+			// Second point: gain and offset
+			calibration.voltageGain[slot]   = (volts - pointVolts) / (voltageRaw - pointVoltageRaw);
+			calibration.voltageOffset[slot] = volts - (calibration.voltageGain[slot] * voltageRaw);
+			calibration.shuntGain[slot]     = (volts - pointVolts) / (shuntRaw - pointShuntRaw);
+			calibration.shuntOffset[slot]   = volts - (calibration.shuntGain[slot] * shuntRaw);
+			pointSlot = 255;
+			Serial.println(F("CAL_POINT_2_OK SEND CAL SAVE"));
+		}
+		else
+		{
+			// First point: gain only until a second reference is captured
+			calibration.voltageGain[slot]   = volts / voltageRaw;
+			calibration.voltageOffset[slot] = 0.0;
+			calibration.shuntGain[slot]     = volts / shuntRaw;
+			calibration.shuntOffset[slot]   = 0.0;
+			pointSlot       = slot;
+			pointVolts      = volts;
+			pointVoltageRaw = voltageRaw;
+			pointShuntRaw   = shuntRaw;
+			Serial.println(F("CAL_POINT_1_OK APPLY 2ND REF >=0.5V AWAY"));
+		}
+		printCalibration();
+	}
+	else if (strcmp_P(command, PSTR("SAVE")) == 0)
+	{
+		saveCalibration();
+		Serial.println(F("CAL_SAVED"));
+	}
+	else if (strcmp_P(command, PSTR("RESET")) == 0)
+	{
+		defaultCalibration();
+		pointSlot = 255;
+		measureReferenceVoltage();
+		Serial.println(F("CAL_RESET"));
+	}
+	else
+	{
+		Serial.println(F("CAL_UNKNOWN"));
+	}
+}
@@ -26,7 +26,7 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 bool chargeCycle(byte j)
 {
   // If the charge LED sense voltage is above the mid threshold, treat as “done”
-  if (readMux(module[j].chargeLedPin) >= settings.chargeLedPinMidVolatge[j]) // Mid On / Off Voltage of the TP5100 Charge LED Pin
+  if (readMux(modulePins[j].chargeLedPin) >= settings.chargeLedPinMidVolatge[j]) // Mid On / Off Voltage of the TP5100 Charge LED Pin
   {
     return 1;
   }
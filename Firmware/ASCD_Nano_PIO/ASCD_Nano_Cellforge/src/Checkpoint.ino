@@ -0,0 +1,212 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * EEPROM checkpoint ring, resume after a reset or brown-out.
+ *
+ * Each slot is checkpointed on every state change and every
+ * cycleSettings.checkpointMinutes in a long state. Entries go round a ring of
+ * checkpointEntries records after the calibration table, so every EEPROM cell
+ * is written once per checkpointEntries checkpoints instead of every time.
+ * On boot the newest entry with a good CRC is used for each slot, and the slot
+ * resumes if a cell is in it that reads within
+ * cycleSettings.resumeVoltageWindow of the saved OCV. That tells a swapped cell
+ * from the same one only when their states of charge differ; a cell swapped
+ * for one at the same voltage carries on with the old cell's figures.
+ *
+ * Write budget (100,000 cycles per cell, 27 entries): at the 3 minute default
+ * bench/CycleEngineBench.cpp measures about 115 checkpoints per hour over full
+ * cycles on 4 slots (state changes included), giving about 2.7 years of
+ * continuous cycling. "CKPT" prints the measured rate and the projected life.
+ *
+ * At most one entry is written per tick, a write takes about 100 ms.
+ *
+ * Serial commands (USB, newline terminated):
+ *   CKPT                 Print the ring, write rate and projected EEPROM life
+ *   CKPT CLEAR           Erase the ring, slots start fresh after the next reset
+ */
+
+const unsigned long eepromEndurance = 100000; // Rated write cycles per EEPROM cell
+
+uint16_t checkpointSequence = 0;
+byte     checkpointNext     = 0;
+uint16_t checkpointWrites   = 0; // Since boot
+
+int entryAddress(byte index)
+{
+	return checkpointAddress + (index * sizeof(CheckpointEntry));
+}
+
+byte checkpointCrc(const CheckpointEntry &entry)
+{
+	const byte *data = (const byte *)&entry;
+	byte crc = 0;
+	for (byte i = 0; i < offsetof(CheckpointEntry, crc); i++)
+	{
+		crc = _crc8_ccitt_update(crc, data[i]);
+	}
+	return crc;
+}
+
+bool readCheckpoint(byte index, CheckpointEntry &entry)
+{
+	EEPROM.get(entryAddress(index), entry);
+	return entry.slot < 4 && entry.crc == checkpointCrc(entry);
+}
+
+byte loadCheckpoints()
+{
+	// Newest valid entry per slot, and the newest overall to continue the ring from
+	int  newestIndex[4] = {-1, -1, -1, -1};
+	int  ringNewest     = -1;
+	uint16_t newestSequence[4];
+	CheckpointEntry entry;
+	byte resumedSlots = 0;
+
+	for (byte index = 0; index < checkpointEntries; index++)
+	{
+		if (!readCheckpoint(index, entry))
+			continue;
+		// Sequence numbers wrap, compare by signed difference
+		if (newestIndex[entry.slot] < 0 || (int16_t)(entry.sequence - newestSequence[entry.slot]) > 0)
+		{
+			newestIndex[entry.slot]    = index;
+			newestSequence[entry.slot] = entry.sequence;
+		}
+		if (ringNewest < 0 || (int16_t)(entry.sequence - checkpointSequence) > 0)
+		{
+			ringNewest         = index;
+			checkpointSequence = entry.sequence;
+		}
+	}
+	if (ringNewest >= 0)
+	{
+		checkpointNext = (ringNewest + 1) % checkpointEntries;
+		checkpointSequence++;
+	}
+
+	for (byte j = 0; j < settings.moduleCount; j++)
+	{
+		if (newestIndex[j] < 0)
+			continue;
+		readCheckpoint(newestIndex[j], entry);
+		if (cycleEngine.resume(j, entry.checkpoint))
+		{
+			bitSet(resumedSlots, j);
+			LOG(RESUME, j, module[j].cycleState, entry.checkpoint.elapsedSeconds);
+		}
+	}
+	return resumedSlots;
+}
+
+void saveCheckpoints()
+{
+	// One entry per tick, starting after the slot written last so no slot starves
+	static byte lastSlot = 0;
+	CheckpointEntry entry;
+
+	for (byte n = 1; n <= settings.moduleCount; n++)
+	{
+		byte j = (lastSlot + n) % settings.moduleCount;
+		if (!cycleEngine.checkpointDue(j))
+			continue;
+
+		entry.sequence = checkpointSequence++;
+		entry.slot     = j;
+		cycleEngine.checkpoint(j, entry.checkpoint);
+		entry.crc      = checkpointCrc(entry);
+		EEPROM.put(entryAddress(checkpointNext), entry);
+
+		checkpointNext = (checkpointNext + 1) % checkpointEntries;
+		checkpointWrites++;
+		lastSlot = j;
+		return;
+	}
+}
+
+void printCheckpoints()
+{
+	CheckpointEntry entry;
+	float uptimeHours = millis() / 3600000.0;
+
+	Serial.print(F("CKPT N="));
+	Serial.print(checkpointEntries);
+	Serial.print(F(" SEQ="));
+	Serial.print(checkpointSequence);
+	Serial.print(F(" NEXT="));
+	Serial.print(checkpointNext);
+	Serial.print(F(" W="));
+	Serial.print(checkpointWrites);
+	if (checkpointWrites > 0 && uptimeHours > 0.0)
+	{
+		// Every cell takes one write per lap of the ring
+		float writesPerHour = checkpointWrites / uptimeHours;
+		Serial.print(F(" WPH="));
+		Serial.print(writesPerHour, 1);
+		Serial.print(F(" LIFE_DAYS="));
+		Serial.print((float)checkpointEntries * eepromEndurance / writesPerHour / 24.0, 0);
+	}
+	Serial.println();
+
+	for (byte index = 0; index < checkpointEntries; index++)
+	{
+		if (!readCheckpoint(index, entry))
+			continue;
+		Serial.print(F("CKPT "));
+		Serial.print(index);
+		Serial.print(F(" Q="));
+		Serial.print(entry.sequence);
+		Serial.print(F(" M="));
+		Serial.print(entry.slot);
+		Serial.print(F(" CS="));
+		Serial.print(entry.checkpoint.cycleState);
+		Serial.print(F(" S="));
+		Serial.print(entry.checkpoint.elapsedSeconds);
+		Serial.print(F(" MAH="));
+		Serial.println((int)entry.checkpoint.dischargeMilliamps);
+	}
+}
+
+void checkpointCommand(char *args)
+{
+	char *command = strtok(args, " ");
+
+	if (command == NULL)
+	{
+		printCheckpoints();
+	}
+	else if (strcmp_P(command, PSTR("CLEAR")) == 0)
+	{
+		for (int address = checkpointAddress; address < entryAddress(checkpointEntries); address++)
+		{
+			EEPROM.update(address, 0xFF);
+			wdt_reset(); // Up to 3.4 ms per byte, about 3 s for the whole ring
+		}
+		checkpointNext     = 0;
+		checkpointSequence = 0;
+		Serial.println(F("CKPT_CLEARED"));
+	}
+	else
+	{
+		Serial.println(F("UNKNOWN_COMMAND"));
+	}
+}
@@ -0,0 +1,186 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * Hardware end-of-discharge cutoff.
+ *
+ * The analog comparator pins (AIN0 / AIN1 = D6 / D7) drive the shift
+ * register, so the cutoff uses the ADC interrupt as a window comparator.
+ * While slots discharge, the ADC converts their battery voltage channels on
+ * Timer1 compare match B, once per 1024 us timebase period (Timebase.ino).
+ * Each armed slot in turn gets one discarded conversion after the mux switch
+ * and then cutoffConfirmSamples conversions. If they are all below the
+ * cutoff, the ISR opens that slot's discharge MOSFET and records millis(),
+ * 5 ms after the voltage dropped with one slot armed and 20 ms with four.
+ *
+ * The timer trigger keeps the ISR at ~1 kHz rather than the ~9.6 kHz of
+ * back to back conversions. Every ISR that lands on a start bit delays
+ * SoftwareSerial's sampling of the ESP8266 link (17 us bits at 57600) by its
+ * own length, so a tenth of the ISRs is a tenth of the exposure.
+ *
+ * readMux() and readBandgap() suspend the watcher while they use the ADC.
+ */
+
+// S0..S3 (pins 12, 11, 10, 9) are PB4..PB1, switched directly from the ISR
+const byte cutoffMuxMask = _BV(PB4) | _BV(PB3) | _BV(PB2) | _BV(PB1);
+
+volatile byte          cutoffArmed       = 0; // Slots being watched, bit per slot
+volatile byte          cutoffTrippedMask = 0; // Slots opened by the ISR, not yet collected
+volatile unsigned long cutoffTripMillis[4];
+volatile int           cutoffCounts[4];       // Cutoff as a raw ADC reading per slot
+byte                   cutoffMuxBits[4];      // PORTB bits selecting the slot's battery voltage channel
+volatile byte          cutoffSlot        = 0;
+volatile byte          cutoffSamples     = 0;
+volatile byte          cutoffBelow       = 0;
+volatile bool          cutoffRunning     = false;
+bool                   cutoffHeld        = false;
+
+void cutoffSelectNext()
+{
+	// Next armed slot after the current one (the same slot if it is the only one)
+	for (byte n = 1; n <= 4; n++)
+	{
+		byte j = (cutoffSlot + n) % 4;
+		if (cutoffArmed & _BV(j))
+		{
+			cutoffSlot = j;
+			break;
+		}
+	}
+	PORTB = (PORTB & ~cutoffMuxMask) | cutoffMuxBits[cutoffSlot];
+	cutoffSamples = 0;
+	cutoffBelow   = 0;
+}
+
+ISR(ADC_vect)
+{
+	int  reading = ADC;
+	byte j       = cutoffSlot;
+
+	TIFR1 = _BV(OCF1B); // The trigger is the flag's rising edge, clear it for the next match
+
+	if (cutoffSamples > 0 && reading < cutoffCounts[j]) // First conversion after a mux switch is discarded
+		cutoffBelow++;
+	cutoffSamples++;
+
+	if (cutoffSamples > settings.cutoffConfirmSamples)
+	{
+		if (cutoffBelow >= settings.cutoffConfirmSamples && (cutoffArmed & _BV(j)))
+		{
+			// Loaded voltage below cutoff on every sample: open the discharge MOSFET now
+			shiftRegisterState &= ~_BV(modulePins[j].dischargeMosfetPin);
+			shiftRegisterWrite(shiftRegisterState);
+			cutoffArmed &= ~_BV(j);
+			cutoffTrippedMask |= _BV(j);
+			cutoffTripMillis[j] = millis();
+		}
+		if (cutoffArmed)
+			cutoffSelectNext();
+	}
+
+	if (!cutoffArmed)
+	{
+		ADCSRA &= ~(_BV(ADIE) | _BV(ADATE));
+		cutoffRunning = false;
+	}
+}
+
+void cutoffStart()
+{
+	if (cutoffRunning || cutoffHeld || !cutoffArmed)
+		return;
+	ADMUX = _BV(REFS0); // AVcc reference, SIG (A0) input, as analogRead(SIG) sets it
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		cutoffSelectNext();
+		cutoffRunning = true;
+		OCR1B  = OCR1A / 2;                // Halfway between the timebase ticks
+		ADCSRB = _BV(ADTS2) | _BV(ADTS0); // Auto trigger on Timer1 compare match B
+		TIFR1  = _BV(OCF1B);
+		ADCSRA |= _BV(ADIF); // Drop the flag left by the last polled conversion
+		ADCSRA |= _BV(ADIE) | _BV(ADATE);
+	}
+}
+
+void cutoffSuspend()
+{
+	cutoffHeld = true;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ADCSRA &= ~(_BV(ADIE) | _BV(ADATE)); // Polled conversions must not be retriggered
+		cutoffRunning = false;
+	}
+	while (ADCSRA & _BV(ADSC)) // Let the conversion in flight finish
+		;
+}
+
+void cutoffResume()
+{
+	cutoffHeld = false;
+	cutoffStart();
+}
+
+void cutoffArm(byte j, bool on)
+{
+	if (!settings.hardwareCutoff)
+		return;
+
+	if (on)
+	{
+		// Cutoff in raw ADC counts for this slot's calibration and the current AVcc
+		float raw = (cycleSettings.defaultBatteryCutOffVoltage - calibration.voltageOffset[j]) / calibration.voltageGain[j];
+		int counts = raw * 1023.0 / vccVoltage;
+		byte muxBits = 0;
+		if (modulePins[j].batteryVolatgePin[0]) muxBits |= _BV(PB4); // S0
+		if (modulePins[j].batteryVolatgePin[1]) muxBits |= _BV(PB3); // S1
+		if (modulePins[j].batteryVolatgePin[2]) muxBits |= _BV(PB2); // S2
+		if (modulePins[j].batteryVolatgePin[3]) muxBits |= _BV(PB1); // S3
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			cutoffCounts[j]  = counts;
+			cutoffMuxBits[j] = muxBits;
+			cutoffTrippedMask &= ~_BV(j);
+			cutoffArmed |= _BV(j);
+		}
+		cutoffStart();
+	}
+	else
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			cutoffArmed &= ~_BV(j);
+		}
+	}
+}
+
+bool cutoffTripped(byte j, uint32_t &tripMillis)
+{
+	bool tripped;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		tripped    = cutoffTrippedMask & _BV(j);
+		tripMillis = cutoffTripMillis[j];
+		cutoffTrippedMask &= ~_BV(j);
+	}
+	return tripped;
+}
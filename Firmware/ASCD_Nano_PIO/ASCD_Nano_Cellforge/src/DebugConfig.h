@@ -21,17 +21,156 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 */
 
 // DebugConfig.h
-// Global debug configuration and helper macros.
+// Global debug configuration and the binary log.
+//
+// LOG(name, args...) sends token `name` from LogTokens.h with its arguments as
+// raw little-endian bytes, the format strings never reach the flash:
+//   0x1E <token> <arguments> '\n'
+// with 0x00, 0x0A, 0x0D, 0x1B and 0x1E inside the frame sent as 0x1B, byte ^
+// 0x20, so a frame is one C string line to anything reading the USB serial
+// port line by line. logdecode/ turns a capture back into text.
+//
+// Tokens above LOG_LEVEL or outside LOG_MODULES compile out, arguments
+// included. A frame that does not fit in the UART transmit buffer is dropped
+// rather than waited for and counted in the next DROPPED token. Not for use
+// from interrupts.
+
+#include "LogTokens.h"
 
 // Set to 1 to enable debug output, 0 to disable
 #define DEBUG_ENABLED 1
 
+// Most verbose level sent, and the modules sent (bit LOG_MODULE_<name>)
+#define LOG_LEVEL   LOG_DEBUG
+#define LOG_MODULES 0xFF
+
 #if DEBUG_ENABLED
   #define DBG_BEGIN(baud)   Serial.begin(baud)
-  #define DBG_PRINT(x)      Serial.print(x)
-  #define DBG_PRINTLN(x)    Serial.println(x)
 #else
   #define DBG_BEGIN(baud)   // no-op
-  #define DBG_PRINT(x)      // no-op
-  #define DBG_PRINTLN(x)    // no-op
+  #undef LOG_LEVEL
+  #define LOG_LEVEL         LOG_OFF
 #endif
+
+#define LOG(name, ...)                                           \
+  do                                                             \
+  {                                                              \
+    if (LOG_ENABLED_##name)                                      \
+      logWrite<LOG_LAYOUT_##name>(LOG_ID_##name, ##__VA_ARGS__); \
+  } while (0)
+
+const byte logFrameStart = 0x1E;
+const byte logEscape     = 0x1B;
+
+// Argument layout of a format, a nibble per argument: 1 one byte, 2 two bytes, 3 four bytes, 4 float
+constexpr uint32_t logLayout(const char *format, byte shift = 0);
+
+constexpr uint32_t logLayoutSpec(const char *spec, byte shift)
+{
+  return (*spec >= '0' && *spec <= '9') || *spec == '.' || *spec == '-' || *spec == '+' || *spec == ' ' || *spec == '#'
+           ? logLayoutSpec(spec + 1, shift)
+         : *spec == 'l' ? (3UL << shift) | logLayout(spec + 2, shift + 4)
+         : *spec == 'h' ? (1UL << shift) | logLayout(spec + 3, shift + 4)
+         : *spec == 'c' ? (1UL << shift) | logLayout(spec + 1, shift + 4)
+         : *spec == 'f' ? (4UL << shift) | logLayout(spec + 1, shift + 4)
+         : (2UL << shift) | logLayout(spec + 1, shift + 4);
+}
+
+constexpr uint32_t logLayout(const char *format, byte shift)
+{
+  return *format == '\0' ? 0
+         : *format != '%' ? logLayout(format + 1, shift)
+         : format[1] == '%' ? logLayout(format + 2, shift)
+         : logLayoutSpec(format + 1, shift);
+}
+
+constexpr byte logLayoutBytes(uint32_t layout)
+{
+  return layout == 0 ? 0 : ((layout & 0xF) == 1 ? 1 : (layout & 0xF) == 2 ? 2 : 4) + logLayoutBytes(layout >> 4);
+}
+
+// Only the filter and the layout of each token are compiled in
+#define LOG_TOKEN_CONSTANTS(name, module, level, format)                                                      \
+  const bool         LOG_ENABLED_##name = level <= LOG_LEVEL && ((LOG_MODULES >> LOG_MODULE_##module) & 1); \
+  constexpr uint32_t LOG_LAYOUT_##name  = logLayout(format);
+LOG_TOKENS(LOG_TOKEN_CONSTANTS)
+#undef LOG_TOKEN_CONSTANTS
+
+uint16_t logDropped = 0; // Frames dropped since the last DROPPED token
+
+inline void logByte(byte value)
+{
+  if (value == '\0' || value == '\n' || value == '\r' || value == logFrameStart || value == logEscape)
+  {
+    Serial.write(logEscape);
+    value ^= 0x20;
+  }
+  Serial.write(value);
+}
+
+inline void logValue(uint32_t value, byte bytes)
+{
+  for (byte b = 0; b < bytes; b++)
+  {
+    logByte(value);
+    value >>= 8;
+  }
+}
+
+// Room in the transmit buffer for a frame of `bytes` arguments, escapes included
+inline bool logReserve(byte bytes)
+{
+  byte needed = 3 + 2 * bytes;
+  if (logDropped != 0 && LOG_ENABLED_DROPPED)
+    needed += 3 + 2 * 2;
+  if (Serial.availableForWrite() < needed)
+  {
+    if (logDropped != 0xFFFF)
+      logDropped++;
+    return false;
+  }
+  if (logDropped != 0 && LOG_ENABLED_DROPPED)
+  {
+    Serial.write(logFrameStart);
+    logByte(LOG_ID_DROPPED);
+    logValue(logDropped, 2);
+    Serial.write('\n');
+  }
+  logDropped = 0;
+  return true;
+}
+
+template <uint32_t layout>
+inline void logArgs()
+{
+  static_assert(layout == 0, "LOG: fewer arguments than the format takes");
+}
+
+template <uint32_t layout, typename T, typename... Rest>
+inline void logArgs(T value, Rest... rest)
+{
+  static_assert((layout & 0xF) != 0, "LOG: more arguments than the format takes");
+  if ((layout & 0xF) == 4)
+  {
+    float    number = value;
+    uint32_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    logValue(bits, 4);
+  }
+  else
+  {
+    logValue((uint32_t)(long)value, (layout & 0xF) == 3 ? 4 : (layout & 0xF));
+  }
+  logArgs<(layout >> 4)>(rest...);
+}
+
+template <uint32_t layout, typename... Args>
+inline void logWrite(byte token, Args... args)
+{
+  if (!logReserve(1 + logLayoutBytes(layout)))
+    return;
+  Serial.write(logFrameStart);
+  logByte(token);
+  logArgs<layout>(args...);
+  Serial.write('\n');
+}
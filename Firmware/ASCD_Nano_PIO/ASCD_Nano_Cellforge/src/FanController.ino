@@ -21,56 +21,127 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 */
 
 // FanController.ino
-// Controls the cooling fan based on temperature and discharge state.
+// Controls the cooling fan based on slot temperatures and discharge state.
+
+/**
+ * Timer0 runs fast PWM with TOP = OCR0A: /8 and 80 steps give 25 kHz on
+ * OC0B (pin 5), above hearing and the frequency PC fans are built for.
+ * Timer1 keeps millis() going (Timebase.ino).
+ *
+ * Once a second a PI loop sets the duty from the hottest slot's rise over
+ * ambient, holding it at settings.fanRiseSetpoint. The integral is clamped
+ * to the duty range and held while the output is pinned in the direction
+ * of the error. On top of that:
+ *   - a discharging slot keeps at least settings.fanDischargeDuty, the load
+ *     resistors heat the board before the cell sensor sees it
+ *   - ambient at settings.fanAmbientMax or above runs the fan flat out
+ *   - below settings.pwmFanMinStart the fan stalls: a running fan is held
+ *     there down to half of it, a stopped one is not started
+ *   - a stopped fan is started at full duty for settings.fanKickSeconds
+ * The duty is sent with every telemetry frame as &FD=<percent>.
+ */
+
+const byte fanPwmTop = 79; // 16 MHz / 8 / (79 + 1) = 25 kHz
+
+byte fanDuty = 0; // Last duty written, 0..255
+
+void fanBegin()
+{
+  TCCR0A = _BV(WGM01) | _BV(WGM00);
+  TCCR0B = _BV(WGM02) | _BV(CS01);
+  OCR0A  = fanPwmTop;
+  fanWrite(0);
+}
+
+void fanWrite(byte duty)
+{
+  // OCR0B = 0 would still give a one tick pulse, 0 and 255 drive the pin directly
+  if (duty == 0 || duty == 255)
+  {
+    TCCR0A &= ~_BV(COM0B1);
+    digitalWrite(FAN, duty ? HIGH : LOW);
+  }
+  else
+  {
+    OCR0B = ((uint16_t)duty * (fanPwmTop + 1)) >> 8;
+    TCCR0A |= _BV(COM0B1);
+  }
+  fanDuty = duty;
+}
 
 void fanController()
 {
-  static boolean fanOn = 0;
-  const byte fanTempMin = 28; // Start fan at this temperature (°C)
-  const byte fanTempMax = 38; // Max temperature (°C) for full speed
-  boolean dischargeFanOn = false;
+  static int16_t integral = 0;
+  static byte    kick     = 0;
+  int16_t        hottest  = -1;
+  bool           dischargeFanOn = false;
+  int16_t        output   = 0;
 
-  // If any module is discharging, force fan full speed
   for (byte j = 0; j < settings.moduleCount; j++)
   {
-    if (module[j].cycleState == 5) // Discharge state
+    if ((module[j].cycleState == 5 && !module[j].awaitingAdmission) || module[j].storageDischarging) // Discharge state or storage discharge pulse
     {
       dischargeFanOn = true;
     }
+
+    // Slots whose temperature the cycle engine keeps current
+    byte state = module[j].cycleState;
+    byte temp  = module[j].batteryCurrentTemp;
+    if (state >= 2 && state <= 8 && state != 7 && temp != 0 && temp != 99 && temp > hottest)
+    {
+      hottest = temp;
+    }
   }
 
-  if (dischargeFanOn == true)
+  if (hottest >= 0 && ambientTemperature != 0 && ambientTemperature != 99)
   {
-    digitalWrite(FAN, HIGH);
-    return;
+    int16_t error        = hottest - ambientTemperature - settings.fanRiseSetpoint;
+    int16_t proportional = error * settings.fanKp;
+    int16_t unclamped    = proportional + integral;
+    if (!(unclamped >= 255 && error > 0) && !(unclamped <= 0 && error < 0))
+    {
+      integral = constrain(integral + error * settings.fanKi, 0, 255);
+    }
+    output = constrain(proportional + integral, 0, 255);
+  }
+  else
+  {
+    integral = 0;
   }
 
-  if (ambientTemperature < fanTempMin)
+  if (dischargeFanOn && output < settings.fanDischargeDuty)
   {
-    digitalWrite(FAN, LOW);
-    fanOn = 0;
+    output = settings.fanDischargeDuty;
   }
-  else if (ambientTemperature < fanTempMax)
+  if (ambientTemperature >= settings.fanAmbientMax && ambientTemperature != 99)
   {
-    int fanSpeed = map(ambientTemperature,
-                       fanTempMin,
-                       fanTempMax,
-                       settings.pwmFanMinStart,
-                       252);
+    output = 255;
+  }
 
-    if (fanOn == 0)
-    {
-      fanSpeed = 255;
-      fanOn = 1;
-    }
-    else
-    {
-      analogWrite(FAN, fanSpeed);
-    }
+  // Stall band, with hysteresis
+  if (output < settings.pwmFanMinStart / 2)
+  {
+    output = 0;
   }
-  else
+  else if (output < settings.pwmFanMinStart)
   {
-    digitalWrite(FAN, HIGH);
-    fanOn = 1;
+    output = fanDuty ? settings.pwmFanMinStart : 0;
   }
+
+  // Kick-start from standstill
+  if (output == 0)
+  {
+    kick = 0;
+  }
+  else if (fanDuty == 0)
+  {
+    kick = settings.fanKickSeconds;
+  }
+  if (kick > 0)
+  {
+    kick--;
+    output = 255;
+  }
+
+  fanWrite(output);
 }
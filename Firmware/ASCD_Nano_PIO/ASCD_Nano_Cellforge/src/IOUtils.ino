@@ -24,40 +24,34 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
  * Helper functions for muxed analog readings and shift-register IO.
  */
 
-bool batteryCheck(byte j)
+void shiftRegisterWrite(byte value)
 {
-	module[j].batteryVoltage = readMux(module[j].batteryVolatgePin);
-	if (module[j].batteryVoltage <= settings.batteryVolatgeLeak)
+	// shiftOut(dataPin, clockPin, MSBFIRST, value) on the ports directly, short enough for the cutoff ISR
+	// latchPin 7 = PD7, dataPin 6 = PD6, clockPin 8 = PB0
+	PORTD &= ~_BV(PD7); // Latch low
+	for (byte mask = 0x80; mask != 0; mask >>= 1)
 	{
-		return false;
-	}
-	else
-	{
-		return true;
+		if (value & mask)
+			PORTD |= _BV(PD6);
+		else
+			PORTD &= ~_BV(PD6);
+		PORTB |= _BV(PB0);
+		PORTB &= ~_BV(PB0);
 	}
+	PORTD |= _BV(PD7); // Latch high
 }
 
 void digitalSwitch(byte j, bool value)
 {
-	byte baseTwo        = 1;
-	byte eightBitDecimal = 0;
-	static bool digitalPinsState[8]; // Shift register outputs (Q0..Q7)
-
-	digitalPinsState[j] = value;
-
-	for (byte i = 0; i < 8; i++)
+	// The cutoff ISR also writes the shift register, so update and shift out in one go
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		if (digitalPinsState[i] == 1)
-			eightBitDecimal += baseTwo;
-		baseTwo *= 2;
+		if (value && !outputsLocked)
+			shiftRegisterState |= _BV(j);
+		else
+			shiftRegisterState &= ~_BV(j);
+		shiftRegisterWrite(shiftRegisterState);
 	}
-
-	// Latch low
-	digitalWrite(latchPin, LOW);
-	// Shift out new states
-	shiftOut(dataPin, clockPin, MSBFIRST, eightBitDecimal);
-	// Latch high
-	digitalWrite(latchPin, HIGH);
 }
 
 float readMux(const bool inputArray[])
@@ -65,6 +59,9 @@ float readMux(const bool inputArray[])
 {
 	const byte controlPin[] = {S0, S1, S2, S3};
 
+	byte outerTask = watchdogEnter(TASK_ADC);
+	cutoffSuspend(); // The cutoff watcher drives the mux and ADC between readings
+
 	// Set mux control lines
 	for (byte i = 0; i < 4; i++)
 	{
@@ -78,7 +75,19 @@ float readMux(const bool inputArray[])
 		batterySampleVoltage += analogRead(SIG);
 	}
 	batterySampleVoltage /= 10.0;
+	cutoffResume();
+	watchdogLeave(TASK_ADC, outerTask);
 
 	// Convert ADC value to voltage
-	return batterySampleVoltage * settings.referenceVoltage / 1023.0;
+	return batterySampleVoltage * vccVoltage / 1023.0;
+}
+
+float readBatteryVoltage(byte j)
+{
+	return (readMux(modulePins[j].batteryVolatgePin) * calibration.voltageGain[j]) + calibration.voltageOffset[j];
+}
+
+float readShuntVoltage(byte j)
+{
+	return (readMux(modulePins[j].batteryVolatgeDropPin) * calibration.shuntGain[j]) + calibration.shuntOffset[j];
 }
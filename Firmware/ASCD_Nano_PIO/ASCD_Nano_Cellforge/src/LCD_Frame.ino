@@ -0,0 +1,190 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * LCD shadow frame buffer.
+ *
+ * The UI writes rows into lcdFrame with lcdFrameWrite(); cells that change
+ * are marked dirty and lcdFrameFlush() hands them to the TWI interrupt
+ * (LCD_TWI.ino), which pulls them one at a time with lcdFrameNext(). Runs of
+ * dirty cells are sent behind a single cursor move, and a one cell gap
+ * between two runs is rewritten instead of jumped over (a cursor move costs
+ * as much as a character).
+ *
+ * The LCD command prints the I2C bytes per second since boot, what the same
+ * screens cost through LiquidCrystal_I2C as full row rewrites (six
+ * transmissions of address + data per HD44780 byte at 100 kHz), and the
+ * longest cycleStateLCD() call:
+ *   &LCD=<I2C bytes/s>,<LiquidCrystal_I2C bytes/s>,<max refresh us>,<bus errors>
+ */
+
+const byte lcdColumns             = 16;
+const byte lcdRows                = 2;
+const byte lcdLibraryBytesPerByte = 12;
+
+// Written by the UI, read by the TWI interrupt. Each cell is updated before
+// its dirty bit, so the worst a race can do is send a cell twice.
+char              lcdFrame[lcdRows][lcdColumns];
+volatile uint16_t lcdDirty[lcdRows];    // Cells not yet on the panel, bit per column
+byte              lcdCursorRow    = 0;  // 255 = unknown
+byte              lcdCursorColumn = 0;  // Column 16 is past the end of the row, the HD44780 does not wrap
+volatile uint32_t lcdBusBytes     = 0;
+uint32_t          lcdFullBytes    = 0;
+volatile uint16_t lcdBusErrors    = 0;
+uint16_t          lcdRefreshMicrosMax = 0;
+
+// Matches a panel that has just been cleared
+void lcdFrameReset()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset(lcdFrame, ' ', sizeof(lcdFrame));
+		lcdDirty[0]     = 0;
+		lcdDirty[1]     = 0;
+		lcdCursorRow    = 0;
+		lcdCursorColumn = 0;
+	}
+}
+
+// Panel content unknown, send every cell again
+void lcdFrameInvalidate()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		lcdDirty[0]  = 0xFFFF;
+		lcdDirty[1]  = 0xFFFF;
+		lcdCursorRow = 255;
+	}
+}
+
+void lcdFrameSet(byte row, byte column, char c)
+{
+	if (lcdFrame[row][column] != c)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			lcdFrame[row][column] = c;
+			lcdDirty[row] |= (uint16_t)1 << column;
+		}
+	}
+}
+
+// Characters past column 15 are dropped, the rest of the row is left as it is
+void lcdFrameWrite(byte row, const char *text)
+{
+	byte length = strlen(text);
+	for (byte column = 0; column < lcdColumns && column < length; column++)
+	{
+		lcdFrameSet(row, column, text[column]);
+	}
+	lcdFullBytes += (1 + length) * lcdLibraryBytesPerByte;
+}
+
+void lcdFrameWrite_P(byte row, const char *text)
+{
+	byte length = strlen_P(text);
+	for (byte column = 0; column < lcdColumns && column < length; column++)
+	{
+		lcdFrameSet(row, column, pgm_read_byte(text + column));
+	}
+	lcdFullBytes += (1 + length) * lcdLibraryBytesPerByte;
+}
+
+void lcdFrameClear()
+{
+	lcdFrameWrite_P(0, PSTR("                "));
+	lcdFrameWrite_P(1, PSTR("                "));
+	lcdFrameFlush();
+}
+
+void lcdFrameFlush()
+{
+	lcdTwiKick();
+}
+
+bool lcdFramePending()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		return lcdDirty[0] != 0 || lcdDirty[1] != 0;
+	}
+	return false;
+}
+
+// Next HD44780 byte for the TWI interrupt, a cursor move or a character
+bool lcdFrameNext(byte &value, bool &character)
+{
+	for (byte row = 0; row < lcdRows; row++)
+	{
+		uint16_t dirty = lcdDirty[row];
+		if (dirty == 0)
+			continue;
+
+		byte column = 0;
+		while (!(dirty & 1))
+		{
+			dirty >>= 1;
+			column++;
+		}
+
+		if (lcdCursorRow == row && lcdCursorColumn + 1 == column)
+		{
+			column--; // Bridge the gap
+		}
+		else if (lcdCursorRow != row || lcdCursorColumn != column)
+		{
+			value           = 0x80 | (row ? 0x40 : 0x00) | column; // Set DDRAM address
+			character       = false;
+			lcdCursorRow    = row;
+			lcdCursorColumn = column;
+			return true;
+		}
+
+		value     = lcdFrame[row][column];
+		character = true;
+		lcdDirty[row] &= ~((uint16_t)1 << column);
+		lcdCursorColumn = column + 1;
+		return true;
+	}
+	return false;
+}
+
+void lcdFrameCommand(char *args)
+{
+	(void)args;
+	uint32_t seconds = millis() / 1000;
+	if (seconds == 0)
+		seconds = 1;
+
+	uint32_t busBytes;
+	uint16_t busErrors;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		busBytes  = lcdBusBytes;
+		busErrors = lcdBusErrors;
+	}
+
+	char lcdLine[40];
+	sprintf_P(lcdLine, PSTR("&LCD=%lu,%lu,%u,%u"), busBytes / seconds, lcdFullBytes / seconds, lcdRefreshMicrosMax,
+	          busErrors);
+	Serial.println(lcdLine);
+}
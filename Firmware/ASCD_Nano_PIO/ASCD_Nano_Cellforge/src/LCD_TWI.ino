@@ -0,0 +1,190 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * HD44780 behind the PCF8574 backpack, on an interrupt driven TWI.
+ *
+ * lcdBegin() runs the 4-bit initialisation with polled TWI writes and the
+ * datasheet delays. After that the display is only written from the TWI
+ * interrupt: lcdTwiKick() issues a START if the bus is idle, and the ISR
+ * streams expander bytes in one transaction for as long as the frame buffer
+ * (LCD_Frame.ino) has dirty cells, then sends STOP. The dirty frame is the
+ * transmit queue, so queuing a screen costs no RAM and no bus time in
+ * loop(). Each HD44780 byte is five expander bytes: high nibble with E
+ * high, E low, low nibble with E high, E low, and one idle byte (90 us at
+ * 100 kHz, 22.5 us at 400 kHz) that covers the 37 us execution time before
+ * the next latch.
+ *
+ * PCF8574 port: P0 RS, P1 RW, P2 E, P3 backlight, P4..P7 D4..D7.
+ * A NACK or a lost arbitration drops the transaction. The HD44780 may have
+ * been left between two nibbles, so the next kick runs the initialisation
+ * again (about 60 ms, blocking) and redraws the whole frame.
+ */
+
+const byte lcdAddress   = 0x27;
+const byte lcdRegister  = 0x01; // RS
+const byte lcdEnable    = 0x04; // E
+const byte lcdBacklight = 0x08;
+
+volatile bool lcdTwiBusy = false;
+volatile byte lcdTxStep  = 5;   // Expander byte within the HD44780 byte, 5 = fetch the next one
+volatile bool lcdResync  = false;
+byte          lcdTxValue;
+byte          lcdTxFlags;
+
+// ----------------------
+// Polled writes (setup only)
+// ----------------------
+
+void lcdTwiWait()
+{
+	while (!(TWCR & _BV(TWINT)))
+		;
+}
+
+void lcdPolledExpander(byte value)
+{
+	TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN);
+	lcdTwiWait();
+	TWDR = lcdAddress << 1;
+	TWCR = _BV(TWINT) | _BV(TWEN);
+	lcdTwiWait();
+	TWDR = value;
+	TWCR = _BV(TWINT) | _BV(TWEN);
+	lcdTwiWait();
+	TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+	lcdBusBytes += 2;
+}
+
+void lcdPolledNibble(byte nibble)
+{
+	lcdPolledExpander(nibble | lcdBacklight | lcdEnable);
+	lcdPolledExpander(nibble | lcdBacklight);
+}
+
+void lcdPolledCommand(byte command)
+{
+	lcdPolledNibble(command & 0xF0);
+	lcdPolledNibble(command << 4);
+}
+
+void lcdBegin()
+{
+	// Prescaler 1, SCL = F_CPU / (16 + 2 * TWBR)
+	TWSR = 0;
+	TWBR = ((F_CPU / settings.lcdBusHz) - 16) / 2;
+	PORTC |= _BV(PC4) | _BV(PC5); // Internal pull-ups, as Wire sets them
+
+	lcdPolledExpander(lcdBacklight);
+	timebaseDelay(50);
+
+	// 8-bit function set three times, then switch to 4-bit
+	lcdPolledNibble(0x30);
+	timebaseDelay(5);
+	lcdPolledNibble(0x30);
+	timebaseDelay(5);
+	lcdPolledNibble(0x30);
+	delayMicroseconds(150);
+	lcdPolledNibble(0x20);
+
+	lcdPolledCommand(0x28); // 4-bit, 2 lines, 5x8
+	lcdPolledCommand(0x0C); // Display on, no cursor, no blink
+	lcdPolledCommand(0x01); // Clear
+	timebaseDelay(2);
+	lcdPolledCommand(0x06); // Increment, no shift
+}
+
+// ----------------------
+// Interrupt driven writes
+// ----------------------
+
+void lcdTwiKick()
+{
+	// A STOP still on the bus finishes within a bit time, the next kick starts the transfer
+	if (lcdTwiBusy || (TWCR & _BV(TWSTO)))
+		return;
+	if (lcdResync)
+	{
+		lcdResync = false;
+		lcdBegin();
+		lcdFrameInvalidate();
+	}
+	if (!lcdFramePending())
+		return;
+	lcdTwiBusy = true;
+	TWCR       = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE);
+}
+
+bool lcdNextExpander(byte &value)
+{
+	if (lcdTxStep == 5)
+	{
+		bool character;
+		if (!lcdFrameNext(lcdTxValue, character))
+			return false;
+		lcdTxFlags = character ? lcdRegister : 0;
+		lcdTxStep  = 0;
+	}
+
+	byte nibble = lcdTxStep < 2 ? lcdTxValue & 0xF0 : lcdTxValue << 4;
+	value       = nibble | lcdTxFlags | lcdBacklight;
+	if (lcdTxStep == 0 || lcdTxStep == 2)
+		value |= lcdEnable;
+	lcdTxStep++;
+	return true;
+}
+
+ISR(TWI_vect)
+{
+	byte value;
+
+	switch (TWSR & 0xF8)
+	{
+	case 0x08: // START
+	case 0x10: // Repeated START
+		TWDR = lcdAddress << 1;
+		TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+		lcdBusBytes++;
+		break;
+
+	case 0x18: // Address ACK
+	case 0x28: // Data ACK
+		if (lcdNextExpander(value))
+		{
+			TWDR = value;
+			TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+			lcdBusBytes++;
+			break;
+		}
+		TWCR       = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+		lcdTwiBusy = false;
+		break;
+
+	default: // NACK or arbitration lost
+		TWCR       = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+		lcdTwiBusy = false;
+		lcdTxStep  = 5;
+		lcdResync  = true;
+		lcdBusErrors++;
+		break;
+	}
+}
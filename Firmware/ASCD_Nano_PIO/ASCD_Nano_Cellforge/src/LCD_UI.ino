@@ -21,7 +21,12 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 */
 
 /**
- * LCD user interface: cycles through module views and lock mode.
+ * LCD user interface: cycles through module views, a bench summary and lock mode.
+ * A short press locks the current view for a minute, or steps to the next
+ * module while locked; a long press leaves lock mode. One button event is
+ * taken per refresh, later ones wait in the queue (Button.ino).
+ * Screens are drawn into the frame buffer (LCD_Frame.ino) and sent by the TWI
+ * interrupt (LCD_TWI.ino), a refresh never waits for the bus.
  */
 
 void cycleStateLCD()
@@ -29,6 +34,16 @@ void cycleStateLCD()
 	static byte screenOverride   = 0;
 	static byte cycleStateCount  = 0;
 	static byte cycleStateActive = 0; // Active module index shown on LCD
+	uint32_t    refreshMicros    = timebaseMicros();
+	ButtonEvent event            = buttonEvent();
+	bool        buttonPressed    = event == BUTTON_SHORT;
+
+	if (event == BUTTON_LONG)
+	{
+		// Leave lock mode and rotate again from the current module
+		screenOverride  = 0;
+		cycleStateCount = 0;
+	}
 
 	if (screenOverride > 0 && buttonPressed == false)
 	{
@@ -39,19 +54,16 @@ void cycleStateLCD()
 	else if (screenOverride == 0 && buttonPressed == true)
 	{
 		// Enter lock mode for 60 seconds
-		lcd.setCursor(0, 0);
-		lcd.print(F("LOCK MODE 1 MIN "));
-		lcd.setCursor(0, 1);
-		lcd.print(F("                "));
+		lcdFrameWrite_P(0, PSTR("LOCK MODE 1 MIN "));
+		lcdFrameWrite_P(1, PSTR("                "));
 		screenOverride = 60;
-		buttonPressed  = false;
 	}
 	else
 	{
 		// Rotate between modules
 		if (cycleStateCount == settings.screenTime || buttonPressed == true)
 		{
-			if (cycleStateActive == (settings.moduleCount - 1))
+			if (cycleStateActive == settings.moduleCount) // Last view is the bench summary
 			{
 				cycleStateActive = 0;
 			}
@@ -60,7 +72,6 @@ void cycleStateLCD()
 				cycleStateActive++;
 			}
 			cycleStateCount = 0;
-			buttonPressed   = false;
 		}
 		else
 		{
@@ -68,6 +79,11 @@ void cycleStateLCD()
 		}
 		cycleStateLCDOutput(cycleStateActive);
 	}
+	lcdFrameFlush();
+
+	refreshMicros = timebaseMicros() - refreshMicros;
+	if (refreshMicros > lcdRefreshMicrosMax)
+		lcdRefreshMicrosMax = refreshMicros > 0xFFFF ? 0xFFFF : refreshMicros;
 }
 
 void cycleStateLCDOutput(byte j)
@@ -75,6 +91,25 @@ void cycleStateLCDOutput(byte j)
 	char lcdLine0[20];
 	char lcdLine1[20];
 
+	if (j == settings.moduleCount)
+	{
+		cycleStatsLCDOutput();
+		return;
+	}
+
+	if (module[j].awaitingAdmission)
+	{
+		// Queued by the slot scheduler until the current / thermal budget allows the phase
+		sprintf_P(lcdLine0, PSTR("%d%-15S"), j + 1, PSTR("-WAIT BUDGET"));
+		sprintf_P(lcdLine1, PSTR("%-11S%d.%02dV"),
+		          module[j].cycleState == 5 ? PSTR("DISCHARGE") : module[j].cycleState == 3 ? PSTR("RESISTANCE") : PSTR("CHARGE"),
+		          (int)module[j].batteryVoltage,
+		          (int)(module[j].batteryVoltage * 100) % 100);
+		lcdFrameWrite(0, lcdLine0);
+		lcdFrameWrite(1, lcdLine1);
+		return;
+	}
+
 	switch (module[j].cycleState)
 	{
 	case 0: // Check Battery Voltage
@@ -116,10 +151,15 @@ void cycleStateLCDOutput(byte j)
 		sprintf_P(lcdLine0, PSTR("%d%-7S%02d:%02d:%02d"),
 		          j + 1, PSTR("-REST"),
 		          module[j].hours, module[j].minutes, module[j].seconds);
-		sprintf_P(lcdLine1, PSTR("%-11S%d.%02dV"),
-		          PSTR(" "),
-		          (int)module[j].batteryVoltage,
-		          (int)(module[j].batteryVoltage * 100) % 100);
+		if (module[j].relaxationSeconds < 0) // No estimate yet
+			sprintf_P(lcdLine1, PSTR("TAU  ---   %d.%02dV"),
+			          (int)module[j].batteryVoltage,
+			          (int)(module[j].batteryVoltage * 100) % 100);
+		else
+			sprintf_P(lcdLine1, PSTR("TAU%4ds   %d.%02dV"),
+			          module[j].relaxationSeconds,
+			          (int)module[j].batteryVoltage,
+			          (int)(module[j].batteryVoltage * 100) % 100);
 		break;
 
 	case 5: // Discharge Battery
@@ -146,11 +186,23 @@ void cycleStateLCDOutput(byte j)
 		          (int)(module[j].batteryVoltage * 100) % 100);
 		break;
 
+	case 8: // Storage Battery
+		sprintf_P(lcdLine0, PSTR("%d%-7S%02d:%02d:%02d"),
+		          j + 1, PSTR("-STORE "),
+		          module[j].hours, module[j].minutes, module[j].seconds);
+		sprintf_P(lcdLine1, PSTR("%d.%02dV  %-2S  %d.%02dV"),
+		          (int)cycleSettings.storageChargeVoltage,
+		          (int)(cycleSettings.storageChargeVoltage * 100) % 100,
+		          module[j].storageDischarging ? PSTR("DC") : PSTR("RS"),
+		          (int)module[j].batteryVoltage,
+		          (int)(module[j].batteryVoltage * 100) % 100);
+		break;
+
 	case 7: // Completed
 		switch (module[j].batteryFaultCode)
 		{
 		case 0:
-			sprintf_P(lcdLine0, PSTR("%d%-15S"), j + 1, PSTR("-FINISHED"));
+			sprintf_P(lcdLine0, PSTR("%d-FINISHED GR %c "), j + 1, module[j].cellGrade);
 			break;
 		case 3:
 			sprintf_P(lcdLine0, PSTR("%d%-15S"), j + 1, PSTR("-FAULT HIGH OHM"));
@@ -158,6 +210,9 @@ void cycleStateLCDOutput(byte j)
 		case 5:
 			sprintf_P(lcdLine0, PSTR("%d%-15S"), j + 1, PSTR("-FAULT LOW mAh"));
 			break;
+		case 6:
+			sprintf_P(lcdLine0, PSTR("%d%-15S"), j + 1, PSTR("-FAULT PRED mAh"));
+			break;
 		case 7:
 			sprintf_P(lcdLine0, PSTR("%d%-15S"), j + 1, PSTR("-FAULT HIGH TMP"));
 			break;
@@ -174,8 +229,44 @@ void cycleStateLCDOutput(byte j)
 		break;
 	}
 
-	lcd.setCursor(0, 0);
-	lcd.print(lcdLine0);
-	lcd.setCursor(0, 1);
-	lcd.print(lcdLine1);
+	lcdFrameWrite(0, lcdLine0);
+	lcdFrameWrite(1, lcdLine1);
+}
+
+void cycleStatsLCDOutput()
+{
+	// Cells graded and cells per hour, then where the slot time has gone since power-on:
+	// R running a phase, I idle with a cell in (insertion check, barcode, waiting for removal),
+	// H held by the scheduler or the server insert, E empty
+	char     lcdLine0[20];
+	char     lcdLine1[20];
+	uint32_t shares[4] = {0, 0, 0, 0};
+	uint32_t total     = 0;
+
+	for (byte j = 0; j < settings.moduleCount; j++)
+	{
+		for (byte k = 0; k < ACCOUNT_COUNT; k++)
+		{
+			byte share = 0;
+			if (k == ACCOUNT_EMPTY)
+				share = 3;
+			else if (k == ACCOUNT_ADMISSION || k == ACCOUNT_INSERT)
+				share = 2;
+			else if (k == CYCLE_CHECK_BATTERY || k == CYCLE_BARCODE || k == CYCLE_COMPLETED)
+				share = 1;
+			shares[share] += module[j].accountSeconds[k];
+			total += module[j].accountSeconds[k];
+		}
+	}
+	if (total == 0)
+		total = 1;
+
+	float cellsPerHour = cycleEngine.cellsPerHour();
+	sprintf_P(lcdLine0, PSTR("%-4S%4u %2d.%02d/H"), PSTR("DONE"), cycleEngine.completedCells(),
+	          (int)cellsPerHour, (int)(cellsPerHour * 100) % 100);
+	sprintf_P(lcdLine1, PSTR("R%02d I%02d H%02d E%02d "),
+	          (int)(shares[0] * 100 / total), (int)(shares[1] * 100 / total),
+	          (int)(shares[2] * 100 / total), (int)(shares[3] * 100 / total));
+	lcdFrameWrite(0, lcdLine0);
+	lcdFrameWrite(1, lcdLine1);
 }
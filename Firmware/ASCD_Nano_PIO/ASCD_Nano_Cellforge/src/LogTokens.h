@@ -0,0 +1,76 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+// LogTokens.h
+// Token table for the binary log (DebugConfig.h). Included by the firmware,
+// where only the IDs, filters and argument layouts are kept, and by the host
+// decoder (logdecode/), which holds the format strings.
+//
+// A token's ID is its position in LOG_TOKENS: only append, never reorder or
+// remove, so older captures keep decoding. Arguments are %c, %hhd, %hhu (1
+// byte), %d, %u, %x (2 bytes, int on the AVR), %ld, %lu, %lx (4 bytes) and
+// %f (4 byte float), with the usual flags and widths. No %s, strings defeat
+// the point.
+
+#ifndef LOG_TOKENS_H
+#define LOG_TOKENS_H
+
+// Levels, LOG_LEVEL keeps everything at or below it
+#define LOG_OFF   0
+#define LOG_ERROR 1
+#define LOG_WARN  2
+#define LOG_INFO  3
+#define LOG_DEBUG 4
+
+// Modules, bit numbers for LOG_MODULES
+#define LOG_MODULES_TABLE(X) \
+  X(LOG)                     \
+  X(CALIBRATION)             \
+  X(CHECKPOINT)              \
+  X(WATCHDOG)                \
+  X(STATE)
+
+// X(name, module, level, format)
+#define LOG_TOKENS(X)                                                                           \
+  X(DROPPED,      LOG,         LOG_WARN,  "%u log frames dropped, USB serial busy")             \
+  X(CAL_DEFAULTS, CALIBRATION, LOG_WARN,  "calibration invalid, defaults loaded")               \
+  X(RESUME,       CHECKPOINT,  LOG_INFO,  "slot %hhu resumed in state %hhu after %lu s")        \
+  X(WDT_RESET,    WATCHDOG,    LOG_ERROR, "watchdog reset in task %hhu, reason %hhu, up %lu s") \
+  X(STATE,        STATE,       LOG_DEBUG, "slot %hhu state %hhu -> %hhu")
+
+#define LOG_MODULE_ENUM(name) LOG_MODULE_##name,
+enum LogModule
+{
+  LOG_MODULES_TABLE(LOG_MODULE_ENUM)
+  LOG_MODULE_COUNT
+};
+#undef LOG_MODULE_ENUM
+
+#define LOG_ID_ENUM(name, module, level, format) LOG_ID_##name,
+enum LogToken
+{
+  LOG_TOKENS(LOG_ID_ENUM)
+  LOG_TOKEN_COUNT
+};
+#undef LOG_ID_ENUM
+
+#endif // LOG_TOKENS_H
@@ -0,0 +1,126 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * RAM headroom.
+ *
+ * memoryPaint() runs from .init1, before the C runtime, and fills everything
+ * from the end of static data (__heap_start) to RAMEND with a canary byte.
+ * The stack grows down over it and the String heap grows up over it, so the
+ * canary left above the heap top is headroom that has not been touched since
+ * boot. memoryCheck() rescans it once per tick (a few hundred cycles per
+ * hundred free bytes) and sends a warning record whenever the headroom sets
+ * a new low below settings.memoryWarnBytes:
+ *   &MW=<static bytes>,<heap top>,<stack low>,<free now>,<free min>
+ * The MEM command prints the same record as &MEM.
+ *   heap top:  __brkval, or __heap_start before the first allocation
+ *   stack low: lowest address the stack has written since boot
+ *   free now:  SP - heap top, free min: stack low - heap top
+ *
+ * A stack byte that happens to equal the canary reads as free, so the
+ * minimum can be optimistic by a few bytes.
+ */
+
+#ifdef __AVR__
+
+const byte memoryCanary = 0xC5;
+
+extern uint8_t __heap_start;
+extern char   *__brkval;
+
+uint16_t memoryWarnedFree = 0xFFFF; // Lowest headroom already reported
+
+void memoryPaint()
+{
+	// Neither r1 nor the stack are set up yet, registers only
+	__asm__ volatile(
+	    "ldi r30, lo8(__heap_start)\n\t"
+	    "ldi r31, hi8(__heap_start)\n\t"
+	    "ldi r24, %0\n\t"
+	    "ldi r25, hi8(%1)\n"
+	    "1:\n\t"
+	    "st Z+, r24\n\t"
+	    "cpi r30, lo8(%1)\n\t"
+	    "cpc r31, r25\n\t"
+	    "brlo 1b\n\t"
+	    "breq 1b\n\t"
+	    :
+	    : "M"(memoryCanary), "i"(RAMEND));
+}
+
+uint8_t *memoryHeapTop()
+{
+	return __brkval ? (uint8_t *)__brkval : &__heap_start;
+}
+
+// First byte above the heap top the stack has written
+uint8_t *memoryStackLow()
+{
+	uint8_t *p  = memoryHeapTop();
+	uint8_t *sp = (uint8_t *)SP;
+	while (p < sp && *p == memoryCanary)
+		p++;
+	return p;
+}
+
+void memoryRecord(const char *name, uint8_t *stackLow)
+{
+	uint8_t *heapTop = memoryHeapTop();
+	char     memoryLine[40];
+
+	sprintf_P(memoryLine, PSTR("%S=%u,%u,%u,%u,%u"), name, (unsigned int)(&__heap_start - (uint8_t *)RAMSTART),
+	          (unsigned int)heapTop, (unsigned int)stackLow, (unsigned int)((uint8_t *)SP - heapTop),
+	          (unsigned int)(stackLow - heapTop));
+	Serial.println(memoryLine);
+}
+
+void memoryCheck()
+{
+	uint8_t *stackLow = memoryStackLow();
+	uint16_t freeMin  = stackLow - memoryHeapTop();
+
+	if (freeMin < settings.memoryWarnBytes && freeMin < memoryWarnedFree)
+	{
+		memoryWarnedFree = freeMin;
+		memoryRecord(PSTR("&MW"), stackLow);
+	}
+}
+
+void memoryCommand(char *args)
+{
+	(void)args;
+	memoryRecord(PSTR("&MEM"), memoryStackLow());
+}
+
+#else
+
+// The native build (sim/) has no AVR memory map to scan
+void memoryPaint() {}
+void memoryCheck() {}
+
+void memoryCommand(char *args)
+{
+	(void)args;
+	Serial.println(F("MEM_UNAVAILABLE"));
+}
+
+#endif
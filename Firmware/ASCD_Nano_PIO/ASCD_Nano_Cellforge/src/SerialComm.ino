@@ -33,9 +33,27 @@ void sendSerial()
 		Serial.println(serialSendString);
 		strcpy(serialSendString, "");
 		readSerialResponse = true;
+		telemetryFrames++;
 	}
 }
 
+// Appends fields to the telemetry frame. A group that does not fit is left out whole, the server
+// would misread a field cut at the end of the buffer
+bool telemetryAppend_P(const char *format, ...)
+{
+	size_t length = strlen(serialSendString);
+	va_list args;
+	va_start(args, format);
+	int added = vsnprintf_P(serialSendString + length, sizeof(serialSendString) - length, format, args);
+	va_end(args);
+	if (added < 0 || length + added >= sizeof(serialSendString))
+	{
+		serialSendString[length] = '\0';
+		return false;
+	}
+	return true;
+}
+
 void readSerial()
 {
 	while (ESP8266.available())
@@ -82,6 +100,97 @@ void readSerial()
 	}
 }
 
+void readSerialCommand()
+{
+	// Line based commands from the USB serial port (newline terminated)
+	static char commandLine[32];
+	static byte commandLength = 0;
+
+	while (Serial.available())
+	{
+		char receivedChar = Serial.read();
+		if (receivedChar == '\r')
+			continue;
+		if (receivedChar != '\n')
+		{
+			if (commandLength < sizeof(commandLine) - 1)
+				commandLine[commandLength++] = receivedChar;
+			continue;
+		}
+		commandLine[commandLength] = '\0';
+		commandLength = 0;
+
+		if (strncmp_P(commandLine, PSTR("CAL"), 3) == 0)
+		{
+			calibrationCommand(commandLine + 3);
+		}
+		else if (strncmp_P(commandLine, PSTR("CKPT"), 4) == 0)
+		{
+			checkpointCommand(commandLine + 4);
+		}
+		else if (strncmp_P(commandLine, PSTR("MEM"), 3) == 0)
+		{
+			memoryCommand(commandLine + 3);
+		}
+		else if (strncmp_P(commandLine, PSTR("LCD"), 3) == 0)
+		{
+			lcdFrameCommand(commandLine + 3);
+		}
+		else if (strncmp_P(commandLine, PSTR("BC"), 2) == 0)
+		{
+			barcodeCommand(commandLine + 2);
+		}
+		else if (commandLine[0] != '\0')
+		{
+			Serial.println(F("UNKNOWN_COMMAND"));
+		}
+	}
+}
+
+void sendResultRecord(byte j)
+{
+	// &RR<slot>=<grade>,<mAh>,<mWh>,<mOhm>,<temp rise>,<charge minutes>,<fault code>
+	char resultRecord[48];
+
+	sprintf_P(resultRecord, PSTR("&RR%d=%c,%d,%d,%d,%d,%d,%d"), j, module[j].cellGrade,
+	          (int)module[j].dischargeMilliamps, (int)module[j].dischargeMilliwattHours,
+	          (int)module[j].milliOhmsValue, cycleEngine.temperatureRise(j), module[j].chargeSeconds / 60,
+	          module[j].batteryFaultCode);
+	Serial.println(resultRecord);
+
+	// &TP=<cells completed>,<high temperature faults>,<cells per hour x100>
+	sprintf_P(resultRecord, PSTR("&TP=%u,%u,%u"), cycleEngine.completedCells(), cycleEngine.thermalFaults(),
+	          (unsigned int)(cycleEngine.cellsPerHour() * 100));
+	Serial.println(resultRecord);
+}
+
+void sendCutoffRecord(byte j)
+{
+	// &CO<slot>=<ms since discharge start>,<mAh>,<mWh>
+	char cutoffRecord[40];
+
+	sprintf_P(cutoffRecord, PSTR("&CO%d=%lu,%d,%d"), j, (unsigned long)module[j].cutoffMillis,
+	          (int)module[j].dischargeMilliamps, (int)module[j].dischargeMilliwattHours);
+	Serial.println(cutoffRecord);
+}
+
+void sendStatsRecord(byte j)
+{
+	// &SA<slot>=<cells>,<state 0 s>,...,<state 8 s>,<empty s>,<admission s>,<insert s>
+	// Seconds since power-on per CycleAccount bucket (lib/CycleEngine/src/CycleSlot.h). State 0 counts only
+	// the insertion check, so the idle time with a cell in is states 0, 1 (barcode) and 7 (waiting for removal)
+	char statsRecord[12];
+
+	sprintf_P(statsRecord, PSTR("&SA%d=%u"), j, module[j].cellsCompleted);
+	Serial.print(statsRecord);
+	for (byte k = 0; k < ACCOUNT_COUNT; k++)
+	{
+		Serial.print(',');
+		Serial.print(module[j].accountSeconds[k]);
+	}
+	Serial.println();
+}
+
 void returnCodes(int codeID)
 {
 	switch (codeID)
@@ -117,21 +226,25 @@ void returnCodes(int codeID)
 		Serial.println(F("ERROR_SERIAL_OUTPUT"));
 		break;
 
-	// Barcode continue – mark module as having a valid barcode
+	// Barcode continue – mark module as having a valid barcode, or registered if it was scanned locally
 	case 100:
-		module[0].batteryBarcode = true;
+		if (!barcodeRegistered(0))
+			module[0].batteryBarcode = true;
 		Serial.println(F("BARCODE_CONTINUE_0"));
 		break;
 	case 101:
-		module[1].batteryBarcode = true;
+		if (!barcodeRegistered(1))
+			module[1].batteryBarcode = true;
 		Serial.println(F("BARCODE_CONTINUE_1"));
 		break;
 	case 102:
-		module[2].batteryBarcode = true;
+		if (!barcodeRegistered(2))
+			module[2].batteryBarcode = true;
 		Serial.println(F("BARCODE_CONTINUE_2"));
 		break;
 	case 103:
-		module[3].batteryBarcode = true;
+		if (!barcodeRegistered(3))
+			module[3].batteryBarcode = true;
 		Serial.println(F("BARCODE_CONTINUE_3"));
 		break;
 
@@ -21,48 +21,21 @@ Modified by Jeremy Younger @darksplat on 06/12/2025
 */
 
 /**
- * Temperature processing for modules and ambient.
+ * Temperature readings for modules and ambient.
+ * Threshold checks against ambient are made by the cycle engine.
  */
 
-byte processTemperature(byte j)
-{
-	module[j].batteryCurrentTemp = getTemperature(j);
-
-	// Track highest temp (except invalid 99)
-	if (module[j].batteryCurrentTemp > module[j].batteryHighestTemp &&
-	    module[j].batteryCurrentTemp != 99)
-	{
-		module[j].batteryHighestTemp = module[j].batteryCurrentTemp;
-	}
-
-	if ((module[j].batteryCurrentTemp - ambientTemperature) > settings.tempThreshold &&
-	    module[j].batteryCurrentTemp != 99)
-	{
-		if ((module[j].batteryCurrentTemp - ambientTemperature) > settings.tempMaxThreshold)
-		{
-			// Above maximum threshold = fault
-			return 2;
-		}
-		else
-		{
-			// Above warning threshold (no current action)
-			return 1;
-		}
-	}
-	else
-	{
-		// Within safe range
-		return 0;
-	}
-}
-
 byte getTemperature(byte j)
 {
-	if (module[j].tempCount > 16 || module[j].batteryCurrentTemp == 0 || module[j].batteryCurrentTemp == 99)
+	static byte tempCount[4];
+
+	if (tempCount[j] > 16 || module[j].batteryCurrentTemp == 0 || module[j].batteryCurrentTemp == 99)
 	{
-		module[j].tempCount = 0;
+		tempCount[j] = 0;
+		byte outerTask = watchdogEnter(TASK_TEMPERATURE);
 		sensors.requestTemperaturesByAddress(tempSensorSerial[j]);
 		float tempC = sensors.getTempC(tempSensorSerial[j]);
+		watchdogLeave(TASK_TEMPERATURE, outerTask);
 
 		if (tempC > 99 || tempC < 0)
 		{
@@ -76,7 +49,7 @@ byte getTemperature(byte j)
 	}
 	else
 	{
-		module[j].tempCount++;
+		tempCount[j]++;
 		return module[j].batteryCurrentTemp;
 	}
 }
@@ -84,6 +57,7 @@ byte getTemperature(byte j)
 void getAmbientTemperature()
 {
 	static byte ambientTempCount;
+	byte outerTask = watchdogEnter(TASK_TEMPERATURE);
 
 	if (ambientTempCount > 16 || ambientTemperature == 0 || ambientTemperature == 99)
 	{
@@ -105,4 +79,5 @@ void getAmbientTemperature()
 	{
 		ambientTempCount++;
 	}
+	watchdogLeave(TASK_TEMPERATURE, outerTask);
 }
@@ -0,0 +1,96 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * Timekeeping on Timer1.
+ *
+ * Timer0 drives the fan PWM at 25 kHz (FanController.ino), so its overflow
+ * can no longer keep Arduino time. timebaseBegin() turns the core's Timer0
+ * overflow interrupt off and runs Timer1 in CTC mode with the same 1024 us
+ * period. Its ISR advances timer0_millis and timer0_overflow_count exactly
+ * as the core's handler did, so millis() and everything built on it
+ * (Stream timeouts, DallasTemperature, the cycle engine clock) is unchanged.
+ *
+ * The core's micros() and delay() still add TCNT0 and are not monotonic
+ * once Timer0 has been switched: after setup() use timebaseMicros() and
+ * timebaseDelay() instead. delayMicroseconds() counts cycles and is fine.
+ */
+
+extern "C" volatile unsigned long timer0_millis;          // Arduino core (wiring.c)
+extern "C" volatile unsigned long timer0_overflow_count;
+
+const uint16_t timebaseTop = 2047; // 2048 x 0.5 us = 1024 us, one Timer0 overflow at /64
+
+byte timebaseFract = 0; // Thousandths of a millisecond / 8, as the core's timer0_fract
+
+void timebaseBegin()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TIMSK0 &= ~_BV(TOIE0);
+
+		// CTC on OCR1A, /8
+		TCCR1A = 0;
+		TCCR1B = _BV(WGM12) | _BV(CS11);
+		OCR1A  = timebaseTop;
+		TCNT1  = 0;
+		TIFR1  = _BV(OCF1A);
+		TIMSK1 = _BV(OCIE1A);
+	}
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	// 1024 us per match: 1 ms plus 24 us, carried in steps of 8 us
+	unsigned long m = timer0_millis + 1;
+	byte          f = timebaseFract + 3;
+	if (f >= 125)
+	{
+		f -= 125;
+		m++;
+	}
+	timebaseFract = f;
+	timer0_millis = m;
+	timer0_overflow_count++;
+}
+
+// Microseconds since boot, wraps after about 71 minutes like micros()
+uint32_t timebaseMicros()
+{
+	uint32_t periods;
+	uint16_t count;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		periods = timer0_overflow_count;
+		count   = TCNT1;
+		if ((TIFR1 & _BV(OCF1A)) && count < timebaseTop) // Match pending, the counter has already wrapped
+			periods++;
+	}
+	return (periods << 10) + (count >> 1);
+}
+
+// Busy wait counted in cycles, stretched by the interrupts taken meanwhile
+void timebaseDelay(uint16_t ms)
+{
+	while (ms--)
+		delayMicroseconds(1000);
+}
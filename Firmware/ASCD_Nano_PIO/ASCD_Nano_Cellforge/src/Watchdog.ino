@@ -0,0 +1,201 @@
+
+/*
+// ASDC Nano 4x Arduino Charger / Discharger
+// ---------------------------------------------------------------------------
+// Created by Brett Watt on 19/03/2019
+// Copyright 2018 - Under creative commons license 3.0:
+
+Modified by Jeremy Younger @darksplat on 06/12/2025
+// https://creativecommons.org/licenses/by-nc-sa/3.0/legalcode
+//
+// This software is furnished "as is", without technical support, and with no
+// warranty, express or implied, as to its usefulness for any purpose.
+//
+// @brief
+// ASDC Nano 4x Arduino Charger / Discharger
+// Code for testing the 16x2 LCD 
+// Version 2.0.0
+//
+// @author Email: 
+//       Web: www.darksplat.com
+*/
+
+/**
+ * Watchdog supervision with per-task heartbeats.
+ *
+ * Each scheduled task brackets its work with watchdogEnter() / watchdogLeave().
+ * watchdogService() in loop() only pets the hardware watchdog while every task
+ * has checked in within its deadline. The watchdog runs in interrupt + reset
+ * mode: on a hang the ISR fires first, switches every MOSFET off, records the
+ * task it interrupted, the uptime and the slot states in .noinit RAM, and
+ * locks the outputs off. The interrupt has cleared WDIE, so the reset follows
+ * on the next 4 s timeout; watchdogService() no longer pets the watchdog once
+ * the outputs are locked, so a task that only stalled for 4-5 s and then
+ * returned still ends in the reset. A task that stops checking in without
+ * hanging the loop is recorded the same way by watchdogService(), which
+ * clears WDIE itself and waits for the reset with interrupts off.
+ *
+ * Needs the Optiboot bootloader (board nanoatmega328new in platformio.ini).
+ * A watchdog reset leaves the watchdog running at 16 ms; Optiboot switches
+ * it off, the old ATmegaBOOT of the nanoatmega328 board does not and resets
+ * again inside its own upload wait, so the board would boot-loop before
+ * watchdogEarlyInit() ever runs. For the same reason the timeout is not
+ * shortened before the reset.
+ *
+ * The next boot prints the record once:
+ *   &WD=<task>,<reason>,<uptime s>,<state 0>,<state 1>,<state 2>,<state 3>,<resets>
+ *   task:   0 ADC, 1 temperature, 2 state machine, 3 telemetry, 4 LCD, 255 none
+ *   reason: 1 hung inside the task, 2 missed its heartbeat
+ *   resets: watchdog resets since power-on
+ *
+ * A hang with interrupts disabled never reaches the ISR and is not reset.
+ */
+
+const uint16_t watchdogMagic = 0xA5C3;
+
+typedef struct
+{
+	uint16_t magic;
+	uint16_t magicInverse;
+	byte     task;
+	byte     reason;
+	uint32_t uptime;
+	byte     cycleState[4];
+	byte     resets;
+} WatchdogRecord;
+
+// Survives the watchdog reset, garbage after power-on (checked by the magic pair)
+WatchdogRecord watchdogRecord __attribute__((section(".noinit")));
+
+// Heartbeat deadlines (ms). Telemetry sends every 4 s, but only every 7th slot (28 s)
+// while the ESP has not answered the last frame
+const uint16_t watchdogDeadline[TASK_COUNT] PROGMEM = {5000, 5000, 5000, 30000, 5000};
+
+volatile uint32_t heartbeatMillis[TASK_COUNT];
+volatile byte     watchdogTask    = TASK_NONE; // Task running right now
+bool              watchdogRunning = false;
+
+void watchdogEarlyInit()
+{
+	// A watchdog reset leaves the watchdog enabled at its shortest timeout
+	MCUSR = 0;
+	wdt_disable();
+}
+
+void watchdogTrip(byte task, byte reason)
+{
+	// Outputs off first, then the record
+	shiftRegisterState = 0;
+	shiftRegisterWrite(0);
+
+	bool valid = watchdogRecord.magic == watchdogMagic && watchdogRecord.magicInverse == (uint16_t)~watchdogMagic;
+	watchdogRecord.resets       = valid ? watchdogRecord.resets + 1 : 1;
+	watchdogRecord.magic        = watchdogMagic;
+	watchdogRecord.magicInverse = (uint16_t)~watchdogMagic;
+	watchdogRecord.task         = task;
+	watchdogRecord.reason       = reason;
+	watchdogRecord.uptime       = millis();
+	for (byte j = 0; j < 4; j++)
+	{
+		watchdogRecord.cycleState[j] = module[j].cycleState;
+	}
+
+	// Hung code keeps running until the reset, it may not switch anything back on
+	outputsLocked = true;
+}
+
+byte watchdogOverdueTask(uint32_t now)
+{
+	for (byte task = 0; task < TASK_COUNT; task++)
+	{
+		if (now - heartbeatMillis[task] > pgm_read_word(&watchdogDeadline[task]))
+			return task;
+	}
+	return TASK_NONE;
+}
+
+ISR(WDT_vect)
+{
+	byte task = watchdogTask;
+	if (task == TASK_NONE)
+		task = watchdogOverdueTask(millis());
+	watchdogTrip(task, 1);
+}
+
+byte watchdogEnter(byte task)
+{
+	byte outer   = watchdogTask;
+	watchdogTask = task;
+	return outer;
+}
+
+void watchdogLeave(byte task, byte outer)
+{
+	heartbeatMillis[task] = millis();
+	watchdogTask          = outer;
+}
+
+// Leaves a task without counting it as a heartbeat, for work that runs whether or not the task is alive
+void watchdogRestore(byte outer)
+{
+	watchdogTask = outer;
+}
+
+void watchdogStart()
+{
+	uint32_t now = millis();
+	for (byte task = 0; task < TASK_COUNT; task++)
+	{
+		heartbeatMillis[task] = now;
+	}
+
+	// Interrupt + reset mode, 4 s
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		wdt_reset();
+		WDTCSR = _BV(WDCE) | _BV(WDE);
+		WDTCSR = _BV(WDIE) | _BV(WDE) | _BV(WDP3);
+	}
+	watchdogRunning = true;
+}
+
+void watchdogService()
+{
+	if (!watchdogRunning)
+		return;
+
+	byte task = watchdogOverdueTask(millis());
+	if (task == TASK_NONE && !outputsLocked)
+	{
+		wdt_reset();
+		return;
+	}
+
+	cli();
+	// Locked outputs: the ISR already recorded the hang, the stalled task has returned since
+	if (!outputsLocked)
+		watchdogTrip(task, 2);
+
+	// Reset on the next 4 s timeout, WDIE would otherwise wait for an interrupt that cannot run
+	WDTCSR = _BV(WDCE) | _BV(WDE);
+	WDTCSR = _BV(WDE) | _BV(WDP3);
+	while (true)
+		;
+}
+
+void watchdogReport()
+{
+	// Nothing recorded since power-on, or already reported
+	if (watchdogRecord.magic != watchdogMagic || watchdogRecord.magicInverse != (uint16_t)~watchdogMagic || watchdogRecord.reason == 0)
+		return;
+
+	char watchdogLine[40];
+	sprintf_P(watchdogLine, PSTR("&WD=%d,%d,%lu,%d,%d,%d,%d,%d"), watchdogRecord.task, watchdogRecord.reason,
+	          watchdogRecord.uptime / 1000, watchdogRecord.cycleState[0], watchdogRecord.cycleState[1],
+	          watchdogRecord.cycleState[2], watchdogRecord.cycleState[3], watchdogRecord.resets);
+	Serial.println(watchdogLine);
+	LOG(WDT_RESET, watchdogRecord.task, watchdogRecord.reason, watchdogRecord.uptime / 1000);
+
+	// Report once, the record stays valid so the reset count keeps going until power-off
+	watchdogRecord.reason = 0;
+}
@@ -0,0 +1,631 @@
+// test_main.cpp
+// Unit tests for lib/CycleEngine, driven through fake CycleIO / CycleClock.
+//
+//   pio test -e native
+//
+// Each test builds its own engine on slots, settings and fakes reset by
+// setUp(). The fake cell has a fixed open-circuit voltage and internal
+// resistance; tests move the voltage, charger LED and temperatures by hand
+// and advance the clock one engine tick (one second) at a time.
+
+#include <string.h>
+
+#include <unity.h>
+
+#include "CycleEngine.h"
+
+namespace
+{
+
+const uint8_t slotCount = 4;
+
+class FakeClock : public CycleClock
+{
+public:
+  uint32_t now;
+  uint32_t millis() override { return now; }
+};
+
+class FakeIO : public CycleIO
+{
+public:
+  float   openVoltage[slotCount];
+  float   milliOhms[slotCount];
+  bool    done[slotCount];
+  bool    charger[slotCount];
+  bool    discharge[slotCount];
+  uint8_t cellTemperature[slotCount];
+  uint8_t ambient;
+  float   shuntResistor;
+
+  float batteryVoltage(uint8_t j) override
+  {
+    if (!discharge[j])
+      return openVoltage[j];
+    return openVoltage[j] * shuntResistor / (shuntResistor + milliOhms[j] / 1000.0f);
+  }
+  float   shuntVoltage(uint8_t j) override { return discharge[j] ? 0.02f : batteryVoltage(j); }
+  bool    chargerDone(uint8_t j) override { return done[j]; }
+  void    setCharger(uint8_t j, bool on) override { charger[j] = on; }
+  void    setDischarge(uint8_t j, bool on) override { discharge[j] = on; }
+  uint8_t temperature(uint8_t j) override { return cellTemperature[j]; }
+  uint8_t ambientTemperature() override { return ambient; }
+};
+
+FakeClock     clock;
+FakeIO        io;
+CycleSettings settings;
+CycleSlot     slots[slotCount];
+
+void tickSeconds(CycleEngine &engine, uint32_t seconds)
+{
+  for (uint32_t s = 0; s < seconds; s++)
+  {
+    clock.now += 1000;
+    engine.tick();
+  }
+}
+
+// Ticks until slot j is in `state` and running (not held), false after `limit` seconds
+bool tickUntilRunning(CycleEngine &engine, uint8_t j, uint8_t state, uint32_t limit)
+{
+  for (uint32_t s = 0; s < limit; s++)
+  {
+    if (slots[j].cycleState == state && !slots[j].awaitingAdmission && slots[j].pendingEvent == EVENT_NONE)
+      return true;
+    tickSeconds(engine, 1);
+  }
+  return false;
+}
+
+// Inserts a cell in slot j, answers the barcode lookup and waits for the charge to start
+void startCharge(CycleEngine &engine, uint8_t j)
+{
+  io.openVoltage[j] = 3.70f;
+  tickSeconds(engine, 5);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_BARCODE, slots[j].cycleState);
+  slots[j].batteryBarcode = true;
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, j, CYCLE_CHARGE, 5));
+}
+
+// Acknowledges the held insert of slot j and ticks once so the transition commits
+void acknowledgeInsert(CycleEngine &engine, uint8_t j)
+{
+  TEST_ASSERT_TRUE(engine.awaitingInsert(j));
+  slots[j].insertData = true;
+  tickSeconds(engine, 1);
+}
+
+// Ticks with the fake cell following the outputs: 1 mV per second up on the charger, down on the load.
+// The TP5100 finishes at 4.20 V. Returns false if slot j is still running after `limit` seconds.
+bool tickCellUntilHeld(CycleEngine &engine, uint8_t j, uint32_t limit)
+{
+  for (uint32_t s = 0; s < limit; s++)
+  {
+    if (io.charger[j])
+      io.openVoltage[j] += 0.001f;
+    if (io.discharge[j])
+      io.openVoltage[j] -= 0.001f;
+    io.done[j] = io.openVoltage[j] >= 4.20f;
+    tickSeconds(engine, 1);
+    if (engine.awaitingInsert(j))
+      return true;
+  }
+  return false;
+}
+
+CycleCheckpoint dischargeCheckpoint()
+{
+  CycleCheckpoint checkpoint;
+  memset(&checkpoint, 0, sizeof(checkpoint));
+  checkpoint.cycleState            = CYCLE_DISCHARGE;
+  checkpoint.elapsedSeconds        = 600;
+  checkpoint.batteryInitialVoltage = 4.15f;
+  checkpoint.dischargeMilliamps    = 250.0f;
+  checkpoint.milliOhmsValue        = 50;
+  checkpoint.chargeSeconds         = 3600;
+  checkpoint.batteryInitialTemp    = 22;
+  checkpoint.batteryHighestTemp    = 24;
+  checkpoint.openMillivolts        = 3800;
+  return checkpoint;
+}
+
+} // namespace
+
+void setUp()
+{
+  clock.now = 1000;
+  memset(slots, 0, sizeof(slots));
+  settings = CycleSettings();
+  for (uint8_t j = 0; j < slotCount; j++)
+  {
+    io.openVoltage[j]     = 0.0f;
+    io.milliOhms[j]       = 50.0f;
+    io.done[j]            = false;
+    io.charger[j]         = false;
+    io.discharge[j]       = false;
+    io.cellTemperature[j] = 22;
+  }
+  io.ambient       = 22;
+  io.shuntResistor = settings.shuntResistor[0];
+}
+
+void tearDown()
+{
+}
+
+// ----------------------
+// Transition table
+// ----------------------
+
+void test_empty_slot_stays_in_check_battery()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  tickSeconds(engine, 30);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHECK_BATTERY, slots[0].cycleState);
+}
+
+void test_inserted_cell_waits_for_barcode_then_charges()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  io.openVoltage[0] = 3.70f;
+  tickSeconds(engine, 4);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHECK_BATTERY, slots[0].cycleState);
+  tickSeconds(engine, 1);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_BARCODE, slots[0].cycleState);
+
+  tickSeconds(engine, 60);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_BARCODE, slots[0].cycleState);
+  slots[0].batteryBarcode = true;
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_CHARGE, 5));
+  tickSeconds(engine, 1);
+  TEST_ASSERT_TRUE(io.charger[0]);
+}
+
+void test_cell_removed_before_barcode_returns_to_check_battery()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  io.openVoltage[0] = 3.70f;
+  tickSeconds(engine, 5);
+  io.openVoltage[0] = 0.0f;
+  tickSeconds(engine, 5);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHECK_BATTERY, slots[0].cycleState);
+}
+
+void test_short_charge_skips_rest()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  io.done[0] = true;
+  tickSeconds(engine, 10);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_CHARGED, slots[0].pendingEvent);
+  TEST_ASSERT_FALSE(io.charger[0]);
+
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_RESISTANCE, 5));
+  tickSeconds(engine, 4);
+  TEST_ASSERT_EQUAL_INT(50, (int)(slots[0].milliOhmsValue + 0.5f));
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_DISCHARGE, slots[0].cycleState);
+}
+
+void test_long_charge_rests_before_discharge()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  tickSeconds(engine, 300);
+  io.done[0] = true;
+  tickSeconds(engine, 10);
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_RESISTANCE, 5));
+  tickSeconds(engine, 4);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_REST, slots[0].cycleState);
+}
+
+void test_high_resistance_completes_with_fault_3()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  io.milliOhms[0] = 800.0f;
+  startCharge(engine, 0);
+  io.done[0] = true;
+  tickSeconds(engine, 10);
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_RESISTANCE, 5));
+  tickSeconds(engine, 4);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_COMPLETED, slots[0].cycleState);
+  TEST_ASSERT_EQUAL_UINT8(3, slots[0].batteryFaultCode);
+  TEST_ASSERT_EQUAL('R', slots[0].cellGrade);
+}
+
+void test_discharge_below_low_milliamps_completes_with_fault_5()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  io.done[0] = true;
+  tickSeconds(engine, 10);
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_DISCHARGE, settings.phaseStaggerSeconds + 10));
+  tickSeconds(engine, 60);
+  TEST_ASSERT_TRUE(io.discharge[0]);
+
+  // Ten readings below cutoff, dischargeReadInterval apart
+  io.openVoltage[0] = 2.70f;
+  tickSeconds(engine, 10 * settings.dischargeReadInterval / 1000);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_LOW_CAPACITY, slots[0].pendingEvent);
+  TEST_ASSERT_EQUAL_UINT8(5, slots[0].batteryFaultCode);
+  TEST_ASSERT_FALSE(io.discharge[0]);
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_COMPLETED, slots[0].cycleState);
+}
+
+// ----------------------
+// Charge timeout
+// ----------------------
+
+void test_charge_timeout_fires_at_the_limit_not_after()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  uint32_t limit = settings.chargingTimeout * 3600UL;
+  tickSeconds(engine, limit - engine.elapsedSeconds(0) - 1);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, slots[0].pendingEvent);
+  TEST_ASSERT_TRUE(io.charger[0]);
+
+  // The guard sees the hours of the previous tick: the tick after they reach chargingTimeout, not an hour later
+  tickSeconds(engine, 2);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_CHARGE_TIMEOUT, slots[0].pendingEvent);
+  TEST_ASSERT_EQUAL_UINT8(9, slots[0].batteryFaultCode);
+  TEST_ASSERT_FALSE(io.charger[0]);
+}
+
+// ----------------------
+// Insert acknowledgement latch
+// ----------------------
+
+void test_held_transition_waits_for_the_acknowledgement()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  io.done[0] = true;
+  tickSeconds(engine, 10);
+  TEST_ASSERT_TRUE(engine.awaitingInsert(0));
+
+  tickSeconds(engine, 120);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHARGE, slots[0].cycleState);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_CHARGED, slots[0].pendingEvent);
+  TEST_ASSERT_FALSE(io.charger[0]);
+
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_FALSE(engine.awaitingInsert(0));
+  TEST_ASSERT_FALSE(slots[0].insertData);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_RESISTANCE, slots[0].cycleState);
+}
+
+void test_stale_acknowledgement_does_not_commit_the_next_transition()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+
+  // An acknowledgement left over from before the request is dropped when the request is made
+  slots[0].insertData = true;
+  io.done[0]          = true;
+  tickSeconds(engine, 10);
+  TEST_ASSERT_TRUE(engine.awaitingInsert(0));
+  TEST_ASSERT_FALSE(slots[0].insertData);
+
+  tickSeconds(engine, 5);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHARGE, slots[0].cycleState);
+}
+
+// ----------------------
+// Temperature faults
+// ----------------------
+
+void test_over_temperature_while_charging_completes_with_fault_7()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  tickSeconds(engine, 5);
+  io.cellTemperature[0] = io.ambient + settings.tempMaxThreshold + 1;
+  tickSeconds(engine, 1);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_OVER_TEMPERATURE, slots[0].pendingEvent);
+  TEST_ASSERT_EQUAL_UINT8(7, slots[0].batteryFaultCode);
+  TEST_ASSERT_FALSE(io.charger[0]);
+
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_COMPLETED, slots[0].cycleState);
+  TEST_ASSERT_EQUAL_UINT16(1, engine.thermalFaults());
+}
+
+void test_temperature_at_the_limit_or_invalid_is_not_a_fault()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  io.cellTemperature[0] = io.ambient + settings.tempMaxThreshold;
+  tickSeconds(engine, 5);
+  io.cellTemperature[0] = 99; // Sensor missing
+  tickSeconds(engine, 5);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, slots[0].pendingEvent);
+  TEST_ASSERT_TRUE(io.charger[0]);
+  TEST_ASSERT_EQUAL_UINT8(io.ambient + settings.tempMaxThreshold, slots[0].batteryHighestTemp);
+}
+
+void test_over_temperature_while_discharging_opens_the_load()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  io.done[0] = true;
+  tickSeconds(engine, 10);
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_DISCHARGE, settings.phaseStaggerSeconds + 10));
+  tickSeconds(engine, 10);
+  TEST_ASSERT_TRUE(io.discharge[0]);
+
+  io.cellTemperature[0] = io.ambient + settings.tempMaxThreshold + 1;
+  tickSeconds(engine, 1);
+  TEST_ASSERT_EQUAL_UINT8(EVENT_OVER_TEMPERATURE, slots[0].pendingEvent);
+  TEST_ASSERT_FALSE(io.discharge[0]);
+}
+
+// ----------------------
+// Slot scheduler
+// ----------------------
+
+void test_running_discharge_pauses_at_the_board_limit()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  io.openVoltage[0] = 3.80f;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  tickSeconds(engine, 3);
+  TEST_ASSERT_TRUE(io.discharge[0]);
+
+  // Too hot: the load opens and the slot waits, still checkpointed as discharging
+  io.ambient = settings.boardTempLimit;
+  tickSeconds(engine, 1);
+  TEST_ASSERT_TRUE(slots[0].awaitingAdmission);
+  TEST_ASSERT_FALSE(io.discharge[0]);
+  TEST_ASSERT_FALSE(engine.awaitingInsert(0));
+  CycleCheckpoint paused;
+  engine.checkpoint(0, paused);
+  TEST_ASSERT_FALSE(paused.awaitingAdmission);
+
+  tickSeconds(engine, 120);
+  TEST_ASSERT_TRUE(slots[0].awaitingAdmission);
+  uint32_t elapsed = engine.elapsedSeconds(0);
+
+  // Cooled down: carries on where it stopped, the pause is not phase time
+  io.ambient = settings.boardTempLimit - 1;
+  TEST_ASSERT_TRUE(tickUntilRunning(engine, 0, CYCLE_DISCHARGE, settings.phaseStaggerSeconds + 2));
+  tickSeconds(engine, 1);
+  TEST_ASSERT_TRUE(io.discharge[0]);
+  TEST_ASSERT_UINT32_WITHIN(2, elapsed - 120, engine.elapsedSeconds(0));
+}
+
+// ----------------------
+// Storage finishing
+// ----------------------
+
+void test_storage_recharge_stops_at_the_target_from_below()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  settings.storageChargeVoltage = 3.70f;
+  io.openVoltage[0]             = 3.30f;
+  checkpoint.openMillivolts     = 3300;
+  checkpoint.pendingEvent       = EVENT_DISCHARGED;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_RECHARGE, slots[0].cycleState);
+
+  TEST_ASSERT_TRUE(tickCellUntilHeld(engine, 0, 3600));
+  TEST_ASSERT_EQUAL_UINT8(EVENT_CHARGED_TO_STORAGE, slots[0].pendingEvent);
+  TEST_ASSERT_FALSE(io.charger[0]);
+  TEST_ASSERT_FLOAT_WITHIN(settings.storageToleranceVoltage, 3.70f - settings.storageToleranceVoltage / 2,
+                           io.openVoltage[0]);
+
+  // Already at the target: the storage state checks the OCV once and has nothing to bleed off
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_STORAGE, slots[0].cycleState);
+  TEST_ASSERT_TRUE(tickCellUntilHeld(engine, 0, settings.phaseStaggerSeconds + settings.storageRelaxSeconds + 5));
+  TEST_ASSERT_EQUAL_UINT8(EVENT_STORAGE_REACHED, slots[0].pendingEvent);
+  TEST_ASSERT_EQUAL_UINT8(0, slots[0].batteryFaultCode);
+}
+
+void test_storage_target_above_a_full_cell_ends_when_the_charger_finishes()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  settings.storageChargeVoltage = 4.25f;
+  io.openVoltage[0]             = 4.00f;
+  checkpoint.openMillivolts     = 4000;
+  checkpoint.pendingEvent       = EVENT_DISCHARGED;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  acknowledgeInsert(engine, 0);
+
+  TEST_ASSERT_TRUE(tickCellUntilHeld(engine, 0, 3600));
+  TEST_ASSERT_EQUAL_UINT8(EVENT_CHARGED_TO_STORAGE, slots[0].pendingEvent);
+  TEST_ASSERT_EQUAL_UINT8(0, slots[0].batteryFaultCode);
+  TEST_ASSERT_FALSE(io.charger[0]);
+}
+
+void test_storage_discharge_waits_for_admission()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  settings.storageChargeVoltage = 3.70f;
+  io.openVoltage[0]             = 3.90f;
+  checkpoint.cycleState         = CYCLE_STORAGE;
+  checkpoint.openMillivolts     = 3900;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+
+  // Too hot: no storage pulse starts
+  io.ambient = settings.boardTempLimit;
+  TEST_ASSERT_FALSE(tickCellUntilHeld(engine, 0, 120));
+  TEST_ASSERT_TRUE(slots[0].awaitingAdmission);
+  TEST_ASSERT_FALSE(io.discharge[0]);
+
+  io.ambient = settings.boardTempLimit - 1;
+  TEST_ASSERT_TRUE(tickCellUntilHeld(engine, 0, 3600));
+  TEST_ASSERT_EQUAL_UINT8(EVENT_STORAGE_REACHED, slots[0].pendingEvent);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 3.70f, io.openVoltage[0]);
+}
+
+// ----------------------
+// Resume from a checkpoint
+// ----------------------
+
+void test_checkpoint_round_trip_keeps_the_cycle()
+{
+  CycleEngine engine(slots, 1, settings, io, clock);
+  startCharge(engine, 0);
+  tickSeconds(engine, 300);
+
+  CycleCheckpoint checkpoint;
+  engine.checkpoint(0, checkpoint);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHARGE, checkpoint.cycleState);
+  TEST_ASSERT_FALSE(engine.checkpointDue(0));
+
+  // Power cycle: new slots, new engine, later clock
+  memset(slots, 0, sizeof(slots));
+  io.charger[0] = false;
+  clock.now    += 3600000UL;
+  CycleEngine resumed(slots, 1, settings, io, clock);
+  TEST_ASSERT_TRUE(resumed.resume(0, checkpoint));
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_CHARGE, slots[0].cycleState);
+  TEST_ASSERT_EQUAL_UINT32(checkpoint.elapsedSeconds, resumed.elapsedSeconds(0));
+}
+
+void test_resume_refuses_early_states_and_missing_cells()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+
+  io.openVoltage[0] = 0.0f;
+  TEST_ASSERT_FALSE(engine.resume(0, checkpoint));
+
+  io.openVoltage[0]     = 3.80f;
+  checkpoint.cycleState = CYCLE_BARCODE;
+  TEST_ASSERT_FALSE(engine.resume(0, checkpoint));
+}
+
+void test_resume_refuses_a_swapped_cell()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+
+  // A full cell put in where a half discharged one was
+  io.openVoltage[0] = 4.15f;
+  TEST_ASSERT_FALSE(engine.resume(0, checkpoint));
+
+  // The same cell, relaxed a little while the board was off
+  io.openVoltage[0] = 3.85f;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+}
+
+void test_discharge_checkpoint_saves_the_open_circuit_voltage()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  io.openVoltage[0] = 3.80f;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  tickSeconds(engine, 3);
+  TEST_ASSERT_TRUE(io.discharge[0]);
+
+  // The loaded reading plus the IR drop, so the unloaded cell matches after a reset
+  engine.checkpoint(0, checkpoint);
+  TEST_ASSERT_UINT32_WITHIN(20, 3800, checkpoint.openMillivolts);
+}
+
+void test_resumed_discharge_goes_back_through_admission()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  io.openVoltage[0] = 3.80f;
+
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  TEST_ASSERT_TRUE(slots[0].awaitingAdmission);
+  TEST_ASSERT_FALSE(io.discharge[0]);
+  TEST_ASSERT_EQUAL_FLOAT(250.0f, slots[0].dischargeMilliamps);
+  TEST_ASSERT_EQUAL_INT(50, (int)slots[0].milliOhmsValue);
+
+  tickSeconds(engine, 1);
+  TEST_ASSERT_FALSE(slots[0].awaitingAdmission);
+
+  // Not entered again: the first readings add to the checkpointed mAh
+  tickSeconds(engine, 2);
+  TEST_ASSERT_TRUE(io.discharge[0]);
+  TEST_ASSERT_TRUE(slots[0].dischargeMilliamps > 250.0f);
+}
+
+void test_slots_resumed_together_are_staggered()
+{
+  CycleEngine     engine(slots, 2, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  io.openVoltage[0] = 3.80f;
+  io.openVoltage[1] = 3.80f;
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  TEST_ASSERT_TRUE(engine.resume(1, checkpoint));
+
+  tickSeconds(engine, 1);
+  TEST_ASSERT_FALSE(slots[0].awaitingAdmission);
+  TEST_ASSERT_TRUE(slots[1].awaitingAdmission);
+  TEST_ASSERT_FALSE(io.discharge[1]);
+
+  tickSeconds(engine, settings.phaseStaggerSeconds - 1);
+  TEST_ASSERT_TRUE(slots[1].awaitingAdmission);
+  tickSeconds(engine, 1);
+  TEST_ASSERT_FALSE(slots[1].awaitingAdmission);
+  tickSeconds(engine, 1);
+  TEST_ASSERT_TRUE(io.discharge[1]);
+
+  // The wait is not phase time: both carry on from the checkpoint
+  TEST_ASSERT_UINT32_WITHIN(1, checkpoint.elapsedSeconds + settings.phaseStaggerSeconds, engine.elapsedSeconds(0));
+  TEST_ASSERT_UINT32_WITHIN(1, checkpoint.elapsedSeconds, engine.elapsedSeconds(1));
+}
+
+void test_resumed_insert_wait_is_kept()
+{
+  CycleEngine     engine(slots, 1, settings, io, clock);
+  CycleCheckpoint checkpoint = dischargeCheckpoint();
+  io.openVoltage[0]       = 3.80f;
+  checkpoint.pendingEvent = EVENT_DISCHARGED;
+
+  TEST_ASSERT_TRUE(engine.resume(0, checkpoint));
+  TEST_ASSERT_FALSE(slots[0].awaitingAdmission);
+  TEST_ASSERT_TRUE(engine.awaitingInsert(0));
+  tickSeconds(engine, 5);
+  TEST_ASSERT_FALSE(io.discharge[0]);
+
+  acknowledgeInsert(engine, 0);
+  TEST_ASSERT_EQUAL_UINT8(CYCLE_RECHARGE, slots[0].cycleState);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_slot_stays_in_check_battery);
+  RUN_TEST(test_inserted_cell_waits_for_barcode_then_charges);
+  RUN_TEST(test_cell_removed_before_barcode_returns_to_check_battery);
+  RUN_TEST(test_short_charge_skips_rest);
+  RUN_TEST(test_long_charge_rests_before_discharge);
+  RUN_TEST(test_high_resistance_completes_with_fault_3);
+  RUN_TEST(test_discharge_below_low_milliamps_completes_with_fault_5);
+  RUN_TEST(test_charge_timeout_fires_at_the_limit_not_after);
+  RUN_TEST(test_held_transition_waits_for_the_acknowledgement);
+  RUN_TEST(test_stale_acknowledgement_does_not_commit_the_next_transition);
+  RUN_TEST(test_over_temperature_while_charging_completes_with_fault_7);
+  RUN_TEST(test_temperature_at_the_limit_or_invalid_is_not_a_fault);
+  RUN_TEST(test_over_temperature_while_discharging_opens_the_load);
+  RUN_TEST(test_running_discharge_pauses_at_the_board_limit);
+  RUN_TEST(test_storage_recharge_stops_at_the_target_from_below);
+  RUN_TEST(test_storage_target_above_a_full_cell_ends_when_the_charger_finishes);
+  RUN_TEST(test_storage_discharge_waits_for_admission);
+  RUN_TEST(test_checkpoint_round_trip_keeps_the_cycle);
+  RUN_TEST(test_resume_refuses_early_states_and_missing_cells);
+  RUN_TEST(test_resume_refuses_a_swapped_cell);
+  RUN_TEST(test_discharge_checkpoint_saves_the_open_circuit_voltage);
+  RUN_TEST(test_resumed_discharge_goes_back_through_admission);
+  RUN_TEST(test_slots_resumed_together_are_staggered);
+  RUN_TEST(test_resumed_insert_wait_is_kept);
+  return UNITY_END();
+}
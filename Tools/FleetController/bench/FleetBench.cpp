@@ -0,0 +1,179 @@
+// FleetBench.cpp
+// Load test for fleetd: N simulated units on ptys, each streaming telemetry
+// at the full 115200 baud line rate (11520 bytes/s), read by one reactor
+// thread. Reports line throughput and the reactor thread's CPU share.
+//
+//   fleet_bench [-u units] [-t seconds] [-g generator threads] [-w writers] [-o dir]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/Reactor.h"
+#include "../src/RecordWriter.h"
+
+namespace
+{
+
+struct SimulatedUnit
+{
+  int      master = -1;
+  uint64_t frame  = 0;
+  uint64_t sent   = 0; // Bytes written
+  uint64_t lines  = 0;
+  uint64_t stalls = 0; // Pty buffer full, the reactor fell behind
+};
+
+// One telemetry frame as StateMachine.ino builds it, four slots in discharge
+size_t buildFrame(char *buffer, size_t size, uint64_t frame)
+{
+  size_t length = snprintf(buffer, size, "&AT=%d", 23 + (int)(frame % 5));
+  for (int slot = 0; slot < 4; slot++)
+  {
+    length += snprintf(buffer + length, size - length,
+                       "&CS%d=5&TI%d=%d&IT%d=24&IV%d=4.18&CT%d=%d&CV%d=3.%02d&HT%d=31&MA%d=%d&DA%d=1.12&MO%d=48&PC%d=2610",
+                       slot, slot, (int)(frame * 4 % 30000), slot, slot, slot, 26 + slot, slot, (int)(frame % 100),
+                       slot, slot, (int)(frame % 3000), slot, slot, slot);
+  }
+  length += snprintf(buffer + length, size - length, "\r\n");
+  // Every 64th frame is followed by a grade record
+  if (frame % 64 == 63)
+    length += snprintf(buffer + length, size - length, "&RR%d=A,2630,9512,48,6,161,0\r\n", (int)(frame % 4));
+  return length;
+}
+
+void generate(std::vector<SimulatedUnit> &units, size_t first, size_t step, const std::atomic<bool> &stop)
+{
+  const double bytesPerSecond = 11520.0;
+  char         frame[1024];
+  auto         start = std::chrono::steady_clock::now();
+
+  while (!stop.load(std::memory_order_relaxed))
+  {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = first; i < units.size(); i += step)
+    {
+      SimulatedUnit &unit = units[i];
+      while (unit.sent < elapsed * bytesPerSecond)
+      {
+        size_t  length  = buildFrame(frame, sizeof(frame), unit.frame);
+        ssize_t written = write(unit.master, frame, length);
+        if (written != (ssize_t)length)
+        {
+          unit.stalls++;
+          if (written > 0)
+            unit.sent += written; // Partial write, the rest of the frame is lost
+          break;
+        }
+        unit.sent += length;
+        unit.lines += unit.frame % 64 == 63 ? 2 : 1;
+        unit.frame++;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned    unitCount      = 200;
+  unsigned    seconds        = 10;
+  unsigned    generatorCount = 2;
+  unsigned    writerCount    = 2;
+  std::string outputDirectory; // Empty: writers discard records
+
+  int option;
+  while ((option = getopt(argc, argv, "u:t:g:w:o:")) != -1)
+  {
+    switch (option)
+    {
+    case 'u': unitCount = atoi(optarg); break;
+    case 't': seconds = atoi(optarg); break;
+    case 'g': generatorCount = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+    case 'w': writerCount = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+    case 'o': outputDirectory = optarg; break;
+    default:
+      fprintf(stderr, "usage: fleet_bench [-u units] [-t seconds] [-g generators] [-w writers] [-o dir]\n");
+      return 2;
+    }
+  }
+
+  // One pty per unit: the generator owns the master, fleetd opens the slave like a USB port
+  std::vector<SimulatedUnit> units(unitCount);
+  std::vector<std::string>   paths, names;
+  for (unsigned i = 0; i < unitCount; i++)
+  {
+    units[i].master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (units[i].master < 0 || grantpt(units[i].master) != 0 || unlockpt(units[i].master) != 0)
+    {
+      perror("posix_openpt");
+      return 1;
+    }
+    paths.push_back(ptsname(units[i].master));
+    names.push_back("unit" + std::to_string(i));
+  }
+
+  std::vector<std::unique_ptr<fleet::RecordWriter>> writerStorage;
+  std::vector<fleet::RecordWriter *>                writers;
+  for (unsigned i = 0; i < writerCount; i++)
+  {
+    writerStorage.emplace_back(new fleet::RecordWriter(i, outputDirectory, names));
+    writers.push_back(writerStorage.back().get());
+  }
+
+  std::atomic<bool> stopReactor{false}, stopGenerators{false};
+  fleet::Reactor    reactor(paths, writers);
+  for (fleet::RecordWriter *writer : writers)
+    writer->start();
+  std::thread reactorThread([&] { reactor.run(stopReactor); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Let the reactor open every port first
+
+  std::vector<std::thread> generators;
+  for (unsigned g = 0; g < generatorCount; g++)
+    generators.emplace_back(generate, std::ref(units), g, generatorCount, std::cref(stopGenerators));
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stopGenerators = true;
+  for (std::thread &generator : generators)
+    generator.join();
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Drain the pty buffers
+  stopReactor = true;
+  reactorThread.join();
+  for (fleet::RecordWriter *writer : writers)
+    writer->stop();
+
+  uint64_t sentLines = 0, stalls = 0, written = 0;
+  for (const SimulatedUnit &unit : units)
+  {
+    sentLines += unit.lines;
+    stalls += unit.stalls;
+    close(unit.master);
+  }
+  for (fleet::RecordWriter *writer : writers)
+    written += writer->written();
+
+  fleet::ReactorStats stats = reactor.stats();
+  printf("units:            %u\n", unitCount);
+  printf("seconds:          %.2f\n", wall);
+  printf("bytes/s:          %.0f (%.0f per unit)\n", stats.bytes / wall, stats.bytes / wall / unitCount);
+  printf("lines/s:          %.0f\n", stats.lines / wall);
+  printf("lines:            %llu sent, %llu parsed, %llu written (first line per port is dropped on open)\n", (unsigned long long)sentLines,
+         (unsigned long long)stats.lines, (unsigned long long)written);
+  printf("dropped:          %llu queue full, %llu overlong, %llu pty stalls\n", (unsigned long long)stats.dropped,
+         (unsigned long long)stats.overlong, (unsigned long long)stalls);
+  printf("reactor cpu:      %.1f %% of one core\n", 100.0 * stats.cpuSeconds / wall);
+  return 0;
+}
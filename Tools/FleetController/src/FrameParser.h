@@ -0,0 +1,126 @@
+// FrameParser.h
+// Zero-copy tokenizer for ASCD serial lines.
+//
+// The firmware sends telemetry as one line of "&<KEY><slot>=<value>" fields,
+// e.g. "&AT=23&CS0=5&TI0=812&CV0=3.71&ID0", and result records such as
+// "&RR2=A,2630,9512,48,6,161,0". Anything not starting with '&' is a plain
+// text line (server return codes, calibration output).
+//
+// Fields point into the caller's buffer; nothing is copied or allocated.
+
+#ifndef FLEET_FRAME_PARSER_H
+#define FLEET_FRAME_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace fleet
+{
+
+enum class LineKind : uint8_t
+{
+  Text,       // Not a field line
+  Frame,      // Cycle telemetry (&AT=..&CS..)
+  Result,     // &RR<slot>= grade record
+  Cutoff,     // &CO<slot>= hardware cutoff record
+  Throughput, // &TP= scheduler throughput
+  Other       // Other field lines (&ST, &WD, ...)
+};
+
+struct Field
+{
+  const char *key;         // Two upper case letters
+  int         slot;        // Slot digit, -1 if the key has none
+  const char *value;       // Value text, not terminated
+  size_t      valueLength; // 0 for flags such as &ID0
+};
+
+class FrameParser
+{
+public:
+  FrameParser(const char *line, size_t length) : cursor(line), end(line + length) {}
+
+  // Next field, false at the end of the line. Malformed fields are skipped.
+  bool next(Field &field)
+  {
+    while (cursor < end)
+    {
+      const char *start = static_cast<const char *>(memchr(cursor, '&', end - cursor));
+      if (start == nullptr)
+      {
+        cursor = end;
+        return false;
+      }
+      const char *fieldEnd = static_cast<const char *>(memchr(start + 1, '&', end - start - 1));
+      if (fieldEnd == nullptr)
+        fieldEnd = end;
+      cursor = fieldEnd;
+
+      const char *p = start + 1;
+      if (fieldEnd - p < 2 || !isKeyChar(p[0]) || !isKeyChar(p[1]))
+        continue;
+      field.key  = p;
+      field.slot = -1;
+      p += 2;
+      if (p < fieldEnd && p[0] >= '0' && p[0] <= '9')
+        field.slot = *p++ - '0';
+      if (p < fieldEnd && *p == '=')
+      {
+        field.value       = p + 1;
+        field.valueLength = fieldEnd - p - 1;
+      }
+      else if (p == fieldEnd)
+      {
+        field.value       = fieldEnd;
+        field.valueLength = 0;
+      }
+      else
+      {
+        continue;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  static LineKind classify(const char *line, size_t length)
+  {
+    if (length < 3 || line[0] != '&')
+      return LineKind::Text;
+    if (line[1] == 'A' && line[2] == 'T')
+      return LineKind::Frame;
+    if (line[1] == 'R' && line[2] == 'R')
+      return LineKind::Result;
+    if (line[1] == 'C' && line[2] == 'O')
+      return LineKind::Cutoff;
+    if (line[1] == 'T' && line[2] == 'P')
+      return LineKind::Throughput;
+    return LineKind::Other;
+  }
+
+  static bool keyIs(const Field &field, const char *key)
+  {
+    return field.key[0] == key[0] && field.key[1] == key[1];
+  }
+
+  // Integer part of a value ("3.71" -> 3, "-12" -> -12), stops at the first non digit
+  static long integer(const char *value, size_t length)
+  {
+    long result   = 0;
+    bool negative = length > 0 && value[0] == '-';
+    for (size_t i = negative ? 1 : 0; i < length && value[i] >= '0' && value[i] <= '9'; i++)
+      result = result * 10 + (value[i] - '0');
+    return negative ? -result : result;
+  }
+
+private:
+  static bool isKeyChar(char c) { return c >= 'A' && c <= 'Z'; }
+
+  const char *cursor;
+  const char *end;
+};
+
+} // namespace fleet
+
+#endif // FLEET_FRAME_PARSER_H
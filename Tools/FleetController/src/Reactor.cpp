@@ -0,0 +1,333 @@
+// Reactor.cpp
+
+#include "Reactor.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "SerialPort.h"
+
+namespace fleet
+{
+
+namespace
+{
+
+// epoll user data: port index, or one of these for the control fds
+const uint64_t signalKey = UINT64_MAX;
+const uint64_t timerKey  = UINT64_MAX - 1;
+const uint64_t scannerKey = UINT64_MAX - 2;
+
+uint64_t wallMillis()
+{
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+} // namespace
+
+Reactor::Reactor(const std::vector<std::string> &portPaths, std::vector<RecordWriter *> &writers)
+  : ports(portPaths.size()), writers(writers)
+{
+  for (size_t i = 0; i < portPaths.size(); i++)
+    ports[i].path = portPaths[i];
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+  // SIGINT / SIGTERM arrive as readable events instead of interrupting epoll_wait
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  // 100 ms housekeeping tick: stop flag, reopening ports, stats
+  timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  itimerspec interval = {{0, 100000000}, {0, 100000000}};
+  timerfd_settime(timerFd, 0, &interval, nullptr);
+
+  epoll_event event = {};
+  event.events   = EPOLLIN;
+  event.data.u64 = signalKey;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+  event.data.u64 = timerKey;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+}
+
+Reactor::~Reactor()
+{
+  for (uint16_t unit = 0; unit < ports.size(); unit++)
+    closePort(unit);
+  if (scannerFd >= 0)
+    close(scannerFd);
+  close(timerFd);
+  close(signalFd);
+  close(epollFd);
+}
+
+void Reactor::run(const std::atomic<bool> &stop)
+{
+  const int   maxEvents = 256;
+  epoll_event events[maxEvents];
+
+  for (uint16_t unit = 0; unit < ports.size(); unit++)
+    openPort(unit);
+  if (!scannerPath.empty())
+    openScanner();
+
+  while (!stop.load(std::memory_order_relaxed))
+  {
+    int count = epoll_wait(epollFd, events, maxEvents, -1);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("epoll_wait");
+      break;
+    }
+
+    bool quit = false;
+    for (int i = 0; i < count; i++)
+    {
+      uint64_t key = events[i].data.u64;
+      if (key == signalKey)
+      {
+        quit = true;
+      }
+      else if (key == timerKey)
+      {
+        uint64_t expirations;
+        if (read(timerFd, &expirations, sizeof(expirations)) > 0)
+        {
+          timerTicks += expirations;
+          if (timerTicks % (reopenSeconds * 10) == 0)
+            reopenClosed();
+          if (statsSeconds > 0 && timerTicks % (statsSeconds * 10) == 0)
+            printStats();
+        }
+      }
+      else if (key == scannerKey)
+      {
+        readScanner();
+      }
+      else if (events[i].events & EPOLLIN)
+      {
+        readPort((uint16_t)key);
+      }
+      else if (events[i].events & (EPOLLHUP | EPOLLERR))
+      {
+        closePort((uint16_t)key);
+      }
+    }
+    if (quit)
+      break;
+  }
+
+  timespec cpu;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+  counters.cpuSeconds = cpu.tv_sec + cpu.tv_nsec / 1e9;
+}
+
+void Reactor::openPort(uint16_t unit)
+{
+  Port &port = ports[unit];
+  port.fd = openSerialPort(port.path);
+  if (port.fd < 0)
+    return;
+  port.used       = 0;
+  port.discarding = true; // Joined mid-stream, the first partial line is dropped
+
+  epoll_event event = {};
+  event.events   = EPOLLIN;
+  event.data.u64 = unit;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, port.fd, &event);
+}
+
+void Reactor::closePort(uint16_t unit)
+{
+  Port &port = ports[unit];
+  if (port.fd < 0)
+    return;
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, port.fd, nullptr);
+  close(port.fd);
+  port.fd = -1;
+}
+
+void Reactor::reopenClosed()
+{
+  for (uint16_t unit = 0; unit < ports.size(); unit++)
+  {
+    if (ports[unit].fd < 0)
+    {
+      openPort(unit);
+      if (ports[unit].fd >= 0)
+        counters.reopens++;
+    }
+  }
+}
+
+void Reactor::readPort(uint16_t unit)
+{
+  Port   &port  = ports[unit];
+  ssize_t count = read(port.fd, port.buffer + port.used, sizeof(port.buffer) - port.used);
+  if (count <= 0)
+  {
+    if (count == 0 || (errno != EAGAIN && errno != EINTR))
+      closePort(unit); // Unplugged (EIO on a pty whose other side closed)
+    return;
+  }
+  counters.bytes += count;
+
+  // Hand out every complete line in place, keep the tail for the next read
+  const char *start = port.buffer;
+  const char *end   = port.buffer + port.used + count;
+  const char *scan  = port.buffer + port.used;
+  while (const char *newline = static_cast<const char *>(memchr(scan, '\n', end - scan)))
+  {
+    size_t length = newline - start;
+    if (length > 0 && start[length - 1] == '\r')
+      length--;
+    if (port.discarding)
+      port.discarding = false;
+    else if (length > 0)
+      dispatch(unit, start, length);
+    start = scan = newline + 1;
+  }
+
+  port.used = end - start;
+  if (port.used >= maxLineLength)
+  {
+    // No newline within a line's worth of bytes: drop up to the next one
+    counters.overlong++;
+    port.discarding = true;
+    port.used       = 0;
+  }
+  else if (start != port.buffer && port.used > 0)
+  {
+    memmove(port.buffer, start, port.used);
+  }
+}
+
+void Reactor::dispatch(uint16_t unit, const char *line, size_t length)
+{
+  LineKind kind = FrameParser::classify(line, length);
+
+  counters.lines++;
+  if (kind == LineKind::Frame)
+    counters.frames++;
+  else if (kind == LineKind::Result)
+    counters.results++;
+
+  RecordWriter::Queue &queue  = writers[unit % writers.size()]->queue();
+  Record              *record = queue.claim();
+  if (record == nullptr)
+  {
+    counters.dropped++; // Never block the reactor on a slow disk
+    return;
+  }
+  if (length > maxLineLength)
+    length = maxLineLength;
+  record->receivedMillis = wallMillis();
+  record->unit           = unit;
+  record->length         = (uint16_t)length;
+  record->kind           = kind;
+  memcpy(record->line, line, length);
+  queue.publish();
+}
+
+void Reactor::openScanner()
+{
+  if (mkfifo(scannerPath.c_str(), 0660) != 0 && errno != EEXIST)
+  {
+    perror(scannerPath.c_str());
+    return;
+  }
+  // Read and write, so the FIFO never reads end of file between scanner clients
+  scannerFd = open(scannerPath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (scannerFd < 0)
+  {
+    perror(scannerPath.c_str());
+    return;
+  }
+  epoll_event event = {};
+  event.events   = EPOLLIN;
+  event.data.u64 = scannerKey;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, scannerFd, &event);
+}
+
+void Reactor::readScanner()
+{
+  char    buffer[256];
+  ssize_t count = read(scannerFd, buffer, sizeof(buffer));
+  for (ssize_t i = 0; i < count; i++)
+  {
+    if (buffer[i] == '\n')
+    {
+      sendBarcode(scannerLine);
+      scannerLine.clear();
+    }
+    else if (buffer[i] != '\r' && scannerLine.size() < 128)
+    {
+      scannerLine += buffer[i];
+    }
+  }
+}
+
+void Reactor::sendBarcode(const std::string &line)
+{
+  // <unit name or number> <slot> <barcode>
+  char unitText[128], barcode[128];
+  int  slot = -1;
+  long unit = -1;
+  if (line.empty())
+    return;
+  if (sscanf(line.c_str(), "%127s %d %127s", unitText, &slot, barcode) == 3 && slot >= 0 && slot <= 3)
+  {
+    for (size_t i = 0; i < ports.size() && unit < 0; i++)
+    {
+      size_t      slash = ports[i].path.rfind('/');
+      const char *name  = ports[i].path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+      if (strcmp(name, unitText) == 0)
+        unit = i;
+    }
+    char *end;
+    long  number = strtol(unitText, &end, 10);
+    if (unit < 0 && *end == '\0' && number >= 0 && (size_t)number < ports.size())
+      unit = number;
+  }
+
+  char   command[160];
+  size_t length = unit < 0 ? 0 : snprintf(command, sizeof(command), "BC%d=%s\n", slot, barcode);
+  if (unit < 0 || ports[unit].fd < 0 || write(ports[unit].fd, command, length) != (ssize_t)length)
+  {
+    counters.rejected++;
+    fprintf(stderr, "fleetd: barcode not sent: %s\n", line.c_str());
+    return;
+  }
+  counters.barcodes++;
+}
+
+void Reactor::printStats()
+{
+  unsigned open = 0;
+  for (const Port &port : ports)
+    open += port.fd >= 0;
+  fprintf(stderr, "fleetd: %u/%zu ports open, %llu lines, %llu frames, %llu results, %llu dropped, %llu barcodes\n",
+          open, ports.size(), (unsigned long long)counters.lines, (unsigned long long)counters.frames,
+          (unsigned long long)counters.results, (unsigned long long)counters.dropped,
+          (unsigned long long)counters.barcodes);
+}
+
+} // namespace fleet
@@ -0,0 +1,88 @@
+// Reactor.h
+// Single-threaded epoll loop over all unit serial ports.
+//
+// Each readable port is read once per wakeup (level triggered, so one busy
+// unit cannot starve the rest). Complete lines are classified in place and
+// copied once into the owning writer's queue. Ports that hang up or fail to
+// open are retried every reopenSeconds.
+//
+// Optionally a scanner FIFO is watched as well: each "<unit> <slot> <barcode>"
+// line written to it is sent to that unit as "BC<slot>=<barcode>", so the
+// slot starts without waiting for the server to find the barcode.
+
+#ifndef FLEET_REACTOR_H
+#define FLEET_REACTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RecordWriter.h"
+
+namespace fleet
+{
+
+struct ReactorStats
+{
+  uint64_t bytes      = 0;
+  uint64_t lines      = 0;
+  uint64_t frames     = 0; // &AT telemetry frames
+  uint64_t results    = 0; // &RR records
+  uint64_t dropped    = 0; // Writer queue full
+  uint64_t overlong   = 0; // Lines longer than maxLineLength
+  uint64_t reopens    = 0;
+  uint64_t barcodes   = 0; // Scanner lines sent to a unit
+  uint64_t rejected   = 0; // Scanner lines with an unknown unit, bad format or the port closed
+  double   cpuSeconds = 0; // Reactor thread CPU time
+};
+
+class Reactor
+{
+public:
+  Reactor(const std::vector<std::string> &portPaths, std::vector<RecordWriter *> &writers);
+  ~Reactor();
+
+  // Runs until stop is set (checked at least every 100 ms) or SIGINT / SIGTERM arrives
+  void run(const std::atomic<bool> &stop);
+
+  ReactorStats stats() const { return counters; }
+
+  unsigned    reopenSeconds = 2;
+  unsigned    statsSeconds  = 0; // Periodic stats line on stderr, 0 = off
+  std::string scannerPath;       // Scanner FIFO, created if missing, empty = none
+
+private:
+  struct Port
+  {
+    std::string path;
+    int         fd = -1;
+    size_t      used = 0;
+    bool        discarding = false; // Inside an overlong line, skip to the next newline
+    char        buffer[2 * maxLineLength];
+  };
+
+  void openPort(uint16_t unit);
+  void closePort(uint16_t unit);
+  void readPort(uint16_t unit);
+  void dispatch(uint16_t unit, const char *line, size_t length);
+  void reopenClosed();
+  void printStats();
+  void openScanner();
+  void readScanner();
+  void sendBarcode(const std::string &line);
+
+  std::vector<Port>            ports;
+  std::vector<RecordWriter *> &writers;
+  int                          epollFd   = -1;
+  int                          signalFd  = -1;
+  int                          timerFd   = -1;
+  int                          scannerFd = -1;
+  std::string                  scannerLine; // Partial line from the scanner FIFO
+  unsigned                     timerTicks = 0;
+  ReactorStats                 counters;
+};
+
+} // namespace fleet
+
+#endif // FLEET_REACTOR_H
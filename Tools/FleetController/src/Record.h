@@ -0,0 +1,28 @@
+// Record.h
+// One serial line handed from the reactor to a writer thread.
+
+#ifndef FLEET_RECORD_H
+#define FLEET_RECORD_H
+
+#include <cstdint>
+
+#include "FrameParser.h"
+
+namespace fleet
+{
+
+// Firmware frames are built in a 400 byte buffer, longer lines are truncated
+const unsigned maxLineLength = 448;
+
+struct Record
+{
+  uint64_t receivedMillis; // Wall clock when the line ended
+  uint16_t unit;           // Index into the port list
+  uint16_t length;
+  LineKind kind;
+  char     line[maxLineLength];
+};
+
+} // namespace fleet
+
+#endif // FLEET_RECORD_H
@@ -0,0 +1,130 @@
+// RecordWriter.cpp
+
+#include "RecordWriter.h"
+
+#include <chrono>
+
+namespace fleet
+{
+
+RecordWriter::RecordWriter(unsigned index, const std::string &outputDirectory, const std::vector<std::string> &unitNames)
+  : index(index), directory(outputDirectory), names(unitNames), unitFiles(unitNames.size(), nullptr)
+{
+}
+
+RecordWriter::~RecordWriter()
+{
+  stop();
+  for (FILE *file : unitFiles)
+  {
+    if (file != nullptr)
+      fclose(file);
+  }
+  if (resultsFile != nullptr)
+    fclose(resultsFile);
+}
+
+void RecordWriter::start()
+{
+  running = true;
+  thread  = std::thread(&RecordWriter::run, this);
+}
+
+void RecordWriter::stop()
+{
+  if (!thread.joinable())
+    return;
+  running = false;
+  thread.join();
+  flushAll();
+}
+
+void RecordWriter::run()
+{
+  unsigned idle = 0;
+  for (;;)
+  {
+    Record *record = records.front();
+    if (record != nullptr)
+    {
+      write(*record);
+      records.release();
+      idle = 0;
+      continue;
+    }
+    if (!running)
+      break; // Stopped and drained
+    // Spin briefly, then back off so an idle writer costs nothing
+    if (++idle < 64)
+    {
+      std::this_thread::yield();
+    }
+    else
+    {
+      if (idle == 64)
+        flushAll();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+void RecordWriter::write(const Record &record)
+{
+  recordsWritten.fetch_add(1, std::memory_order_relaxed);
+  if (directory.empty())
+    return;
+
+  FILE *file = unitFile(record.unit);
+  if (file != nullptr)
+    fprintf(file, "%llu %.*s\n", (unsigned long long)record.receivedMillis, (int)record.length, record.line);
+  if (record.kind == LineKind::Result)
+    writeResult(record);
+}
+
+void RecordWriter::writeResult(const Record &record)
+{
+  // &RR<slot>=<grade>,<mAh>,<mWh>,<mOhm>,<temp rise>,<charge minutes>,<fault code>
+  FrameParser parser(record.line, record.length);
+  Field       field;
+  if (!parser.next(field) || !FrameParser::keyIs(field, "RR") || field.slot < 0)
+    return;
+
+  if (resultsFile == nullptr)
+  {
+    std::string path = directory + "/results-" + std::to_string(index) + ".csv";
+    resultsFile      = fopen(path.c_str(), "a");
+    if (resultsFile == nullptr)
+      return;
+    fseek(resultsFile, 0, SEEK_END);
+    if (ftell(resultsFile) == 0)
+      fputs("time_ms,unit,slot,grade,mah,mwh,milliohms,temp_rise,charge_minutes,fault\n", resultsFile);
+  }
+  fprintf(resultsFile, "%llu,%s,%d,%.*s\n", (unsigned long long)record.receivedMillis,
+          names[record.unit].c_str(), field.slot, (int)field.valueLength, field.value);
+  resultsWritten.fetch_add(1, std::memory_order_relaxed);
+}
+
+FILE *RecordWriter::unitFile(uint16_t unit)
+{
+  if (unitFiles[unit] == nullptr)
+  {
+    std::string path = directory + "/" + names[unit] + ".log";
+    unitFiles[unit]  = fopen(path.c_str(), "a");
+    if (unitFiles[unit] != nullptr)
+      setvbuf(unitFiles[unit], nullptr, _IOFBF, 1 << 16);
+  }
+  return unitFiles[unit];
+}
+
+void RecordWriter::flushAll()
+{
+  for (FILE *file : unitFiles)
+  {
+    if (file != nullptr)
+      fflush(file);
+  }
+  if (resultsFile != nullptr)
+    fflush(resultsFile);
+}
+
+} // namespace fleet
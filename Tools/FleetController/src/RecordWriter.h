@@ -0,0 +1,60 @@
+// RecordWriter.h
+// Writer thread: drains its queue into one log per unit plus a results CSV.
+// Units are pinned to writers (unit % writer count), so each unit's log has
+// exactly one writer and per-unit ordering is kept without locks.
+
+#ifndef FLEET_RECORD_WRITER_H
+#define FLEET_RECORD_WRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Record.h"
+#include "SpscQueue.h"
+
+namespace fleet
+{
+
+class RecordWriter
+{
+public:
+  typedef SpscQueue<Record, 4096> Queue;
+
+  // An empty outputDirectory discards records (benchmarks)
+  RecordWriter(unsigned index, const std::string &outputDirectory, const std::vector<std::string> &unitNames);
+  ~RecordWriter();
+
+  Queue &queue() { return records; }
+
+  void start();
+  void stop(); // Drains the queue, then joins
+
+  uint64_t written() const { return recordsWritten.load(std::memory_order_relaxed); }
+  uint64_t results() const { return resultsWritten.load(std::memory_order_relaxed); }
+
+private:
+  void run();
+  void write(const Record &record);
+  void writeResult(const Record &record);
+  FILE *unitFile(uint16_t unit);
+  void flushAll();
+
+  unsigned                        index;
+  std::string                     directory;
+  const std::vector<std::string> &names;
+  std::vector<FILE *>             unitFiles;
+  FILE                           *resultsFile = nullptr;
+  Queue                           records;
+  std::thread                     thread;
+  std::atomic<bool>               running{false};
+  std::atomic<uint64_t>           recordsWritten{0};
+  std::atomic<uint64_t>           resultsWritten{0};
+};
+
+} // namespace fleet
+
+#endif // FLEET_RECORD_WRITER_H
@@ -0,0 +1,39 @@
+// SerialPort.cpp
+
+#include "SerialPort.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace fleet
+{
+
+int openSerialPort(const std::string &path)
+{
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  termios tty;
+  if (tcgetattr(fd, &tty) == 0)
+  {
+    // Raw bytes, no echo or line editing; ptys accept this too
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B115200);
+    cfsetospeed(&tty, B115200);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+    if (tcsetattr(fd, TCSANOW, &tty) != 0)
+    {
+      int error = errno;
+      close(fd);
+      errno = error;
+      return -1;
+    }
+  }
+  return fd;
+}
+
+} // namespace fleet
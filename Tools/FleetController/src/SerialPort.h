@@ -0,0 +1,17 @@
+// SerialPort.h
+// Non-blocking raw 115200 8N1 serial port (USB CDC or pty).
+
+#ifndef FLEET_SERIAL_PORT_H
+#define FLEET_SERIAL_PORT_H
+
+#include <string>
+
+namespace fleet
+{
+
+// Returns the fd, or -1 with errno set
+int openSerialPort(const std::string &path);
+
+} // namespace fleet
+
+#endif // FLEET_SERIAL_PORT_H
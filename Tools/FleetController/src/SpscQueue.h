@@ -0,0 +1,61 @@
+// SpscQueue.h
+// Bounded lock-free single producer / single consumer ring.
+// The reactor thread is the only producer for each writer's queue and the
+// writer thread its only consumer, so head and tail need no CAS.
+
+#ifndef FLEET_SPSC_QUEUE_H
+#define FLEET_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace fleet
+{
+
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  // Producer: reserve the next slot, fill it in place, then publish()
+  T *claim()
+  {
+    size_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail - cachedHead == Capacity)
+    {
+      cachedHead = headIndex.load(std::memory_order_acquire);
+      if (tail - cachedHead == Capacity)
+        return nullptr; // Full
+    }
+    return &slots[tail & (Capacity - 1)];
+  }
+
+  void publish() { tailIndex.store(tailIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer: peek the oldest slot, then release() it once consumed
+  T *front()
+  {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    if (head == cachedTail)
+    {
+      cachedTail = tailIndex.load(std::memory_order_acquire);
+      if (head == cachedTail)
+        return nullptr; // Empty
+    }
+    return &slots[head & (Capacity - 1)];
+  }
+
+  void release() { headIndex.store(headIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+  alignas(64) std::atomic<size_t> headIndex{0};
+  alignas(64) size_t cachedTail = 0; // Consumer's copy of tailIndex
+  alignas(64) std::atomic<size_t> tailIndex{0};
+  alignas(64) size_t cachedHead = 0; // Producer's copy of headIndex
+  alignas(64) T slots[Capacity];
+};
+
+} // namespace fleet
+
+#endif // FLEET_SPSC_QUEUE_H
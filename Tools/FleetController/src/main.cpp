@@ -0,0 +1,121 @@
+// main.cpp
+// fleetd: collects telemetry from many ASCD units on one host.
+//
+//   fleetd [-o <dir>] [-w <writers>] [-s <stats seconds>] [-f <port list>] [-b <scanner fifo>] [port ...]
+//
+// Every line from a unit goes to <dir>/<unit>.log with a millisecond time
+// stamp. Grade records also go to <dir>/results-<writer>.csv. The unit name
+// is the port's file name (use /dev/serial/by-id/... for stable names).
+// Lines "<unit> <slot> <barcode>" written to the scanner FIFO are sent to the
+// unit as BC<slot>=<barcode>.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "Reactor.h"
+#include "RecordWriter.h"
+
+namespace
+{
+
+void usage()
+{
+  fprintf(stderr, "usage: fleetd [-o dir] [-w writers] [-s stats_seconds] [-f port_list] [-b scanner_fifo] [port ...]\n");
+}
+
+std::string unitName(const std::string &path)
+{
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  std::string              outputDirectory = ".";
+  unsigned                 writerCount     = 2;
+  unsigned                 statsSeconds    = 60;
+  std::string              scannerPath;
+  std::vector<std::string> ports;
+
+  int option;
+  while ((option = getopt(argc, argv, "o:w:s:f:b:h")) != -1)
+  {
+    switch (option)
+    {
+    case 'o':
+      outputDirectory = optarg;
+      break;
+    case 'w':
+      writerCount = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 's':
+      statsSeconds = atoi(optarg);
+      break;
+    case 'b':
+      scannerPath = optarg;
+      break;
+    case 'f':
+    {
+      std::ifstream list(optarg);
+      std::string   line;
+      while (std::getline(list, line))
+      {
+        if (!line.empty() && line[0] != '#')
+          ports.push_back(line);
+      }
+      break;
+    }
+    default:
+      usage();
+      return 2;
+    }
+  }
+  for (int i = optind; i < argc; i++)
+    ports.push_back(argv[i]);
+  if (ports.empty() || ports.size() > 65535)
+  {
+    usage();
+    return 2;
+  }
+
+  std::vector<std::string> names;
+  for (const std::string &port : ports)
+    names.push_back(unitName(port));
+
+  std::vector<std::unique_ptr<fleet::RecordWriter>> writerStorage;
+  std::vector<fleet::RecordWriter *>                writers;
+  for (unsigned i = 0; i < writerCount; i++)
+  {
+    writerStorage.emplace_back(new fleet::RecordWriter(i, outputDirectory, names));
+    writers.push_back(writerStorage.back().get());
+  }
+
+  // The reactor blocks SIGINT / SIGTERM, create it before the writer threads so they inherit the mask
+  fleet::Reactor reactor(ports, writers);
+  reactor.statsSeconds = statsSeconds;
+  reactor.scannerPath  = scannerPath;
+  for (fleet::RecordWriter *writer : writers)
+    writer->start();
+
+  std::atomic<bool> stop{false};
+  reactor.run(stop);
+
+  for (fleet::RecordWriter *writer : writers)
+    writer->stop();
+
+  fleet::ReactorStats stats = reactor.stats();
+  fprintf(stderr,
+          "fleetd: %llu lines, %llu frames, %llu results, %llu dropped, %llu overlong, %llu barcodes (%llu rejected)\n",
+          (unsigned long long)stats.lines, (unsigned long long)stats.frames, (unsigned long long)stats.results,
+          (unsigned long long)stats.dropped, (unsigned long long)stats.overlong, (unsigned long long)stats.barcodes,
+          (unsigned long long)stats.rejected);
+  return 0;
+}
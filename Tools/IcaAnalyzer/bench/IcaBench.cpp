@@ -0,0 +1,153 @@
+// IcaBench.cpp
+// Benchmark for the incremental capacity analysis on synthetic discharge
+// curves shaped like the fleet telemetry: capacity ~ N(2500, 250) mAh, one
+// point per 1.22 mAh (4 s at 1.1 A), loaded voltage with 3 mV noise rounded
+// to 10 mV. Each curve has a sloped plateau, two tanh steps at random
+// positions (the larger one is the phase transition the dV/dQ peak should
+// find) and an end of discharge knee.
+//
+// Runs the pool repeatedly up to the requested number of curves and reports
+// curves/s for the one curve at a time path and the batched path at 1, 2, 4
+// ... threads, plus how far the dV/dQ peak lands from the true step.
+//
+//   ica_bench [-n curves] [-u pool size] [-t max threads] [-r seed]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/Ica.h"
+
+namespace
+{
+
+struct Synthetic
+{
+  std::vector<ica::Curve> curves;
+  std::vector<float>      stepSoc; // Position of the larger step, fraction of capacity
+};
+
+float step(float s, float position, float width) { return 0.5f * (1.0f + std::tanh((s - position) / width)); }
+
+Synthetic syntheticCurves(size_t count, uint64_t seed)
+{
+  std::mt19937_64                       random(seed);
+  std::normal_distribution<float>       capacity(2500.0f, 250.0f);
+  std::normal_distribution<float>       noise(0.0f, 0.003f);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  Synthetic                             synthetic;
+  synthetic.curves.resize(count);
+  synthetic.stepSoc.resize(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    ica::Curve &curve = synthetic.curves[i];
+    curve.id          = std::to_string(i);
+    float total       = std::max(1200.0f, capacity(random));
+    float major       = 0.25f + 0.4f * uniform(random);
+    float minor       = major + 0.12f + 0.1f * uniform(random);
+    float majorHeight = 0.10f + 0.04f * uniform(random);
+    float drop        = 0.05f + 0.08f * uniform(random); // IR drop at 1.1 A
+    synthetic.stepSoc[i] = major;
+
+    size_t points = (size_t)(total / 1.22f);
+    curve.milliamps.resize(points);
+    curve.volts.resize(points);
+    for (size_t n = 0; n < points; n++)
+    {
+      float s = (float)n / (points - 1);
+      float v = 4.10f - drop - 0.45f * s - majorHeight * step(s, major, 0.02f) - 0.04f * step(s, minor, 0.03f)
+                - 0.35f * std::exp((s - 1.0f) / 0.03f) + noise(random);
+      curve.milliamps[n] = s * total;
+      curve.volts[n]     = std::round(v * 100.0f) / 100.0f;
+    }
+  }
+  return synthetic;
+}
+
+double run(const Synthetic &synthetic, size_t total, const ica::IcaOptions &options, std::vector<ica::IcaFeatures> &features)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t done = 0; done < total; done += synthetic.curves.size())
+    ica::analyze(synthetic.curves, options, features);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char *name, unsigned threads, size_t curves, double seconds)
+{
+  printf("%-8s %2u threads  %9.0f curves/s  %6.1f s per million curves\n", name, threads, curves / seconds,
+         1e6 / (curves / seconds));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t   total      = 200000;
+  size_t   poolSize   = 2000;
+  unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  uint64_t seed       = 1;
+
+  int option;
+  while ((option = getopt(argc, argv, "n:u:t:r:h")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      total = strtoul(optarg, 0, 10);
+      break;
+    case 'u':
+      poolSize = std::max(1ul, strtoul(optarg, 0, 10));
+      break;
+    case 't':
+      maxThreads = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'r':
+      seed = strtoull(optarg, 0, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: ica_bench [-n curves] [-u pool size] [-t max threads] [-r seed]\n");
+      return 2;
+    }
+  }
+
+  Synthetic synthetic = syntheticCurves(poolSize, seed);
+  size_t    points    = 0;
+  for (const ica::Curve &curve : synthetic.curves)
+    points += curve.volts.size();
+  size_t curves = (total + poolSize - 1) / poolSize * poolSize;
+  printf("%zu curves (pool of %zu, %.0f points each)\n", curves, poolSize, (double)points / poolSize);
+
+  ica::IcaOptions               options;
+  std::vector<ica::IcaFeatures> scalar, batched;
+  options.batched = false;
+  options.threads = 1;
+  report("single", 1, curves, run(synthetic, total, options, scalar));
+  options.batched = true;
+  for (unsigned threads = 1;; threads = std::min(threads * 2, maxThreads))
+  {
+    options.threads = threads;
+    report("batched", threads, curves, run(synthetic, total, options, batched));
+    if (threads == maxThreads)
+      break;
+  }
+
+  // Both paths do the same arithmetic in the same order
+  size_t mismatched = 0;
+  for (size_t i = 0; i < poolSize; i++)
+    if (std::fabs(scalar[i].dvdqSoc - batched[i].dvdqSoc) > 1e-4f || std::fabs(scalar[i].peakVolts[0] - batched[i].peakVolts[0]) > 1e-4f)
+      mismatched++;
+
+  std::vector<float> errors;
+  for (size_t i = 0; i < poolSize; i++)
+    errors.push_back(std::fabs(batched[i].dvdqSoc - synthetic.stepSoc[i]) * 100.0f);
+  std::sort(errors.begin(), errors.end());
+  printf("dV/dQ peak error: median %.2f %%, p95 %.2f %%, max %.2f %% of capacity (%zu paths mismatched)\n",
+         errors[errors.size() / 2], errors[errors.size() * 95 / 100], errors.back(), mismatched);
+  return 0;
+}
@@ -0,0 +1,23 @@
+// Curve.h
+// One recorded discharge: capacity and loaded voltage from the &MA / &CV
+// telemetry fields, one point per frame (every 4 s at about 1.1 A).
+
+#ifndef ICA_CURVE_H
+#define ICA_CURVE_H
+
+#include <string>
+#include <vector>
+
+namespace ica
+{
+
+struct Curve
+{
+  std::string        id;        // <unit>/<slot>/<epoch ms of the first frame>
+  std::vector<float> milliamps; // Discharged so far, rising
+  std::vector<float> volts;     // Loaded cell voltage, 10 mV resolution
+};
+
+} // namespace ica
+
+#endif // ICA_CURVE_H
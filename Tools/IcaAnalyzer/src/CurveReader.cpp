@@ -0,0 +1,80 @@
+// CurveReader.cpp
+
+#include "CurveReader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace ica
+{
+
+namespace
+{
+
+const int slotCount = 4;
+
+// Value of &<key><slot>=, or nullptr
+const char *field(const char *line, const char *key, int slot)
+{
+  char name[8];
+  snprintf(name, sizeof(name), "&%s%d=", key, slot);
+  const char *at = strstr(line, name);
+  return at ? at + strlen(name) : nullptr;
+}
+
+} // namespace
+
+bool readLog(const std::string &path, size_t minPoints, std::vector<Curve> &curves)
+{
+  FILE *file = fopen(path.c_str(), "r");
+  if (file == nullptr)
+    return false;
+
+  size_t      slash = path.rfind('/');
+  std::string unit  = path.substr(slash == std::string::npos ? 0 : slash + 1);
+  if (unit.size() > 4 && unit.compare(unit.size() - 4, 4, ".log") == 0)
+    unit.resize(unit.size() - 4);
+
+  Curve open[slotCount];
+  auto  finish = [&](int slot) {
+    if (open[slot].milliamps.size() >= minPoints)
+      curves.push_back(std::move(open[slot]));
+    open[slot] = Curve();
+  };
+
+  char line[1024];
+  while (fgets(line, sizeof(line), file) != nullptr)
+  {
+    char *text = strchr(line, ' ');
+    if (text == nullptr || strncmp(text + 1, "&AT=", 4) != 0)
+      continue;
+    for (int slot = 0; slot < slotCount; slot++)
+    {
+      const char *state = field(text, "CS", slot);
+      const char *mah   = field(text, "MA", slot);
+      const char *volts = field(text, "CV", slot);
+      if (state == nullptr)
+        continue;
+      if (atoi(state) != 5 || mah == nullptr || volts == nullptr)
+      {
+        finish(slot);
+        continue;
+      }
+      Curve &curve = open[slot];
+      float  q = strtof(mah, nullptr), v = strtof(volts, nullptr);
+      if (!curve.milliamps.empty() && q < curve.milliamps.back())
+        finish(slot); // Next cell, the previous frame was its last
+      if (curve.milliamps.empty())
+        curve.id = unit + "/" + std::to_string(slot) + "/" + std::string(line, text - line);
+      curve.milliamps.push_back(q);
+      curve.volts.push_back(v);
+    }
+  }
+  for (int slot = 0; slot < slotCount; slot++)
+    finish(slot);
+  fclose(file);
+  return true;
+}
+
+} // namespace ica
@@ -0,0 +1,23 @@
+// CurveReader.h
+// Rebuilds discharge curves from the per-unit logs written by fleetd
+// (Tools/FleetController), one "<epoch ms> <line>" per line. A curve is the
+// run of telemetry frames in which a slot reports state 5 with &MA and &CV;
+// it ends when the slot leaves state 5 or its capacity starts over.
+
+#ifndef ICA_CURVE_READER_H
+#define ICA_CURVE_READER_H
+
+#include <string>
+#include <vector>
+
+#include "Curve.h"
+
+namespace ica
+{
+
+// Appends the curves of at least minPoints points. Returns false if the file cannot be opened.
+bool readLog(const std::string &path, size_t minPoints, std::vector<Curve> &curves);
+
+} // namespace ica
+
+#endif // ICA_CURVE_READER_H
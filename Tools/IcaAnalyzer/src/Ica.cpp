@@ -0,0 +1,266 @@
+// Ica.cpp
+
+#include "Ica.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace ica
+{
+
+namespace
+{
+
+typedef float Lanes __attribute__((vector_size(laneCount * sizeof(float))));
+
+const size_t blockCurves = 64; // Curves per job handed to a thread
+
+// Charge at each grid voltage, maxVolts first, written to out[g * stride]. The
+// voltage is made monotonic (running minimum) so noise cannot fold it back.
+void resampleCharge(const Curve &curve, const IcaOptions &options, float *out, size_t stride)
+{
+  const std::vector<float> &q = curve.milliamps, &v = curve.volts;
+  unsigned points = options.voltPoints();
+  size_t   i      = 0;
+  float    level  = v.empty() ? 0 : v[0], previousLevel = level, previousCharge = q.empty() ? 0 : q[0];
+  for (unsigned g = 0; g < points; g++)
+  {
+    float volts = options.maxVolts - g * options.voltStep;
+    while (i < v.size() && level > volts)
+    {
+      previousLevel  = level;
+      previousCharge = q[i];
+      if (++i < v.size())
+        level = std::min(level, v[i]);
+    }
+    float charge;
+    if (i == 0)
+      charge = q.empty() ? 0 : q[0]; // Above the first point
+    else if (i >= v.size())
+      charge = q.back(); // Below the last point
+    else if (previousLevel > level)
+      charge = previousCharge + (q[i] - previousCharge) * (previousLevel - volts) / (previousLevel - level);
+    else
+      charge = q[i];
+    out[g * stride] = charge;
+  }
+}
+
+// Voltage at capacityPoints evenly spaced charges from 0 to the curve's capacity
+void resampleVoltage(const Curve &curve, const IcaOptions &options, float *out, size_t stride)
+{
+  const std::vector<float> &q = curve.milliamps, &v = curve.volts;
+  unsigned points = options.capacityPoints;
+  float    total  = q.empty() ? 0 : q.back();
+  size_t   i      = 0;
+  for (unsigned k = 0; k < points; k++)
+  {
+    float charge = total * k / (points - 1);
+    while (i + 1 < q.size() && q[i + 1] < charge)
+      i++;
+    float volts;
+    if (i + 1 >= q.size())
+      volts = v.empty() ? 0 : v.back();
+    else if (q[i + 1] > q[i])
+      volts = v[i] + (v[i + 1] - v[i]) * std::min(1.0f, std::max(0.0f, (charge - q[i]) / (q[i + 1] - q[i])));
+    else
+      volts = v[i];
+    out[k * stride] = volts;
+  }
+}
+
+// [1 2 1] / 4 in place, ends left as they are. T is float or Lanes.
+template <typename T> void smooth(T *x, unsigned points, unsigned passes)
+{
+  for (unsigned pass = 0; pass < passes; pass++)
+  {
+    T previous = x[0];
+    for (unsigned i = 1; i + 1 < points; i++)
+    {
+      T current = x[i];
+      x[i]      = (previous + current + current + x[i + 1]) * 0.25f;
+      previous  = current;
+    }
+  }
+}
+
+// Least-squares slope per grid step over 2 * half + 1 points, times scale; 0 at the ends
+template <typename T> void slope(const T *x, T *out, unsigned points, unsigned half, float scale)
+{
+  float norm = 0;
+  for (unsigned k = 1; k <= half; k++)
+    norm += 2.0f * k * k;
+  scale /= norm;
+  for (unsigned i = 0; i < points; i++)
+  {
+    if (i < half || i + half >= points)
+    {
+      out[i] = x[i] * 0.0f;
+      continue;
+    }
+    T sum = (x[i + 1] - x[i - 1]);
+    for (unsigned k = 2; k <= half; k++)
+      sum += (x[i + k] - x[i - k]) * (float)k;
+    out[i] = sum * scale;
+  }
+}
+
+// Highest local maximum in [from, to), at least spacing points away from exclude (< 0 = none), refined with
+// the parabola through its neighbours
+bool highestPeak(const float *y, unsigned from, unsigned to, float exclude, float spacing, float &position,
+                 float &height)
+{
+  height = 0;
+  bool found = false;
+  for (unsigned i = std::max(from, 1u); i + 1 < to; i++)
+  {
+    if (y[i] > y[i - 1] && y[i] >= y[i + 1] && y[i] > height && (exclude < 0 || std::fabs(i - exclude) > spacing))
+    {
+      float curvature = y[i - 1] - 2 * y[i] + y[i + 1];
+      position        = i + (curvature < 0 ? 0.5f * (y[i - 1] - y[i + 1]) / curvature : 0.0f);
+      height          = y[i];
+      found           = true;
+    }
+  }
+  return found;
+}
+
+void extract(const float *dqdv, const float *dvdq, float milliamps, const IcaOptions &options, IcaFeatures &features)
+{
+  unsigned voltPoints = options.voltPoints();
+  features.milliamps  = milliamps;
+  float first = -1, position, height;
+  for (unsigned n = 0; n < 2; n++)
+  {
+    if (!highestPeak(dqdv, 0, voltPoints, first, options.halfWindow, position, height))
+      break;
+    features.peakVolts[n]  = options.maxVolts - position * options.voltStep;
+    features.peakHeight[n] = height;
+    first                  = position;
+  }
+  unsigned margin = (unsigned)(options.dvdqMargin * (options.capacityPoints - 1));
+  if (highestPeak(dvdq, margin, options.capacityPoints - margin, -1, 0, position, height))
+  {
+    features.dvdqSoc    = position / (options.capacityPoints - 1);
+    features.dvdqHeight = height;
+  }
+}
+
+// Charge per grid step to dQ/dV in mAh/V, volts per step to dV/dQ in V/Ah
+float chargeScale(const IcaOptions &options) { return 1.0f / options.voltStep; }
+float voltageScale(const IcaOptions &options, float milliamps)
+{
+  return milliamps > 0 ? -1000.0f * (options.capacityPoints - 1) / milliamps : 0.0f;
+}
+
+// One curve at a time
+struct ScalarWorker
+{
+  std::vector<float> charge, dqdv, volts, dvdq;
+
+  void run(const Curve &curve, const IcaOptions &options, IcaFeatures &features)
+  {
+    unsigned voltPoints = options.voltPoints(), capacityPoints = options.capacityPoints;
+    float    milliamps  = curve.milliamps.empty() ? 0 : curve.milliamps.back();
+    charge.resize(voltPoints);
+    dqdv.resize(voltPoints);
+    volts.resize(capacityPoints);
+    dvdq.resize(capacityPoints);
+    resampleCharge(curve, options, charge.data(), 1);
+    resampleVoltage(curve, options, volts.data(), 1);
+    smooth(charge.data(), voltPoints, options.smoothPasses);
+    smooth(volts.data(), capacityPoints, options.smoothPasses);
+    slope(charge.data(), dqdv.data(), voltPoints, options.halfWindow, chargeScale(options));
+    slope(volts.data(), dvdq.data(), capacityPoints, options.halfWindow, voltageScale(options, milliamps));
+    extract(dqdv.data(), dvdq.data(), milliamps, options, features);
+  }
+};
+
+// laneCount curves at a time, one per lane. The dV/dQ scale differs per curve,
+// so the slope is left in volts per grid step and scaled per lane afterwards.
+struct BatchWorker
+{
+  std::vector<Lanes> charge, dqdv, volts, dvdq;
+  std::vector<float> laneDqdv, laneDvdq;
+
+  void run(const Curve *curves, size_t count, const IcaOptions &options, IcaFeatures *features)
+  {
+    unsigned voltPoints = options.voltPoints(), capacityPoints = options.capacityPoints;
+    charge.resize(voltPoints);
+    dqdv.resize(voltPoints);
+    volts.resize(capacityPoints);
+    dvdq.resize(capacityPoints);
+    laneDqdv.resize(voltPoints);
+    laneDvdq.resize(capacityPoints);
+
+    static const Curve empty;
+    for (unsigned lane = 0; lane < laneCount; lane++)
+    {
+      const Curve &curve = lane < count ? curves[lane] : empty;
+      resampleCharge(curve, options, (float *)charge.data() + lane, laneCount);
+      resampleVoltage(curve, options, (float *)volts.data() + lane, laneCount);
+    }
+    smooth(charge.data(), voltPoints, options.smoothPasses);
+    smooth(volts.data(), capacityPoints, options.smoothPasses);
+    slope(charge.data(), dqdv.data(), voltPoints, options.halfWindow, chargeScale(options));
+    slope(volts.data(), dvdq.data(), capacityPoints, options.halfWindow, 1.0f);
+
+    for (unsigned lane = 0; lane < count; lane++)
+    {
+      float milliamps = curves[lane].milliamps.empty() ? 0 : curves[lane].milliamps.back();
+      float scale     = voltageScale(options, milliamps);
+      for (unsigned g = 0; g < voltPoints; g++)
+        laneDqdv[g] = dqdv[g][lane];
+      for (unsigned k = 0; k < capacityPoints; k++)
+        laneDvdq[k] = dvdq[k][lane] * scale;
+      extract(laneDqdv.data(), laneDvdq.data(), milliamps, options, features[lane]);
+    }
+  }
+};
+
+} // namespace
+
+void analyze(const std::vector<Curve> &curves, const IcaOptions &options, std::vector<IcaFeatures> &features)
+{
+  features.assign(curves.size(), IcaFeatures());
+  if (options.voltPoints() < 2 * options.halfWindow + 3 || options.capacityPoints < 2 * options.halfWindow + 3)
+    return;
+
+  std::atomic<size_t> nextBlock{0};
+  auto worker = [&]() {
+    ScalarWorker scalar;
+    BatchWorker  batch;
+    for (size_t first = nextBlock++ * blockCurves; first < curves.size(); first = nextBlock++ * blockCurves)
+    {
+      size_t last = std::min(first + blockCurves, curves.size());
+      for (size_t i = first; i < last; i += options.batched ? laneCount : 1)
+      {
+        if (options.batched)
+          batch.run(&curves[i], std::min<size_t>(laneCount, last - i), options, &features[i]);
+        else
+          scalar.run(curves[i], options, features[i]);
+      }
+    }
+  };
+
+  unsigned                 threads = std::max(options.threads, 1u);
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++)
+    pool.emplace_back(worker);
+  worker();
+  for (std::thread &thread : pool)
+    thread.join();
+}
+
+void profiles(const Curve &curve, const IcaOptions &options, std::vector<float> &dqdv, std::vector<float> &dvdq)
+{
+  ScalarWorker worker;
+  IcaFeatures  features;
+  worker.run(curve, options, features);
+  dqdv = worker.dqdv;
+  dvdq = worker.dvdq;
+}
+
+} // namespace ica
@@ -0,0 +1,64 @@
+// Ica.h
+// Incremental capacity analysis of discharge curves.
+//
+// Each curve is resampled twice:
+//   - charge against voltage on a fixed grid (maxVolts down to minVolts),
+//     whose slope is dQ/dV: its peaks are the voltage plateaus
+//   - voltage against charge on a grid over the curve's own capacity, whose
+//     slope is dV/dQ: its peaks are the phase transitions, as a fraction of
+//     capacity
+// The resampled curves are smoothed with [1 2 1] / 4 passes and
+// differentiated with a Savitzky-Golay slope (least-squares line over
+// 2 * halfWindow + 1 points). The telemetry voltage has 10 mV steps, so the
+// smoothing window needs to span a few of them.
+//
+// Smoothing and slopes run on batches of laneCount curves, one vector lane
+// per curve (GCC vector extensions, AVX / SSE / NEON as the target allows).
+// Batches are spread over a pool of threads.
+
+#ifndef ICA_ICA_H
+#define ICA_ICA_H
+
+#include <vector>
+
+#include "Curve.h"
+
+namespace ica
+{
+
+const unsigned laneCount = 8;
+
+struct IcaOptions
+{
+  float    minVolts       = 2.80f;
+  float    maxVolts       = 4.20f;
+  float    voltStep       = 0.005f; // dQ/dV grid
+  unsigned capacityPoints = 200;    // dV/dQ grid over 0 .. 100 % of the curve's capacity
+  unsigned smoothPasses   = 2;
+  unsigned halfWindow     = 8;      // Slope over 2 * halfWindow + 1 grid points
+  float    dvdqMargin     = 0.05f;  // dV/dQ peaks are only looked for this far inside either end
+  unsigned threads        = 1;
+  bool     batched        = true;   // false = one curve at a time (benchmark reference)
+
+  unsigned voltPoints() const { return (unsigned)((maxVolts - minVolts) / voltStep + 1.5f); }
+};
+
+struct IcaFeatures
+{
+  float milliamps     = 0;    // Capacity of the curve
+  float peakVolts[2]  = {};   // Two highest dQ/dV peaks at least halfWindow apart, highest first, 0 = none
+  float peakHeight[2] = {};   // mAh/V
+  float dvdqSoc       = 0;    // Highest interior dV/dQ peak, fraction of capacity discharged
+  float dvdqHeight    = 0;    // V/Ah
+};
+
+// features[i] for curves[i]
+void analyze(const std::vector<Curve> &curves, const IcaOptions &options, std::vector<IcaFeatures> &features);
+
+// dQ/dV (mAh/V, options.voltPoints() values from maxVolts down) and dV/dQ
+// (V/Ah, capacityPoints values) of one curve, for plotting
+void profiles(const Curve &curve, const IcaOptions &options, std::vector<float> &dqdv, std::vector<float> &dvdq);
+
+} // namespace ica
+
+#endif // ICA_ICA_H
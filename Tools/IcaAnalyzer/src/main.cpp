@@ -0,0 +1,153 @@
+// main.cpp
+// ica: incremental capacity (dQ/dV and dV/dQ) features of recorded discharges.
+//
+//   ica [-t threads] [-m min points] [-o features.csv] [-p profiles.csv] unit.log ...
+//
+// Reads the per-unit logs written by fleetd, one file at a time, and writes
+// one row per discharge curve:
+//
+//   curve,mah,peak1_v,peak1_mah_per_v,peak2_v,peak2_mah_per_v,dvdq_peak_soc,dvdq_peak_v_per_ah,peak1_shift_mv
+//
+// peak1_shift_mv is the main dQ/dV peak against the median over all curves;
+// an aged or mismatched cell shows up as a shifted or flattened peak. -p
+// writes the smoothed dQ/dV profile of every curve (curve,volts,mah_per_v)
+// for plotting.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "CurveReader.h"
+#include "Ica.h"
+
+namespace
+{
+
+struct Row
+{
+  std::string      id;
+  ica::IcaFeatures features;
+};
+
+void usage()
+{
+  fprintf(stderr, "usage: ica [-t threads] [-m min_points] [-o features.csv] [-p profiles.csv] unit.log ...\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  ica::IcaOptions options;
+  options.threads       = std::thread::hardware_concurrency();
+  size_t      minPoints = 2 * options.halfWindow + 8;
+  std::string outputPath, profilePath;
+
+  int option;
+  while ((option = getopt(argc, argv, "t:m:o:p:h")) != -1)
+  {
+    switch (option)
+    {
+    case 't':
+      options.threads = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'm':
+      minPoints = strtoul(optarg, 0, 10);
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'p':
+      profilePath = optarg;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind >= argc)
+  {
+    usage();
+    return 2;
+  }
+
+  FILE *profileOutput = 0;
+  if (!profilePath.empty() && !(profileOutput = fopen(profilePath.c_str(), "w")))
+  {
+    fprintf(stderr, "ica: cannot write %s\n", profilePath.c_str());
+    return 1;
+  }
+  if (profileOutput)
+    fprintf(profileOutput, "curve,volts,mah_per_v\n");
+
+  // One log at a time so only its curves are held in memory
+  std::vector<Row>              rows;
+  std::vector<ica::Curve>       curves;
+  std::vector<ica::IcaFeatures> features;
+  std::vector<float>            dqdv, dvdq;
+  size_t                        points  = 0;
+  double                        seconds = 0;
+  for (int i = optind; i < argc; i++)
+  {
+    curves.clear();
+    if (!ica::readLog(argv[i], minPoints, curves))
+    {
+      fprintf(stderr, "ica: cannot read %s\n", argv[i]);
+      return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ica::analyze(curves, options, features);
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t n = 0; n < curves.size(); n++)
+    {
+      rows.push_back({curves[n].id, features[n]});
+      points += curves[n].volts.size();
+      if (!profileOutput)
+        continue;
+      ica::profiles(curves[n], options, dqdv, dvdq);
+      for (size_t g = 0; g < dqdv.size(); g++)
+        fprintf(profileOutput, "%s,%.3f,%.1f\n", curves[n].id.c_str(), options.maxVolts - g * options.voltStep,
+                dqdv[g]);
+    }
+  }
+  if (profileOutput)
+    fclose(profileOutput);
+
+  std::vector<float> peaks;
+  for (const Row &row : rows)
+    if (row.features.peakVolts[0] > 0)
+      peaks.push_back(row.features.peakVolts[0]);
+  float median = 0;
+  if (!peaks.empty())
+  {
+    std::nth_element(peaks.begin(), peaks.begin() + peaks.size() / 2, peaks.end());
+    median = peaks[peaks.size() / 2];
+  }
+
+  FILE *output = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "w");
+  if (!output)
+  {
+    fprintf(stderr, "ica: cannot write %s\n", outputPath.c_str());
+    return 1;
+  }
+  fprintf(output, "curve,mah,peak1_v,peak1_mah_per_v,peak2_v,peak2_mah_per_v,dvdq_peak_soc,dvdq_peak_v_per_ah,"
+                  "peak1_shift_mv\n");
+  for (const Row &row : rows)
+  {
+    const ica::IcaFeatures &f = row.features;
+    fprintf(output, "%s,%.0f,%.3f,%.0f,%.3f,%.0f,%.3f,%.3f,%.0f\n", row.id.c_str(), f.milliamps, f.peakVolts[0],
+            f.peakHeight[0], f.peakVolts[1], f.peakHeight[1], f.dvdqSoc, f.dvdqHeight,
+            f.peakVolts[0] > 0 ? (f.peakVolts[0] - median) * 1000.0f : 0.0f);
+  }
+  if (output != stdout)
+    fclose(output);
+
+  fprintf(stderr, "ica: %zu curves, %zu points, median peak %.3f V, %.3f s on %u threads\n", rows.size(), points,
+          median, seconds, options.threads);
+  return 0;
+}
@@ -0,0 +1,184 @@
+// PackBench.cpp
+// Benchmark for the pack solver on a synthetic pool of graded cells:
+// capacity ~ N(2500, 250) mAh, resistance falling with capacity plus noise.
+// Two cases: the whole pool cut into many small packs, and the whole pool
+// in one very wide pack. Each case compares the spreads of
+//   sorted  - groups filled from the capacity sorted window in order
+//   snake   - serpentine fill, the usual spreadsheet method
+//   kk      - balanced largest differencing
+//   kk+sa   - differencing, then simulated annealing
+// and times kk+sa at 1, 2, 4 ... threads.
+//
+//   pack_bench [-n cells] [-s series] [-p parallel] [-i iterations] [-t max threads] [-r seed]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/PackSolver.h"
+
+namespace
+{
+
+std::vector<pack::Cell> syntheticCells(size_t count, uint64_t seed)
+{
+  std::mt19937_64                 random(seed);
+  std::normal_distribution<float> capacity(2500.0f, 250.0f);
+  std::normal_distribution<float> noise(0.0f, 6.0f);
+  std::vector<pack::Cell>         cells(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    pack::Cell &cell = cells[i];
+    cell.id          = std::to_string(i);
+    cell.milliamps   = std::max(1200.0f, capacity(random));
+    cell.milliOhms   = std::max(15.0f, 45.0f - (cell.milliamps - 2500.0f) * 0.02f + noise(random));
+    cell.grade       = 'A';
+  }
+  return cells;
+}
+
+// Packs cut from the capacity sorted pool like buildPacks, groups filled in order or serpentine
+std::vector<pack::PackLayout> fillPacks(const std::vector<pack::Cell> &cells, size_t packs,
+                                        const pack::PackOptions &options, bool snake)
+{
+  std::vector<uint32_t> order(cells.size());
+  for (uint32_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+    return cells[x].milliamps != cells[y].milliamps ? cells[x].milliamps > cells[y].milliamps : x < y;
+  });
+
+  size_t                        perPack = (size_t)options.series * options.parallel;
+  std::vector<pack::PackLayout> layouts(packs);
+  for (size_t p = 0; p < packs; p++)
+  {
+    pack::PackLayout &layout = layouts[p];
+    layout.cells.resize(perPack);
+    for (size_t n = 0; n < perPack; n++)
+    {
+      size_t row = n / options.series, column = n % options.series;
+      size_t group = snake && (row & 1) ? options.series - 1 - column : column;
+      if (!snake)
+      {
+        group = n / options.parallel;
+        row   = n % options.parallel;
+      }
+      layout.cells[group * options.parallel + row] = order[p * perPack + n];
+    }
+    pack::evaluate(cells, options, layout);
+  }
+  return layouts;
+}
+
+void report(const char *name, const std::vector<pack::PackLayout> &layouts, double seconds)
+{
+  double capacityMean = 0, capacityWorst = 0, resistanceMean = 0, resistanceWorst = 0;
+  for (const pack::PackLayout &layout : layouts)
+  {
+    capacityMean += layout.capacitySpreadPercent();
+    capacityWorst = std::max(capacityWorst, layout.capacitySpreadPercent());
+    resistanceMean += layout.resistanceSpreadPercent();
+    resistanceWorst = std::max(resistanceWorst, layout.resistanceSpreadPercent());
+  }
+  capacityMean /= layouts.size();
+  resistanceMean /= layouts.size();
+  printf("  %-14s capacity spread %9.5f %% (worst %9.5f %%)  IR spread %7.3f %% (worst %7.3f %%)  %9.1f ms\n", name,
+         capacityMean, capacityWorst, resistanceMean, resistanceWorst, seconds * 1000.0);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void runCase(const std::vector<pack::Cell> &cells, pack::PackOptions options, unsigned maxThreads)
+{
+  size_t packs = cells.size() / ((size_t)options.series * options.parallel);
+  printf("%zu x %uS%uP from %zu cells, %llu annealing moves per chain\n", packs, options.series, options.parallel,
+         cells.size(), (unsigned long long)options.iterations);
+  if (packs == 0)
+    return;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<pack::PackLayout> layouts = fillPacks(cells, packs, options, false);
+  report("sorted", layouts, secondsSince(start));
+  start   = std::chrono::steady_clock::now();
+  layouts = fillPacks(cells, packs, options, true);
+  report("snake", layouts, secondsSince(start));
+
+  pack::PackOptions differencingOnly = options;
+  differencingOnly.iterations        = 0;
+  start   = std::chrono::steady_clock::now();
+  layouts = pack::buildPacks(cells, packs, differencingOnly, 1);
+  report("kk", layouts, secondsSince(start));
+
+  // Chains fixed at the most threads tried, so every run does the same work
+  // and finds the same layouts; only the wall time changes
+  options.chains = std::max<unsigned>(1, maxThreads / packs);
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "kk+sa %u thr", threads);
+    start   = std::chrono::steady_clock::now();
+    layouts = pack::buildPacks(cells, packs, options, threads);
+    report(name, layouts, secondsSince(start));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t            count = 100000;
+  pack::PackOptions options;
+  options.series   = 14;
+  options.parallel = 10;
+  unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  uint64_t seed       = 1;
+
+  int option;
+  while ((option = getopt(argc, argv, "n:s:p:i:t:r:h")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      count = strtoul(optarg, 0, 10);
+      break;
+    case 's':
+      options.series = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'p':
+      options.parallel = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'i':
+      options.iterations = strtoull(optarg, 0, 10);
+      break;
+    case 't':
+      maxThreads = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'r':
+      seed = strtoull(optarg, 0, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: pack_bench [-n cells] [-s series] [-p parallel] [-i iterations] [-t max_threads] "
+                      "[-r seed]\n");
+      return 2;
+    }
+  }
+
+  std::vector<pack::Cell> cells = syntheticCells(count, seed);
+  runCase(cells, options, maxThreads);
+
+  // The whole pool in one pack: 20 groups of count / 20 cells
+  pack::PackOptions wide = options;
+  wide.series            = 20;
+  wide.parallel          = count / 20;
+  printf("\n");
+  runCase(cells, wide, maxThreads);
+  return 0;
+}
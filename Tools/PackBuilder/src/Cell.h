@@ -0,0 +1,22 @@
+// Cell.h
+// One graded cell, as reported by the firmware's &RR result record.
+
+#ifndef PACK_CELL_H
+#define PACK_CELL_H
+
+#include <string>
+
+namespace pack
+{
+
+struct Cell
+{
+  std::string id;        // <unit>/<slot>/<time ms> from the fleetd record
+  float       milliamps; // Discharge capacity (mAh)
+  float       milliOhms; // Internal resistance
+  char        grade;     // 'A', 'B', 'C' or 'R'
+};
+
+} // namespace pack
+
+#endif // PACK_CELL_H
@@ -0,0 +1,63 @@
+// CellReader.cpp
+
+#include "CellReader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace pack
+{
+
+bool readResults(const std::string &path, const std::string &grades, float maxMilliOhms, std::vector<Cell> &cells,
+                 ReadStats &stats)
+{
+  FILE *file = fopen(path.c_str(), "r");
+  if (file == nullptr)
+    return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), file) != nullptr)
+  {
+    if (strncmp(line, "time_ms,", 8) == 0 || line[0] == '\n')
+      continue;
+
+    // Split in place: time_ms, unit, slot, grade, mah, mwh, milliohms, ...
+    char  *fields[10];
+    size_t count = 0;
+    for (char *p = line; count < 10; p++)
+    {
+      fields[count++] = p;
+      p = strpbrk(p, ",\r\n");
+      if (p == nullptr)
+        break;
+      bool last = *p != ',';
+      *p = '\0';
+      if (last)
+        break;
+    }
+    if (count < 7 || fields[3][0] == '\0')
+    {
+      stats.malformed++;
+      continue;
+    }
+
+    Cell cell;
+    cell.grade     = fields[3][0];
+    cell.milliamps = strtof(fields[4], nullptr);
+    cell.milliOhms = strtof(fields[6], nullptr);
+    if (grades.find(cell.grade) == std::string::npos || cell.milliamps <= 0.0f || cell.milliOhms <= 0.0f ||
+        (maxMilliOhms > 0.0f && cell.milliOhms > maxMilliOhms))
+    {
+      stats.filtered++;
+      continue;
+    }
+    cell.id = std::string(fields[1]) + "/" + fields[2] + "/" + fields[0];
+    cells.push_back(cell);
+    stats.accepted++;
+  }
+  fclose(file);
+  return true;
+}
+
+} // namespace pack
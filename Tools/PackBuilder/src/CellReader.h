@@ -0,0 +1,34 @@
+// CellReader.h
+// Loads graded cells from the results CSVs written by fleetd
+// (Tools/FleetController):
+//
+//   time_ms,unit,slot,grade,mah,mwh,milliohms,temp_rise,charge_minutes,fault
+//
+// Header lines are skipped, so several files can be concatenated.
+
+#ifndef PACK_CELL_READER_H
+#define PACK_CELL_READER_H
+
+#include <string>
+#include <vector>
+
+#include "Cell.h"
+
+namespace pack
+{
+
+struct ReadStats
+{
+  size_t accepted = 0;
+  size_t filtered = 0; // Grade not wanted or resistance above the limit
+  size_t malformed = 0;
+};
+
+// Appends the cells whose grade is in grades and whose resistance is at most
+// maxMilliOhms (0 = no limit). Returns false if the file cannot be opened.
+bool readResults(const std::string &path, const std::string &grades, float maxMilliOhms, std::vector<Cell> &cells,
+                 ReadStats &stats);
+
+} // namespace pack
+
+#endif // PACK_CELL_READER_H
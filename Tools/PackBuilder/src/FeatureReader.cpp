@@ -0,0 +1,109 @@
+// FeatureReader.cpp
+
+#include "FeatureReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace pack
+{
+
+namespace
+{
+
+// Splits <unit>/<slot>/<time ms> into the index key and the time, false if malformed
+bool splitId(const std::string &id, std::string &key, uint64_t &millis)
+{
+  size_t slash = id.rfind('/');
+  if (slash == std::string::npos || slash == 0 || slash + 1 >= id.size())
+    return false;
+  key    = id.substr(0, slash);
+  millis = strtoull(id.c_str() + slash + 1, nullptr, 10);
+  return key.find('/') != std::string::npos;
+}
+
+// The &RR mAh and the last &MA of the curve are a telemetry frame (~1.2 mAh) or rounding apart
+bool sameCapacity(float curve, float result)
+{
+  return std::fabs(curve - result) <= std::max(20.0f, result * 0.01f);
+}
+
+} // namespace
+
+bool readFeatures(const std::string &path, ShiftIndex &index)
+{
+  FILE *file = fopen(path.c_str(), "r");
+  if (file == nullptr)
+    return false;
+
+  char line[512];
+  while (fgets(line, sizeof(line), file) != nullptr)
+  {
+    if (strncmp(line, "curve,", 6) == 0 || line[0] == '\n')
+      continue;
+
+    // curve, mah, 6 peak columns, peak1_shift_mv
+    char  *fields[9];
+    size_t count = 0;
+    for (char *p = line; count < 9; p++)
+    {
+      fields[count++] = p;
+      p = strpbrk(p, ",\r\n");
+      if (p == nullptr)
+        break;
+      bool last = *p != ',';
+      *p = '\0';
+      if (last)
+        break;
+    }
+
+    std::string key;
+    CurveShift  curve;
+    if (count < 9 || !splitId(fields[0], key, curve.startMillis))
+      continue;
+    curve.milliamps       = strtof(fields[1], nullptr);
+    curve.shiftMilliVolts = strtof(fields[8], nullptr);
+    index[key].push_back(curve);
+  }
+  fclose(file);
+  return true;
+}
+
+void dropShifted(const ShiftIndex &index, float maxShiftMilliVolts, std::vector<Cell> &cells, FeatureStats &stats)
+{
+  size_t kept = 0;
+  for (size_t n = 0; n < cells.size(); n++)
+  {
+    std::string key;
+    uint64_t    resultMillis;
+    const CurveShift *match = nullptr;
+    auto curves = index.end();
+    if (splitId(cells[n].id, key, resultMillis))
+      curves = index.find(key);
+    if (curves != index.end())
+    {
+      for (const CurveShift &curve : curves->second)
+      {
+        if (curve.startMillis < resultMillis && sameCapacity(curve.milliamps, cells[n].milliamps) &&
+            (match == nullptr || curve.startMillis > match->startMillis))
+          match = &curve;
+      }
+    }
+    if (match != nullptr)
+    {
+      stats.matched++;
+      if (std::fabs(match->shiftMilliVolts) > maxShiftMilliVolts)
+      {
+        stats.shifted++;
+        continue;
+      }
+    }
+    cells[kept++] = cells[n];
+  }
+  cells.resize(kept);
+}
+
+} // namespace pack
@@ -0,0 +1,50 @@
+// FeatureReader.h
+// Loads the incremental capacity features written by ica (Tools/IcaAnalyzer)
+// so cells whose main dQ/dV peak has moved away from the fleet stay out of
+// the packs:
+//
+//   curve,mah,peak1_v,peak1_mah_per_v,peak2_v,peak2_mah_per_v,dvdq_peak_soc,dvdq_peak_v_per_ah,peak1_shift_mv
+//
+// A curve is <unit>/<slot>/<time ms of its first frame>. A cell takes the
+// last curve of its unit and slot that started before its result and ended
+// at the same capacity (the &RR mAh is the last &MA of the discharge).
+
+#ifndef PACK_FEATURE_READER_H
+#define PACK_FEATURE_READER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Cell.h"
+
+namespace pack
+{
+
+struct CurveShift
+{
+  uint64_t startMillis;
+  float    milliamps;
+  float    shiftMilliVolts; // peak1_shift_mv, 0 when the curve had no peak
+};
+
+// Curves by <unit>/<slot>
+typedef std::unordered_map<std::string, std::vector<CurveShift>> ShiftIndex;
+
+struct FeatureStats
+{
+  size_t matched = 0;
+  size_t shifted = 0; // Dropped, peak further than the limit from the median
+};
+
+// Adds the curves of a features CSV. Returns false if the file cannot be opened.
+bool readFeatures(const std::string &path, ShiftIndex &index);
+
+// Removes the cells whose curve has |peak1_shift_mv| above maxShiftMilliVolts.
+// Cells without a matching curve are kept.
+void dropShifted(const ShiftIndex &index, float maxShiftMilliVolts, std::vector<Cell> &cells, FeatureStats &stats);
+
+} // namespace pack
+
+#endif // PACK_FEATURE_READER_H
@@ -0,0 +1,294 @@
+// PackSolver.cpp
+
+#include "PackSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <queue>
+#include <thread>
+
+namespace pack
+{
+
+namespace
+{
+
+// splitmix64: small, fast and good enough for move selection
+struct Random
+{
+  uint64_t state;
+
+  explicit Random(uint64_t seed) : state(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+  uint32_t below(uint32_t n) { return (uint32_t)(((next() >> 32) * n) >> 32); }
+  double   unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// Group sums of one layout, with the extremes and cost kept up to date
+class GroupSums
+{
+public:
+  GroupSums(const std::vector<Cell> &cells, const PackOptions &options, const std::vector<uint32_t> &layout)
+    : series(options.series), weight(options.resistanceWeight), capacity(series, 0.0), conductance(series, 0.0)
+  {
+    for (unsigned g = 0; g < series; g++)
+    {
+      for (unsigned i = 0; i < options.parallel; i++)
+      {
+        const Cell &cell = cells[layout[g * options.parallel + i]];
+        capacity[g] += cell.milliamps;
+        conductance[g] += 1.0 / cell.milliOhms;
+      }
+    }
+    // Swaps keep both totals, so the normalisers stay fixed
+    double totalCapacity = 0, totalConductance = 0;
+    for (unsigned g = 0; g < series; g++)
+    {
+      totalCapacity += capacity[g];
+      totalConductance += conductance[g];
+    }
+    capacityScale   = series / totalCapacity;
+    resistanceScale = totalConductance / series;
+    update();
+  }
+
+  void update()
+  {
+    capacityMin = capacityMax = capacity[0];
+    conductanceMin = conductanceMax = conductance[0];
+    largest = smallest = 0;
+    for (unsigned g = 1; g < series; g++)
+    {
+      if (capacity[g] > capacityMax)
+      {
+        capacityMax = capacity[g];
+        largest     = g;
+      }
+      if (capacity[g] < capacityMin)
+      {
+        capacityMin = capacity[g];
+        smallest    = g;
+      }
+      conductanceMin = std::min(conductanceMin, conductance[g]);
+      conductanceMax = std::max(conductanceMax, conductance[g]);
+    }
+    cost = (capacityMax - capacityMin) * capacityScale +
+           weight * (1.0 / conductanceMin - 1.0 / conductanceMax) * resistanceScale;
+  }
+
+  unsigned            series;
+  double              weight;
+  std::vector<double> capacity;
+  std::vector<double> conductance; // 1 / mOhm, adds up for cells in parallel
+  double              capacityScale, resistanceScale;
+  double              capacityMin, capacityMax, conductanceMin, conductanceMax, cost;
+  unsigned            largest, smallest; // Groups with the most and least capacity
+};
+
+} // namespace
+
+void evaluate(const std::vector<Cell> &cells, const PackOptions &options, PackLayout &layout)
+{
+  GroupSums sums(cells, options, layout.cells);
+  layout.capacityMin   = sums.capacityMin;
+  layout.capacityMax   = sums.capacityMax;
+  layout.resistanceMin = 1.0 / sums.conductanceMax;
+  layout.resistanceMax = 1.0 / sums.conductanceMin;
+  layout.cost          = sums.cost;
+}
+
+PackLayout differencing(const std::vector<Cell> &cells, const uint32_t *members, const PackOptions &options)
+{
+  const unsigned k = options.series;
+  const unsigned m = options.parallel;
+
+  // Partial layouts of k subsets each, subsets sorted by sum (largest first).
+  // Subset s of partial p lives at p * k + s; its cells are a linked list over
+  // member positions so merging two subsets is O(1).
+  std::vector<double>   sum(k * m);
+  std::vector<uint32_t> head(k * m), tail(k * m), next(k * m, UINT32_MAX);
+  for (uint32_t i = 0; i < k * m; i++)
+  {
+    sum[i]  = cells[members[i]].milliamps;
+    head[i] = tail[i] = i;
+  }
+
+  typedef std::pair<double, uint32_t> Entry; // Spread, partial
+  std::priority_queue<Entry> heap;
+  for (uint32_t p = 0; p < m; p++)
+    heap.push(Entry(sum[p * k] - sum[p * k + k - 1], p));
+
+  // Merge the two partials with the largest spreads, largest subset of one
+  // with the smallest of the other, until one is left
+  std::vector<uint32_t> order(k);
+  std::vector<double>   sortedSum(k);
+  std::vector<uint32_t> sortedHead(k), sortedTail(k);
+  while (heap.size() > 1)
+  {
+    uint32_t a = heap.top().second;
+    heap.pop();
+    uint32_t b = heap.top().second;
+    heap.pop();
+    for (unsigned s = 0; s < k; s++)
+    {
+      uint32_t into = a * k + s, from = b * k + (k - 1 - s);
+      sum[into] += sum[from];
+      next[tail[into]] = head[from];
+      tail[into]       = tail[from];
+    }
+    for (unsigned s = 0; s < k; s++)
+      order[s] = a * k + s;
+    std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return sum[x] > sum[y]; });
+    for (unsigned s = 0; s < k; s++)
+    {
+      sortedSum[s]  = sum[order[s]];
+      sortedHead[s] = head[order[s]];
+      sortedTail[s] = tail[order[s]];
+    }
+    for (unsigned s = 0; s < k; s++)
+    {
+      sum[a * k + s]  = sortedSum[s];
+      head[a * k + s] = sortedHead[s];
+      tail[a * k + s] = sortedTail[s];
+    }
+    heap.push(Entry(sum[a * k] - sum[a * k + k - 1], a));
+  }
+
+  PackLayout layout;
+  layout.cells.reserve(k * m);
+  uint32_t last = heap.top().second;
+  for (unsigned s = 0; s < k; s++)
+  {
+    for (uint32_t i = head[last * k + s]; i != UINT32_MAX; i = next[i])
+      layout.cells.push_back(members[i]);
+  }
+  evaluate(cells, options, layout);
+  return layout;
+}
+
+void anneal(const std::vector<Cell> &cells, const PackOptions &options, uint64_t seed, PackLayout &layout)
+{
+  const unsigned series = options.series, parallel = options.parallel;
+  if (series < 2 || parallel == 0 || options.iterations == 0)
+    return;
+
+  std::vector<uint32_t> current = layout.cells;
+  GroupSums             sums(cells, options, current);
+  Random                random(seed);
+
+  // Geometric cooling over four decades, starting where a few percent of the
+  // starting cost is readily given up
+  double temperature = std::max(sums.cost * 0.05, 1e-12);
+  double cooling     = std::pow(1e-4, 1.0 / options.iterations);
+
+  for (uint64_t n = 0; n < options.iterations; n++, temperature *= cooling)
+  {
+    // Half the moves work on the capacity extremes, half anywhere
+    unsigned from, to;
+    if (random.next() & 1)
+    {
+      from = sums.largest;
+      to   = sums.smallest;
+    }
+    else
+    {
+      from = random.below(series);
+      to   = random.below(series - 1);
+      to += to >= from;
+    }
+    if (from == to)
+      continue;
+    uint32_t    x = from * parallel + random.below(parallel), y = to * parallel + random.below(parallel);
+    const Cell &a = cells[current[x]], &b = cells[current[y]];
+
+    double capacityDelta = b.milliamps - a.milliamps, conductanceDelta = 1.0 / b.milliOhms - 1.0 / a.milliOhms;
+    double before        = sums.cost;
+    sums.capacity[from] += capacityDelta;
+    sums.capacity[to] -= capacityDelta;
+    sums.conductance[from] += conductanceDelta;
+    sums.conductance[to] -= conductanceDelta;
+    sums.update();
+
+    double delta = sums.cost - before;
+    if (delta <= 0 || random.unit() < std::exp(-delta / temperature))
+    {
+      std::swap(current[x], current[y]);
+    }
+    else
+    {
+      sums.capacity[from] -= capacityDelta;
+      sums.capacity[to] += capacityDelta;
+      sums.conductance[from] -= conductanceDelta;
+      sums.conductance[to] += conductanceDelta;
+      sums.update();
+    }
+  }
+
+  if (sums.cost < layout.cost)
+  {
+    layout.cells.swap(current);
+    evaluate(cells, options, layout); // Fresh sums, without the rounding of the running updates
+  }
+}
+
+std::vector<PackLayout> buildPacks(const std::vector<Cell> &cells, size_t maxPacks, const PackOptions &options,
+                                   unsigned threads)
+{
+  size_t perPack = (size_t)options.series * options.parallel;
+  if (perPack == 0 || cells.size() < perPack)
+    return {};
+
+  std::vector<uint32_t> order(cells.size());
+  for (uint32_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+    return cells[x].milliamps != cells[y].milliamps ? cells[x].milliamps > cells[y].milliamps : x < y;
+  });
+
+  size_t packs = cells.size() / perPack;
+  if (maxPacks > 0 && maxPacks < packs)
+    packs = maxPacks;
+  threads         = std::max(threads, 1u);
+  unsigned chains = options.chains ? options.chains : std::max<unsigned>(1, threads / packs);
+
+  std::vector<PackLayout> results(packs * chains);
+  std::atomic<size_t>     nextJob{0};
+  auto worker = [&]() {
+    for (size_t job = nextJob++; job < results.size(); job = nextJob++)
+    {
+      size_t     index = job / chains;
+      PackLayout layout = differencing(cells, &order[index * perPack], options);
+      anneal(cells, options, options.seed * 0x100000001B3ULL + job, layout);
+      results[job] = std::move(layout);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++)
+    pool.emplace_back(worker);
+  worker();
+  for (std::thread &thread : pool)
+    thread.join();
+
+  std::vector<PackLayout> best(packs);
+  for (size_t p = 0; p < packs; p++)
+  {
+    size_t pick = p * chains;
+    for (size_t c = 1; c < chains; c++)
+    {
+      if (results[p * chains + c].cost < results[pick].cost)
+        pick = p * chains + c;
+    }
+    best[p] = std::move(results[pick]);
+  }
+  return best;
+}
+
+} // namespace pack
@@ -0,0 +1,69 @@
+// PackSolver.h
+// S x P pack layouts from a pool of graded cells.
+//
+// Packs are cut from the pool sorted by capacity, S * P neighbouring cells
+// each, so every pack gets the closest matched cells that are left. Within a
+// pack the cells are split into S parallel groups of P cells:
+//   1. balanced largest differencing (Karmarkar-Karp for equal sized
+//      subsets) on capacity gives the starting layout in O(n log n)
+//   2. simulated annealing of cell swaps between groups then lowers the
+//      combined cost of capacity and group resistance spread
+// Packs, and several annealing chains per pack when there are more threads
+// than packs, run on a pool of worker threads. Chains are seeded from the
+// seed, pack and chain number, so a run is reproducible for a given chain
+// count.
+
+#ifndef PACK_PACK_SOLVER_H
+#define PACK_PACK_SOLVER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Cell.h"
+
+namespace pack
+{
+
+struct PackOptions
+{
+  unsigned series           = 13;
+  unsigned parallel         = 4;
+  double   resistanceWeight = 0.25;   // Cost of 1 % group resistance spread relative to 1 % capacity spread
+  uint64_t iterations       = 200000; // Annealing moves per chain, 0 = differencing only
+  unsigned chains           = 0;      // Annealing chains per pack, 0 = spread spare threads over the packs
+  uint64_t seed             = 1;
+};
+
+// Group g holds cells[g * parallel] .. cells[(g + 1) * parallel - 1]
+struct PackLayout
+{
+  std::vector<uint32_t> cells; // Indices into the cell list
+  double capacityMin   = 0;    // Group capacity, mAh
+  double capacityMax   = 0;
+  double resistanceMin = 0;    // Group resistance, mOhm (cells in parallel)
+  double resistanceMax = 0;
+  double cost          = 0;    // Relative capacity spread + weight * relative resistance spread
+
+  double capacitySpreadPercent() const { return capacityMax > 0 ? 100.0 * (capacityMax - capacityMin) / capacityMax : 0; }
+  double resistanceSpreadPercent() const
+  {
+    return resistanceMax > 0 ? 100.0 * (resistanceMax - resistanceMin) / resistanceMax : 0;
+  }
+};
+
+// Fills in the group extremes and the cost of layout.cells
+void evaluate(const std::vector<Cell> &cells, const PackOptions &options, PackLayout &layout);
+
+// Balanced largest differencing over series * parallel cells, members sorted by capacity, largest first
+PackLayout differencing(const std::vector<Cell> &cells, const uint32_t *members, const PackOptions &options);
+
+// Anneals layout in place; keeps the starting layout if annealing ends worse
+void anneal(const std::vector<Cell> &cells, const PackOptions &options, uint64_t seed, PackLayout &layout);
+
+// Up to maxPacks packs (0 = as many as the pool allows), best chain per pack
+std::vector<PackLayout> buildPacks(const std::vector<Cell> &cells, size_t maxPacks, const PackOptions &options,
+                                   unsigned threads);
+
+} // namespace pack
+
+#endif // PACK_PACK_SOLVER_H
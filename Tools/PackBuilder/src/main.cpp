@@ -0,0 +1,170 @@
+// main.cpp
+// packbuild: matches graded cells into S x P packs.
+//
+//   packbuild -s <series> -p <parallel> [-n packs] [-g grades] [-r max mOhm] [-f features.csv] [-x max mV]
+//             [-t threads] [-c chains] [-i iterations] [-w IR weight] [-o layout.csv] results.csv ...
+//
+// Reads the results CSVs written by fleetd, drops the cells whose dQ/dV peak
+// ica (-f) found shifted by more than -x from the fleet, builds as many packs
+// as the pool allows (or -n) and writes one row per cell:
+//
+//   pack,group,position,cell,mah,milliohms
+//
+// A summary line per pack goes to stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "CellReader.h"
+#include "FeatureReader.h"
+#include "PackSolver.h"
+
+namespace
+{
+
+void usage()
+{
+  fprintf(stderr, "usage: packbuild -s series -p parallel [-n packs] [-g grades] [-r max_milliohms]\n"
+                  "                 [-f features.csv] [-x max_shift_mv] [-t threads] [-c chains] [-i iterations]\n"
+                  "                 [-w ir_weight] [-o layout.csv] results.csv ...\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  pack::PackOptions options;
+  options.series   = 0;
+  options.parallel = 0;
+  size_t      packCount    = 0;
+  std::string grades       = "AB";
+  float       maxMilliOhms = 0;
+  float       maxShift     = 25;
+  std::vector<std::string> featurePaths;
+  unsigned    threads      = std::thread::hardware_concurrency();
+  std::string outputPath;
+
+  int option;
+  while ((option = getopt(argc, argv, "s:p:n:g:r:f:x:t:c:i:w:o:h")) != -1)
+  {
+    switch (option)
+    {
+    case 's':
+      options.series = atoi(optarg) > 0 ? atoi(optarg) : 0;
+      break;
+    case 'p':
+      options.parallel = atoi(optarg) > 0 ? atoi(optarg) : 0;
+      break;
+    case 'n':
+      packCount = strtoul(optarg, 0, 10);
+      break;
+    case 'g':
+      grades = optarg;
+      break;
+    case 'r':
+      maxMilliOhms = atof(optarg);
+      break;
+    case 'f':
+      featurePaths.push_back(optarg);
+      break;
+    case 'x':
+      maxShift = atof(optarg);
+      break;
+    case 't':
+      threads = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'c':
+      options.chains = atoi(optarg) > 0 ? atoi(optarg) : 0;
+      break;
+    case 'i':
+      options.iterations = strtoull(optarg, 0, 10);
+      break;
+    case 'w':
+      options.resistanceWeight = atof(optarg);
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (options.series == 0 || options.parallel == 0 || optind >= argc)
+  {
+    usage();
+    return 2;
+  }
+
+  std::vector<pack::Cell> cells;
+  pack::ReadStats         stats;
+  for (int i = optind; i < argc; i++)
+  {
+    if (!pack::readResults(argv[i], grades, maxMilliOhms, cells, stats))
+    {
+      fprintf(stderr, "packbuild: cannot read %s\n", argv[i]);
+      return 1;
+    }
+  }
+  fprintf(stderr, "packbuild: %zu cells (%zu filtered, %zu malformed)\n", stats.accepted, stats.filtered,
+          stats.malformed);
+
+  if (!featurePaths.empty())
+  {
+    pack::ShiftIndex   index;
+    pack::FeatureStats featureStats;
+    for (const std::string &path : featurePaths)
+    {
+      if (!pack::readFeatures(path, index))
+      {
+        fprintf(stderr, "packbuild: cannot read %s\n", path.c_str());
+        return 1;
+      }
+    }
+    pack::dropShifted(index, maxShift, cells, featureStats);
+    fprintf(stderr, "packbuild: %zu cells matched to an ICA curve, %zu dropped with the dQ/dV peak over %.0f mV off\n",
+            featureStats.matched, featureStats.shifted, maxShift);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<pack::PackLayout> packs = pack::buildPacks(cells, packCount, options, threads);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (packs.empty())
+  {
+    fprintf(stderr, "packbuild: %zu cells are not enough for one %uS%uP pack\n", cells.size(), options.series,
+            options.parallel);
+    return 1;
+  }
+
+  FILE *output = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "w");
+  if (!output)
+  {
+    fprintf(stderr, "packbuild: cannot write %s\n", outputPath.c_str());
+    return 1;
+  }
+  fprintf(output, "pack,group,position,cell,mah,milliohms\n");
+  for (size_t p = 0; p < packs.size(); p++)
+  {
+    const pack::PackLayout &layout = packs[p];
+    for (size_t n = 0; n < layout.cells.size(); n++)
+    {
+      const pack::Cell &cell = cells[layout.cells[n]];
+      fprintf(output, "%zu,%zu,%zu,%s,%.0f,%.1f\n", p + 1, n / options.parallel + 1, n % options.parallel + 1,
+              cell.id.c_str(), cell.milliamps, cell.milliOhms);
+    }
+    fprintf(stderr, "pack %zu: %uS%uP, groups %.0f-%.0f mAh (%.3f %%), %.2f-%.2f mOhm (%.2f %%)\n", p + 1,
+            options.series, options.parallel, layout.capacityMin, layout.capacityMax, layout.capacitySpreadPercent(),
+            layout.resistanceMin, layout.resistanceMax, layout.resistanceSpreadPercent());
+  }
+  if (output != stdout)
+    fclose(output);
+
+  fprintf(stderr, "packbuild: %zu packs, %zu cells left over, %.2f s on %u threads\n", packs.size(),
+          cells.size() - packs.size() * options.series * options.parallel, seconds, threads);
+  return 0;
+}